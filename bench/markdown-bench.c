@@ -0,0 +1,850 @@
+/* Runs markdown files through md4c outside of OBS and reports the results as JSON.
+ *
+ *   markdown-bench [-m parse|html|null|buffer|stream|ast|edit]... [-w warmup] [-r repetitions] [-f parser_flags]
+ *                  [-c 0|1] [-a 0|1] [-j threads] path...
+ *
+ * Paths are markdown files or directories of *.md files. Modes are parse only, parse and render into a buffer, parse
+ * and render into a sink that drops the output, parse and render with md_html_to_buffer(), parse only with the text fed
+ * to md_parse_stream_feed() in chunks of 64 KiB, and render a tree saved once per document with md_ast_load() and
+ * md_html_ast() like a cache of parsed documents would. With -c 1 one parser/renderer context is reused for all runs,
+ * like the plugin does. With -a 1 md4c allocates from an arena which is reset after every document, this also renders
+ * through contexts, which are then trimmed after every document. With -j, md4c analyzes the inlines of large documents
+ * on a pool of that many threads, this renders through contexts as well.
+ *
+ * The edit mode applies pseudo-random edits to every document, renders only what they affect with
+ * md_html_blocks_reparse_in_context() and checks that the result always equals a full render. It exits with 2 on any
+ * mismatch, as does the ast mode if a saved tree renders differently from md_html(). */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "md4c.h"
+#include "md4c-html.h"
+#include "md4c-ast.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <time.h>
+#include <pthread.h>
+#endif
+
+/* same flags as the plugin */
+#define BENCH_DEFAULT_FLAGS (MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS)
+
+struct bench_file {
+	char *path;
+	char *text;
+	size_t size;
+	/* saved tree for -m ast */
+	void *ast_blob;
+	size_t ast_size;
+};
+
+struct bench_buffer {
+	char *array;
+	size_t len;
+	size_t capacity;
+};
+
+enum bench_mode {
+	BENCH_PARSE,
+	BENCH_HTML,
+	BENCH_NULL,
+	BENCH_BUFFER,
+	BENCH_STREAM,
+	BENCH_AST,
+	BENCH_EDIT,
+	BENCH_MODE_COUNT,
+};
+
+static const char *mode_names[BENCH_MODE_COUNT] = {"parse", "html", "null", "buffer", "stream", "ast", "edit"};
+
+/* output of one render split into top-level blocks */
+struct bench_blocks {
+	struct bench_buffer html;
+	size_t *ends;
+	size_t num;
+	size_t capacity;
+};
+
+#define BENCH_EDITS_PER_RUN 64
+
+/* like a read() of a large file */
+#define BENCH_STREAM_CHUNK (64 * 1024)
+
+static struct {
+	struct bench_file *files;
+	size_t num_files;
+	size_t bytes;
+	unsigned flags;
+	int context;
+	MD_PARSER_CONTEXT *parser_context;
+	MD_HTML_CONTEXT *html_context;
+	MD_ARENA *arena;
+	MD_WORKER_POOL *worker_pool;
+	struct bench_buffer output;
+	MD_HTML_BUFFER html_buffer;
+	uint64_t mismatches;
+	/* md4c allocates through the hooks below */
+	uint64_t allocs;
+	uint64_t alloc_bytes;
+} bench;
+
+/* with -j, md4c allocates on the pool threads too */
+static void bench_count(uint64_t *counter, uint64_t n)
+{
+#ifdef _WIN32
+	InterlockedExchangeAdd64((volatile LONG64 *)counter, (LONG64)n);
+#else
+	__atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+#endif
+}
+
+void *bench_malloc(size_t size)
+{
+	bench_count(&bench.allocs, 1);
+	bench_count(&bench.alloc_bytes, size);
+	return malloc(size);
+}
+
+void *bench_realloc(void *ptr, size_t size)
+{
+	bench_count(&bench.allocs, 1);
+	bench_count(&bench.alloc_bytes, size);
+	return realloc(ptr, size);
+}
+
+void bench_free(void *ptr)
+{
+	free(ptr);
+}
+
+static uint64_t bench_time_ns(void)
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER now;
+	if (!freq.QuadPart)
+		QueryPerformanceFrequency(&freq);
+	QueryPerformanceCounter(&now);
+	return (uint64_t)((double)now.QuadPart * 1000000000.0 / (double)freq.QuadPart);
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+#ifdef _WIN32
+typedef SRWLOCK bench_lock;
+typedef CONDITION_VARIABLE bench_cond;
+#define bench_lock_init(l) InitializeSRWLock(l)
+#define bench_lock_enter(l) AcquireSRWLockExclusive(l)
+#define bench_lock_leave(l) ReleaseSRWLockExclusive(l)
+#define bench_cond_init(c) InitializeConditionVariable(c)
+#define bench_cond_wait(c, l) SleepConditionVariableSRW(c, l, INFINITE, 0)
+#define bench_cond_broadcast(c) WakeAllConditionVariable(c)
+#else
+typedef pthread_mutex_t bench_lock;
+typedef pthread_cond_t bench_cond;
+#define bench_lock_init(l) pthread_mutex_init(l, NULL)
+#define bench_lock_enter(l) pthread_mutex_lock(l)
+#define bench_lock_leave(l) pthread_mutex_unlock(l)
+#define bench_cond_init(c) pthread_cond_init(c, NULL)
+#define bench_cond_wait(c, l) pthread_cond_wait(c, l)
+#define bench_cond_broadcast(c) pthread_cond_broadcast(c)
+#endif
+
+/* threads for -j, they run the jobs of one md4c batch at a time */
+static struct {
+	MD_WORKER_POOL md;
+	bench_lock lock;
+	bench_cond work;
+	bench_cond done;
+#ifdef _WIN32
+	HANDLE *threads;
+#else
+	pthread_t *threads;
+#endif
+	unsigned num_threads;
+	void (*job)(unsigned, void *);
+	void *arg;
+	unsigned num_jobs;
+	unsigned next_job;
+	unsigned jobs_done;
+	int quit;
+} pool;
+
+static void bench_pool_loop(void)
+{
+	bench_lock_enter(&pool.lock);
+	for (;;) {
+		while (!pool.quit && pool.next_job >= pool.num_jobs)
+			bench_cond_wait(&pool.work, &pool.lock);
+		if (pool.quit)
+			break;
+		unsigned index = pool.next_job++;
+		bench_lock_leave(&pool.lock);
+		pool.job(index, pool.arg);
+		bench_lock_enter(&pool.lock);
+		if (++pool.jobs_done == pool.num_jobs)
+			bench_cond_broadcast(&pool.done);
+	}
+	bench_lock_leave(&pool.lock);
+}
+
+#ifdef _WIN32
+static DWORD WINAPI bench_pool_thread(LPVOID param)
+{
+	(void)param;
+	bench_pool_loop();
+	return 0;
+}
+#else
+static void *bench_pool_thread(void *param)
+{
+	(void)param;
+	bench_pool_loop();
+	return NULL;
+}
+#endif
+
+static void *bench_pool_start(void (*job)(unsigned, void *), void *arg, unsigned num_jobs, void *userdata)
+{
+	(void)userdata;
+	bench_lock_enter(&pool.lock);
+	pool.job = job;
+	pool.arg = arg;
+	pool.num_jobs = num_jobs;
+	pool.next_job = 0;
+	pool.jobs_done = 0;
+	bench_cond_broadcast(&pool.work);
+	bench_lock_leave(&pool.lock);
+	return &pool;
+}
+
+static void bench_pool_wait(void *handle, void *userdata)
+{
+	(void)handle;
+	(void)userdata;
+	bench_lock_enter(&pool.lock);
+	while (pool.jobs_done < pool.num_jobs)
+		bench_cond_wait(&pool.done, &pool.lock);
+	bench_lock_leave(&pool.lock);
+}
+
+static int bench_pool_create(unsigned num_threads)
+{
+	bench_lock_init(&pool.lock);
+	bench_cond_init(&pool.work);
+	bench_cond_init(&pool.done);
+	pool.threads = calloc(num_threads, sizeof(*pool.threads));
+	if (!pool.threads)
+		return 0;
+	for (; pool.num_threads < num_threads; pool.num_threads++) {
+#ifdef _WIN32
+		pool.threads[pool.num_threads] = CreateThread(NULL, 0, bench_pool_thread, NULL, 0, NULL);
+		if (!pool.threads[pool.num_threads])
+			return 0;
+#else
+		if (pthread_create(&pool.threads[pool.num_threads], NULL, bench_pool_thread, NULL) != 0)
+			return 0;
+#endif
+	}
+	pool.md.start = bench_pool_start;
+	pool.md.wait = bench_pool_wait;
+	pool.md.n_workers = num_threads;
+	bench.worker_pool = &pool.md;
+	return 1;
+}
+
+static void bench_pool_destroy(void)
+{
+	bench_lock_enter(&pool.lock);
+	pool.quit = 1;
+	bench_cond_broadcast(&pool.work);
+	bench_lock_leave(&pool.lock);
+	for (unsigned i = 0; i < pool.num_threads; i++) {
+#ifdef _WIN32
+		WaitForSingleObject(pool.threads[i], INFINITE);
+		CloseHandle(pool.threads[i]);
+#else
+		pthread_join(pool.threads[i], NULL);
+#endif
+	}
+	free(pool.threads);
+}
+
+static void bench_add_file(const char *path)
+{
+	FILE *f = fopen(path, "rb");
+	if (!f) {
+		fprintf(stderr, "cannot open %s\n", path);
+		return;
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	char *text = malloc(size > 0 ? (size_t)size : 1);
+	if (!text || size < 0 || fread(text, 1, (size_t)size, f) != (size_t)size) {
+		fprintf(stderr, "cannot read %s\n", path);
+		free(text);
+		fclose(f);
+		return;
+	}
+	fclose(f);
+
+	bench.files = realloc(bench.files, (bench.num_files + 1) * sizeof(struct bench_file));
+	struct bench_file *file = &bench.files[bench.num_files++];
+	file->path = malloc(strlen(path) + 1);
+	strcpy(file->path, path);
+	file->text = text;
+	file->size = (size_t)size;
+	file->ast_blob = NULL;
+	file->ast_size = 0;
+	bench.bytes += file->size;
+}
+
+static int bench_is_markdown(const char *name)
+{
+	const char *ext = strrchr(name, '.');
+	return ext && (strcmp(ext, ".md") == 0 || strcmp(ext, ".markdown") == 0);
+}
+
+static int bench_compare_paths(const void *a, const void *b)
+{
+	return strcmp(((const struct bench_file *)a)->path, ((const struct bench_file *)b)->path);
+}
+
+/* adds all markdown files in the directory, returns 0 if the path is not a directory */
+static int bench_add_directory(const char *dir)
+{
+	size_t first = bench.num_files;
+	char path[4096];
+#ifdef _WIN32
+	DWORD attributes = GetFileAttributesA(dir);
+	if (attributes == INVALID_FILE_ATTRIBUTES || !(attributes & FILE_ATTRIBUTE_DIRECTORY))
+		return 0;
+	WIN32_FIND_DATAA data;
+	snprintf(path, sizeof(path), "%s\\*", dir);
+	HANDLE find = FindFirstFileA(path, &data);
+	if (find == INVALID_HANDLE_VALUE)
+		return 1;
+	do {
+		if (!(data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) && bench_is_markdown(data.cFileName)) {
+			snprintf(path, sizeof(path), "%s\\%s", dir, data.cFileName);
+			bench_add_file(path);
+		}
+	} while (FindNextFileA(find, &data));
+	FindClose(find);
+#else
+	DIR *d = opendir(dir);
+	if (!d)
+		return 0;
+	struct dirent *entry;
+	while ((entry = readdir(d)) != NULL) {
+		if (!bench_is_markdown(entry->d_name))
+			continue;
+		snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+		bench_add_file(path);
+	}
+	closedir(d);
+#endif
+	/* directory order is not stable, keep runs comparable */
+	qsort(bench.files + first, bench.num_files - first, sizeof(struct bench_file), bench_compare_paths);
+	return 1;
+}
+
+static int bench_block(MD_BLOCKTYPE type, void *detail, void *userdata)
+{
+	(void)type;
+	(void)detail;
+	(void)userdata;
+	return 0;
+}
+
+static int bench_span(MD_SPANTYPE type, void *detail, void *userdata)
+{
+	(void)type;
+	(void)detail;
+	(void)userdata;
+	return 0;
+}
+
+static int bench_text(MD_TEXTTYPE type, const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	(void)type;
+	(void)text;
+	(void)size;
+	(void)userdata;
+	return 0;
+}
+
+static void bench_output(const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	struct bench_buffer *b = userdata;
+	if (size == 0)
+		return;
+	if (b->len + size > b->capacity) {
+		size_t capacity = b->capacity ? b->capacity * 2 : 4096;
+		while (capacity < b->len + size)
+			capacity *= 2;
+		b->array = realloc(b->array, capacity);
+		b->capacity = capacity;
+	}
+	memcpy(b->array + b->len, text, size);
+	b->len += size;
+}
+
+static void bench_null_output(const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	(void)text;
+	(void)size;
+	(void)userdata;
+}
+
+static void bench_run(enum bench_mode mode, const struct bench_file *file)
+{
+	if (mode == BENCH_PARSE) {
+		MD_PARSER parser = {0, bench.flags, bench_block, bench_block, bench_span, bench_span, bench_text, NULL, NULL, NULL, NULL,
+				    bench.worker_pool};
+		if (bench.arena)
+			parser.allocator = md_arena_allocator(bench.arena);
+		if (bench.context || bench.arena || bench.worker_pool)
+			md_parse_in_context(bench.parser_context, file->text, (MD_SIZE)file->size, &parser, NULL);
+		else
+			md_parse(file->text, (MD_SIZE)file->size, &parser, NULL);
+	} else if (mode == BENCH_STREAM) {
+		MD_PARSER parser = {0, bench.flags, bench_block, bench_block, bench_span, bench_span, bench_text, NULL, NULL, NULL, NULL,
+				    bench.worker_pool};
+		MD_PARSER_STREAM *stream;
+		if (bench.arena)
+			parser.allocator = md_arena_allocator(bench.arena);
+		stream = md_parse_stream_begin(&parser, NULL);
+		if (stream) {
+			for (size_t off = 0; off < file->size; off += BENCH_STREAM_CHUNK) {
+				size_t size = file->size - off < BENCH_STREAM_CHUNK ? file->size - off : BENCH_STREAM_CHUNK;
+				md_parse_stream_feed(stream, file->text + off, (MD_SIZE)size);
+			}
+			md_parse_stream_end(stream);
+		}
+	} else if (mode == BENCH_AST) {
+		MD_AST *ast = md_ast_load(file->ast_blob, file->ast_size, file->text, (MD_SIZE)file->size, bench.flags,
+					  bench.arena ? md_arena_allocator(bench.arena) : NULL);
+		bench.output.len = 0;
+		if (ast)
+			md_html_ast(ast, file->text, bench_output, &bench.output, 0);
+		md_ast_free(ast);
+	} else if (mode == BENCH_BUFFER) {
+		bench.html_buffer.size = 0;
+		if (bench.context || bench.arena || bench.worker_pool) {
+			md_html_context_set_buffer(bench.html_context, &bench.html_buffer);
+			md_html_in_context(bench.html_context, file->text, (MD_SIZE)file->size, NULL, NULL, bench.flags, 0);
+			md_html_context_set_buffer(bench.html_context, NULL);
+		} else {
+			md_html_to_buffer(file->text, (MD_SIZE)file->size, &bench.html_buffer, bench.flags, 0);
+		}
+	} else {
+		void (*output)(const MD_CHAR *, MD_SIZE, void *) = bench_null_output;
+		void *userdata = NULL;
+		if (mode == BENCH_HTML) {
+			bench.output.len = 0;
+			output = bench_output;
+			userdata = &bench.output;
+		}
+		if (bench.context || bench.arena || bench.worker_pool)
+			md_html_in_context(bench.html_context, file->text, (MD_SIZE)file->size, output, userdata, bench.flags, 0);
+		else
+			md_html(file->text, (MD_SIZE)file->size, output, userdata, bench.flags, 0);
+	}
+
+	/* the contexts keep their buffers in the arena */
+	if (bench.arena) {
+		md_parser_context_trim(bench.parser_context);
+		md_html_context_trim(bench.html_context);
+		md_arena_reset(bench.arena);
+	}
+}
+
+/* saves the tree of every document like a cache would, and checks that rendering it gives the same HTML */
+static int bench_save_asts(void)
+{
+	struct bench_buffer expected = {0};
+
+	for (size_t f = 0; f < bench.num_files; f++) {
+		struct bench_file *file = &bench.files[f];
+		MD_AST *ast = md_parse_to_ast(file->text, (MD_SIZE)file->size, bench.flags, NULL);
+		const void *blob;
+
+		if (!ast)
+			return 0;
+		blob = md_ast_blob(ast, &file->ast_size);
+		file->ast_blob = malloc(file->ast_size);
+		memcpy(file->ast_blob, blob, file->ast_size);
+		md_ast_free(ast);
+
+		expected.len = 0;
+		md_html(file->text, (MD_SIZE)file->size, bench_output, &expected, bench.flags, 0);
+		bench_run(BENCH_AST, file);
+		if (expected.len != bench.output.len || memcmp(expected.array, bench.output.array, expected.len) != 0) {
+			if (!bench.mismatches)
+				fprintf(stderr, "%s: rendering the saved tree differs from md_html()\n", file->path);
+			bench.mismatches++;
+		}
+	}
+	free(expected.array);
+	return 1;
+}
+
+static int bench_compare_samples(const void *a, const void *b)
+{
+	uint64_t x = *(const uint64_t *)a;
+	uint64_t y = *(const uint64_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static uint64_t bench_percentile(const uint64_t *sorted, size_t num, double p)
+{
+	size_t idx = (size_t)(p * (double)(num - 1) + 0.5);
+	return sorted[idx];
+}
+
+static void bench_add_block(MD_BLOCKTYPE type, void *userdata)
+{
+	struct bench_blocks *b = userdata;
+	(void)type;
+	if (b->num == b->capacity) {
+		b->capacity = b->capacity ? b->capacity * 2 : 64;
+		b->ends = realloc(b->ends, b->capacity * sizeof(size_t));
+	}
+	b->ends[b->num++] = b->html.len;
+}
+
+static void bench_add_block_output(const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	struct bench_blocks *b = userdata;
+	bench_output(text, size, &b->html);
+}
+
+static size_t bench_block_start(const struct bench_blocks *b, size_t idx)
+{
+	return idx ? b->ends[idx - 1] : 0;
+}
+
+/* puts the blocks of part in place of the ones replaced in doc */
+static void bench_splice_blocks(struct bench_blocks *doc, const struct bench_blocks *part, const MD_REPARSE_INFO *info,
+				struct bench_blocks *out)
+{
+	size_t first = info->first_block;
+	size_t last = first + info->old_block_count;
+
+	out->html.len = 0;
+	out->num = 0;
+	bench_output(doc->html.array, (MD_SIZE)bench_block_start(doc, first), &out->html);
+	for (size_t i = 0; i < first; i++) {
+		bench_add_block(0, out);
+		out->ends[i] = doc->ends[i];
+	}
+	size_t shift = out->html.len;
+	bench_output(part->html.array, (MD_SIZE)part->html.len, &out->html);
+	for (size_t i = 0; i < part->num; i++) {
+		bench_add_block(0, out);
+		out->ends[out->num - 1] = shift + part->ends[i];
+	}
+	size_t tail = bench_block_start(doc, last);
+	shift = out->html.len;
+	bench_output(doc->html.array + tail, (MD_SIZE)(doc->html.len - tail), &out->html);
+	for (size_t i = last; i < doc->num; i++) {
+		bench_add_block(0, out);
+		out->ends[out->num - 1] = shift + doc->ends[i] - tail;
+	}
+}
+
+/* small edits which tend to change the block structure */
+static const char *const edit_snippets[] = {
+	"a", " ", "\n", "\n\n", "*", "_", "`", "- ", "1. ", "> ", "# ", "    ", "\t", "|", "| --- |\n", "```\n",
+	"~~~", "<div>\n", "-->", "[x]", "[x]: /url \"title\"\n", "[X]:\n/other\n", "---\n", "===\n", "\\", "&amp;",
+	"- [ ] ", "\r\n",
+};
+
+static uint32_t bench_random(uint32_t *state)
+{
+	*state = *state * 1664525u + 1013904223u;
+	return *state >> 8;
+}
+
+/* applies edits to a copy of the document, reparses and compares with a full render after each */
+static uint64_t bench_edit(const struct bench_file *file, uint32_t *seed, uint64_t *full_ns, size_t *reparsed_bytes,
+			   size_t *full_reparses)
+{
+	struct bench_blocks doc = {0}, part = {0}, spliced = {0}, expected = {0};
+	size_t size = file->size;
+	size_t capacity = size + 4096;
+	char *text = malloc(capacity);
+	uint64_t total = 0;
+	MD_REPARSE_INFO info;
+
+	memcpy(text, file->text, size);
+	md_html_blocks_reparse_in_context(bench.html_context, text, (MD_SIZE)size, NULL, bench_add_block_output,
+					  bench_add_block, NULL, &doc, bench.flags, 0, &info);
+
+	for (int i = 0; i < BENCH_EDITS_PER_RUN; i++) {
+		MD_EDIT edit;
+		const char *snippet = edit_snippets[bench_random(seed) % (sizeof(edit_snippets) / sizeof(edit_snippets[0]))];
+		edit.beg = (MD_OFFSET)(bench_random(seed) % (size + 1));
+		edit.old_size = (MD_SIZE)(bench_random(seed) % 4 == 0 ? bench_random(seed) % 16 : 0);
+		if (edit.old_size > size - edit.beg)
+			edit.old_size = (MD_SIZE)(size - edit.beg);
+		edit.new_size = (MD_SIZE)(bench_random(seed) % 3 == 0 ? 0 : strlen(snippet));
+		if (size - edit.old_size + edit.new_size > capacity) {
+			capacity = (size + edit.new_size) * 2;
+			text = realloc(text, capacity);
+		}
+		memmove(text + edit.beg + edit.new_size, text + edit.beg + edit.old_size, size - edit.beg - edit.old_size);
+		memcpy(text + edit.beg, snippet, edit.new_size);
+		size = size - edit.old_size + edit.new_size;
+
+		part.html.len = 0;
+		part.num = 0;
+		uint64_t start = bench_time_ns();
+		md_html_blocks_reparse_in_context(bench.html_context, text, (MD_SIZE)size, &edit, bench_add_block_output,
+						  bench_add_block, NULL, &part, bench.flags, 0, &info);
+		total += bench_time_ns() - start;
+		*reparsed_bytes += info.end - info.beg;
+		if (info.full)
+			++*full_reparses;
+
+		bench_splice_blocks(&doc, &part, &info, &spliced);
+		struct bench_blocks swap = doc;
+		doc = spliced;
+		spliced = swap;
+
+		expected.html.len = 0;
+		expected.num = 0;
+		start = bench_time_ns();
+		md_html_blocks(text, (MD_SIZE)size, bench_add_block_output, bench_add_block, NULL, &expected, bench.flags, 0);
+		*full_ns += bench_time_ns() - start;
+
+		if (expected.html.len != doc.html.len || memcmp(expected.html.array, doc.html.array, doc.html.len) != 0 ||
+		    expected.num != doc.num) {
+			if (!bench.mismatches)
+				fprintf(stderr, "%s: edit %d at %u (-%u +%u) differs from a full render\n", file->path, i,
+					(unsigned)edit.beg, (unsigned)edit.old_size, (unsigned)edit.new_size);
+			bench.mismatches++;
+			/* start over from a full render */
+			doc.html.len = 0;
+			doc.num = 0;
+			md_html_blocks_reparse_in_context(bench.html_context, text, (MD_SIZE)size, NULL,
+							  bench_add_block_output, bench_add_block, NULL, &doc, bench.flags,
+							  0, &info);
+		}
+	}
+
+	free(text);
+	free(doc.html.array);
+	free(doc.ends);
+	free(part.html.array);
+	free(part.ends);
+	free(spliced.html.array);
+	free(spliced.ends);
+	free(expected.html.array);
+	free(expected.ends);
+	if (bench.arena) {
+		md_html_context_trim(bench.html_context);
+		md_arena_reset(bench.arena);
+	}
+	return total;
+}
+
+/* per edit latencies compared to rendering the whole document */
+static void bench_edit_mode(int reps, int last)
+{
+	size_t num = bench.num_files * (size_t)reps;
+	uint64_t *samples = malloc(num * sizeof(uint64_t));
+	uint64_t total = 0, full = 0;
+	size_t reparsed_bytes = 0, full_reparses = 0;
+	uint32_t seed = 1;
+
+	for (int i = 0; i < reps; i++) {
+		for (size_t f = 0; f < bench.num_files; f++) {
+			uint64_t elapsed = bench_edit(&bench.files[f], &seed, &full, &reparsed_bytes, &full_reparses);
+			samples[i * bench.num_files + f] = elapsed / BENCH_EDITS_PER_RUN;
+			total += elapsed;
+		}
+	}
+	qsort(samples, num, sizeof(uint64_t), bench_compare_samples);
+
+	double edits = (double)num * BENCH_EDITS_PER_RUN;
+	printf("    {\"mode\": \"edit\", \"edits\": %.0f, \"reparsed_bytes\": %.1f, \"full_reparses\": %zu, "
+	       "\"mismatches\": %llu, \"p50_ns\": %llu, \"p99_ns\": %llu, \"total_ns\": %llu, \"full_total_ns\": %llu}%s\n",
+	       edits, (double)reparsed_bytes / edits, full_reparses, (unsigned long long)bench.mismatches,
+	       (unsigned long long)bench_percentile(samples, num, 0.5), (unsigned long long)bench_percentile(samples, num, 0.99),
+	       (unsigned long long)total, (unsigned long long)full, last ? "" : ",");
+	free(samples);
+}
+
+/* each document is timed on its own, so the percentiles are per document latencies */
+static void bench_mode(enum bench_mode mode, int warmup, int reps, int last)
+{
+	for (int i = 0; i < warmup; i++) {
+		for (size_t f = 0; f < bench.num_files; f++)
+			bench_run(mode, &bench.files[f]);
+	}
+
+	size_t num = bench.num_files * (size_t)reps;
+	uint64_t *samples = malloc(num * sizeof(uint64_t));
+	uint64_t total = 0;
+	bench.allocs = 0;
+	bench.alloc_bytes = 0;
+	for (int i = 0; i < reps; i++) {
+		for (size_t f = 0; f < bench.num_files; f++) {
+			uint64_t start = bench_time_ns();
+			bench_run(mode, &bench.files[f]);
+			uint64_t elapsed = bench_time_ns() - start;
+			samples[i * bench.num_files + f] = elapsed;
+			total += elapsed;
+		}
+	}
+	qsort(samples, num, sizeof(uint64_t), bench_compare_samples);
+
+	double bytes = (double)bench.bytes * reps;
+	double seconds = (double)total / 1e9;
+	printf("    {\"mode\": \"%s\", \"mb_per_s\": %.3f, \"ns_per_byte\": %.4f, \"allocs\": %.1f, \"alloc_bytes\": %.1f, "
+	       "\"p50_ns\": %llu, \"p99_ns\": %llu, \"total_ns\": %llu}%s\n",
+	       mode_names[mode], seconds > 0 ? bytes / seconds / 1e6 : 0.0, bytes > 0 ? (double)total / bytes : 0.0,
+	       (double)bench.allocs / reps, (double)bench.alloc_bytes / reps,
+	       (unsigned long long)bench_percentile(samples, num, 0.5), (unsigned long long)bench_percentile(samples, num, 0.99),
+	       (unsigned long long)total, last ? "" : ",");
+	free(samples);
+}
+
+static void bench_usage(void)
+{
+	fprintf(stderr, "usage: markdown-bench [-m parse|html|null|buffer|stream|ast|edit]... [-w warmup] "
+			"[-r repetitions] [-f parser_flags] [-c 0|1] [-a 0|1] [-j threads] path...\n");
+}
+
+int main(int argc, char **argv)
+{
+	int modes[BENCH_MODE_COUNT] = {0};
+	int any_mode = 0;
+	int warmup = 3;
+	int reps = 10;
+	int arena = 0;
+	int threads = 0;
+	bench.flags = BENCH_DEFAULT_FLAGS;
+
+	for (int i = 1; i < argc; i++) {
+		const char *arg = argv[i];
+		if (arg[0] == '-' && arg[1] && !arg[2] && i + 1 < argc) {
+			const char *value = argv[++i];
+			if (arg[1] == 'm') {
+				int m;
+				for (m = 0; m < BENCH_MODE_COUNT; m++) {
+					if (strcmp(value, mode_names[m]) == 0)
+						break;
+				}
+				if (m == BENCH_MODE_COUNT) {
+					bench_usage();
+					return 1;
+				}
+				modes[m] = 1;
+				any_mode = 1;
+			} else if (arg[1] == 'w') {
+				warmup = atoi(value);
+			} else if (arg[1] == 'r') {
+				reps = atoi(value);
+			} else if (arg[1] == 'f') {
+				bench.flags = (unsigned)strtoul(value, NULL, 0);
+			} else if (arg[1] == 'c') {
+				bench.context = atoi(value) != 0;
+			} else if (arg[1] == 'a') {
+				arena = atoi(value) != 0;
+			} else if (arg[1] == 'j') {
+				threads = atoi(value);
+			} else {
+				bench_usage();
+				return 1;
+			}
+		} else if (!bench_add_directory(arg)) {
+			bench_add_file(arg);
+		}
+	}
+	if (!bench.num_files || reps < 1 || warmup < 0 || threads < 0) {
+		bench_usage();
+		return 1;
+	}
+	if (arena && threads) {
+		fprintf(stderr, "the arena is not thread-safe, -a 1 cannot be combined with -j\n");
+		return 1;
+	}
+	/* the edit mode checks more than it measures, it only runs when asked for */
+	if (!any_mode) {
+		for (int m = 0; m < BENCH_EDIT; m++)
+			modes[m] = 1;
+	}
+
+	if (arena) {
+		bench.arena = md_arena_new(0);
+		if (!bench.arena) {
+			fprintf(stderr, "cannot create arena\n");
+			return 1;
+		}
+	}
+	if (threads && !bench_pool_create((unsigned)threads)) {
+		fprintf(stderr, "cannot create threads\n");
+		return 1;
+	}
+	if (bench.context || bench.arena || bench.worker_pool || modes[BENCH_EDIT]) {
+		bench.parser_context = md_parser_context_new();
+		bench.html_context = md_html_context_new(bench.arena ? md_arena_allocator(bench.arena) : NULL);
+		if (!bench.parser_context || !bench.html_context) {
+			fprintf(stderr, "cannot create contexts\n");
+			return 1;
+		}
+		md_html_context_set_worker_pool(bench.html_context, bench.worker_pool);
+	}
+
+	if (modes[BENCH_AST] && !bench_save_asts()) {
+		fprintf(stderr, "cannot save trees\n");
+		return 1;
+	}
+
+	int last_mode = 0;
+	for (int m = 0; m < BENCH_MODE_COUNT; m++) {
+		if (modes[m])
+			last_mode = m;
+	}
+	printf("{\n  \"files\": %zu,\n  \"bytes\": %zu,\n  \"parser_flags\": %u,\n  \"context\": %s,\n  \"arena\": %s,\n"
+	       "  \"threads\": %d,\n  \"warmup\": %d,\n  \"repetitions\": %d,\n  \"results\": [\n",
+	       bench.num_files, bench.bytes, bench.flags, bench.context ? "true" : "false", bench.arena ? "true" : "false",
+	       threads, warmup, reps);
+	for (int m = 0; m < BENCH_MODE_COUNT; m++) {
+		if (!modes[m])
+			continue;
+		if (m == BENCH_EDIT)
+			bench_edit_mode(reps, m == last_mode);
+		else
+			bench_mode((enum bench_mode)m, warmup, reps, m == last_mode);
+	}
+	printf("  ]\n}\n");
+
+	for (size_t f = 0; f < bench.num_files; f++) {
+		free(bench.files[f].path);
+		free(bench.files[f].text);
+		free(bench.files[f].ast_blob);
+	}
+	free(bench.files);
+	free(bench.output.array);
+	md_html_buffer_free(&bench.html_buffer);
+	md_parser_context_free(bench.parser_context);
+	md_html_context_free(bench.html_context);
+	md_arena_free(bench.arena);
+	if (bench.worker_pool)
+		bench_pool_destroy();
+	return bench.mismatches ? 2 : 0;
+}
@@ -0,0 +1,170 @@
+/* Regression tests for the md4c changes of this repository.
+ *
+ *   md4c-test
+ *
+ * Renders every case with md_html() and compares the output. The spans of every case must also nest: each
+ * leave_span() has to close the span entered last, as the tree of md_parse_to_ast() and any other renderer relies on.
+ * Exits with 1 if a case fails. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "md4c.h"
+#include "md4c-html.h"
+
+#define TEST_AUTOLINK_FLAGS                                                                                  \
+	(MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_PERMISSIVEURLAUTOLINKS | MD_FLAG_PERMISSIVEWWWAUTOLINKS | \
+	 MD_FLAG_LATEXMATHSPANS)
+
+struct test_case {
+	const char *name;
+	unsigned flags;
+	const char *input;
+	const char *html;
+};
+
+static const struct test_case test_cases[] = {
+	/* a math span contains a permissive autolink, the path ends before the '$' */
+	{"math around www autolink", TEST_AUTOLINK_FLAGS, "$x www.example.com/a$ y\n",
+	 "<p><x-equation>x www.example.com/a</x-equation> y</p>\n"},
+	{"display math around www autolink", TEST_AUTOLINK_FLAGS, "$$ see www.example.com$$ after\n",
+	 "<p><x-equation type=\"display\"> see www.example.com</x-equation> after</p>\n"},
+	{"math behind www autolink", TEST_AUTOLINK_FLAGS, "www.example.com/$a b$\n",
+	 "<p><a href=\"http://www.example.com/\">www.example.com/</a><x-equation>a b</x-equation></p>\n"},
+	{"math behind url autolink", TEST_AUTOLINK_FLAGS, "see http://example.com/$x^2$ y\n",
+	 "<p>see <a href=\"http://example.com/\">http://example.com/</a><x-equation>x^2</x-equation> y</p>\n"},
+
+	/* emphasis in the path may not pair with a mark behind the link */
+	{"underscore in path", TEST_AUTOLINK_FLAGS, "www.example.com/._u_ x_\n",
+	 "<p><a href=\"http://www.example.com/._u\">www.example.com/._u</a>_ x_</p>\n"},
+	{"asterisks in path", TEST_AUTOLINK_FLAGS, "**www.example.com/**x** y\n",
+	 "<p><strong><a href=\"http://www.example.com/**x\">www.example.com/**x</a></strong> y</p>\n"},
+	{"opener before link, closer in path", TEST_AUTOLINK_FLAGS, "*x www.example.com/a*b y*\n",
+	 "<p><em>x <a href=\"http://www.example.com/a*b\">www.example.com/a*b</a> y</em></p>\n"},
+	{"url autolink path", TEST_AUTOLINK_FLAGS, "http://foo.bar/baz.*a **b** c*\n",
+	 "<p><a href=\"http://foo.bar/baz.*a\">http://foo.bar/baz.*a</a> <strong>b</strong> c*</p>\n"},
+
+	/* the path ends with the table cell */
+	{"www autolink in table cell", TEST_AUTOLINK_FLAGS, "| www.example.com/a | b |\n| --- | --- |\n",
+	 "<table>\n<thead>\n<tr>\n<th><a href=\"http://www.example.com/a\">www.example.com/a</a></th>\n<th>b</th>\n</tr>\n"
+	 "</thead>\n</table>\n"},
+
+	/* unchanged: spans around the link */
+	{"emphasis around www autolink", TEST_AUTOLINK_FLAGS, "a *www.example.com/b* c\n",
+	 "<p>a <em><a href=\"http://www.example.com/b\">www.example.com/b</a></em> c</p>\n"},
+	{"underscores around www autolink", TEST_AUTOLINK_FLAGS, "_www.example.com/a_\n",
+	 "<p><em><a href=\"http://www.example.com/a\">www.example.com/a</a></em></p>\n"},
+	{"dollar without math spans", MD_FLAG_PERMISSIVEWWWAUTOLINKS, "$x www.example.com/a$ y\n",
+	 "<p>$x <a href=\"http://www.example.com/a$\">www.example.com/a$</a> y</p>\n"},
+};
+
+struct test_buffer {
+	char *array;
+	size_t len;
+	size_t capacity;
+};
+
+static void test_output(const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	struct test_buffer *b = userdata;
+	if (size == 0)
+		return;
+	if (b->len + size + 1 > b->capacity) {
+		size_t capacity = b->capacity ? b->capacity * 2 : 256;
+		while (capacity < b->len + size + 1)
+			capacity *= 2;
+		b->array = realloc(b->array, capacity);
+		b->capacity = capacity;
+	}
+	memcpy(b->array + b->len, text, size);
+	b->len += size;
+	b->array[b->len] = 0;
+}
+
+#define TEST_MAX_DEPTH 64
+
+struct test_spans {
+	MD_SPANTYPE open[TEST_MAX_DEPTH];
+	int depth;
+	int error;
+};
+
+static int test_block(MD_BLOCKTYPE type, void *detail, void *userdata)
+{
+	(void)type;
+	(void)detail;
+	(void)userdata;
+	return 0;
+}
+
+static int test_enter_span(MD_SPANTYPE type, void *detail, void *userdata)
+{
+	struct test_spans *s = userdata;
+	(void)detail;
+	if (s->depth == TEST_MAX_DEPTH) {
+		s->error = 1;
+		return 0;
+	}
+	s->open[s->depth++] = type;
+	return 0;
+}
+
+static int test_leave_span(MD_SPANTYPE type, void *detail, void *userdata)
+{
+	struct test_spans *s = userdata;
+	(void)detail;
+	if (s->depth == 0 || s->open[s->depth - 1] != type)
+		s->error = 1;
+	else
+		s->depth--;
+	return 0;
+}
+
+static int test_text(MD_TEXTTYPE type, const MD_CHAR *text, MD_SIZE size, void *userdata)
+{
+	(void)type;
+	(void)text;
+	(void)size;
+	(void)userdata;
+	return 0;
+}
+
+static int test_run(const struct test_case *test)
+{
+	struct test_buffer out = {0};
+	struct test_spans spans = {0};
+	MD_PARSER parser;
+	MD_SIZE size = (MD_SIZE)strlen(test->input);
+	int failed = 0;
+
+	memset(&parser, 0, sizeof(parser));
+	parser.flags = test->flags;
+	parser.enter_block = test_block;
+	parser.leave_block = test_block;
+	parser.enter_span = test_enter_span;
+	parser.leave_span = test_leave_span;
+	parser.text = test_text;
+
+	if (md_html(test->input, size, test_output, &out, test->flags, 0) != 0 || !out.array ||
+	    strcmp(out.array, test->html) != 0) {
+		printf("FAIL %s: html\n  input:    %s  expected: %s  got:      %s", test->name, test->input, test->html,
+		       out.array ? out.array : "(nothing)\n");
+		failed = 1;
+	}
+	if (md_parse(test->input, size, &parser, &spans) != 0 || spans.error || spans.depth != 0) {
+		printf("FAIL %s: spans do not nest\n", test->name);
+		failed = 1;
+	}
+	free(out.array);
+	return failed;
+}
+
+int main(void)
+{
+	size_t num = sizeof(test_cases) / sizeof(test_cases[0]);
+	size_t failed = 0;
+	for (size_t i = 0; i < num; i++)
+		failed += test_run(&test_cases[i]);
+	printf("%zu of %zu passed\n", num - failed, num);
+	return failed ? 1 : 0;
+}
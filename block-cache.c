@@ -0,0 +1,170 @@
+#include <obs-module.h>
+#include <util/bmem.h>
+#include <util/threading.h>
+#include "block-cache.h"
+
+#define BLOCK_CACHE_MIN_BUCKETS 256
+
+/* blocks larger than this fraction of the budget would evict too much */
+#define BLOCK_CACHE_MAX_ENTRY_DIV 8
+
+struct block_cache_entry {
+	uint64_t key;
+	uint64_t hash;
+	size_t len;
+	struct block_cache_entry *next_in_bucket;
+	struct block_cache_entry *prev;
+	struct block_cache_entry *next;
+	char html[];
+};
+
+static struct {
+	bool initialized;
+	pthread_mutex_t mutex;
+	struct block_cache_entry **buckets;
+	size_t num_buckets;
+	/* most recently used first, lru.prev is the least recently used */
+	struct block_cache_entry lru;
+	struct block_cache_stats stats;
+} bc;
+
+static inline size_t block_cache_entry_size(size_t len)
+{
+	return sizeof(struct block_cache_entry) + len;
+}
+
+static struct block_cache_entry **block_cache_bucket(uint64_t key)
+{
+	return &bc.buckets[key & (bc.num_buckets - 1)];
+}
+
+static void block_cache_unlink(struct block_cache_entry *entry)
+{
+	entry->prev->next = entry->next;
+	entry->next->prev = entry->prev;
+}
+
+static void block_cache_link_front(struct block_cache_entry *entry)
+{
+	entry->prev = &bc.lru;
+	entry->next = bc.lru.next;
+	bc.lru.next->prev = entry;
+	bc.lru.next = entry;
+}
+
+static void block_cache_remove(struct block_cache_entry *entry)
+{
+	struct block_cache_entry **p = block_cache_bucket(entry->key);
+	while (*p != entry)
+		p = &(*p)->next_in_bucket;
+	*p = entry->next_in_bucket;
+	block_cache_unlink(entry);
+	bc.stats.entries--;
+	bc.stats.size -= block_cache_entry_size(entry->len);
+	bfree(entry);
+}
+
+static void block_cache_grow(void)
+{
+	size_t num = bc.num_buckets * 2;
+	struct block_cache_entry **buckets = bzalloc(num * sizeof(*buckets));
+	for (struct block_cache_entry *entry = bc.lru.next; entry != &bc.lru; entry = entry->next) {
+		struct block_cache_entry **bucket = &buckets[entry->key & (num - 1)];
+		entry->next_in_bucket = *bucket;
+		*bucket = entry;
+	}
+	bfree(bc.buckets);
+	bc.buckets = buckets;
+	bc.num_buckets = num;
+}
+
+bool block_cache_init(size_t budget)
+{
+	if (bc.initialized)
+		return true;
+	memset(&bc, 0, sizeof(bc));
+	if (pthread_mutex_init(&bc.mutex, NULL) != 0)
+		return false;
+	bc.num_buckets = BLOCK_CACHE_MIN_BUCKETS;
+	bc.buckets = bzalloc(bc.num_buckets * sizeof(*bc.buckets));
+	bc.lru.prev = bc.lru.next = &bc.lru;
+	bc.stats.budget = budget;
+	bc.initialized = true;
+	return true;
+}
+
+void block_cache_free(void)
+{
+	if (!bc.initialized)
+		return;
+	while (bc.lru.next != &bc.lru)
+		block_cache_remove(bc.lru.next);
+	bfree(bc.buckets);
+	pthread_mutex_destroy(&bc.mutex);
+	bc.initialized = false;
+}
+
+bool block_cache_get(uint64_t key, struct dstr *html, uint64_t *hash)
+{
+	if (!bc.initialized)
+		return false;
+	pthread_mutex_lock(&bc.mutex);
+	struct block_cache_entry *entry = *block_cache_bucket(key);
+	while (entry && entry->key != key)
+		entry = entry->next_in_bucket;
+	if (entry) {
+		block_cache_unlink(entry);
+		block_cache_link_front(entry);
+		dstr_ncat(html, entry->html, entry->len);
+		*hash = entry->hash;
+		bc.stats.hits++;
+	} else {
+		bc.stats.misses++;
+	}
+	pthread_mutex_unlock(&bc.mutex);
+	return entry != NULL;
+}
+
+void block_cache_put(uint64_t key, const char *html, size_t len, uint64_t hash)
+{
+	if (!bc.initialized || block_cache_entry_size(len) > bc.stats.budget / BLOCK_CACHE_MAX_ENTRY_DIV)
+		return;
+	pthread_mutex_lock(&bc.mutex);
+	struct block_cache_entry **bucket = block_cache_bucket(key);
+	for (struct block_cache_entry *entry = *bucket; entry; entry = entry->next_in_bucket) {
+		if (entry->key == key) {
+			pthread_mutex_unlock(&bc.mutex);
+			return;
+		}
+	}
+
+	while (bc.stats.size + block_cache_entry_size(len) > bc.stats.budget) {
+		block_cache_remove(bc.lru.prev);
+		bc.stats.evictions++;
+	}
+
+	struct block_cache_entry *entry = bmalloc(block_cache_entry_size(len));
+	entry->key = key;
+	entry->hash = hash;
+	entry->len = len;
+	memcpy(entry->html, html, len);
+	entry->next_in_bucket = *bucket;
+	*bucket = entry;
+	block_cache_link_front(entry);
+	bc.stats.entries++;
+	bc.stats.size += block_cache_entry_size(len);
+	if (bc.stats.entries > bc.num_buckets)
+		block_cache_grow();
+	pthread_mutex_unlock(&bc.mutex);
+}
+
+void block_cache_get_stats(struct block_cache_stats *stats)
+{
+	if (!bc.initialized) {
+		memset(stats, 0, sizeof(*stats));
+		return;
+	}
+	pthread_mutex_lock(&bc.mutex);
+	*stats = bc.stats;
+	pthread_mutex_unlock(&bc.mutex);
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+#include <util/c99defs.h>
+#include <util/dstr.h>
+
+/* Module wide LRU cache of rendered top-level blocks, shared by all sources.
+ * Keys are computed by the caller from everything that affects the output. */
+
+struct block_cache_stats {
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+	size_t entries;
+	size_t size;
+	size_t budget;
+};
+
+bool block_cache_init(size_t budget);
+void block_cache_free(void);
+
+/* On a hit the cached html is appended to html and its hash stored in hash. */
+bool block_cache_get(uint64_t key, struct dstr *html, uint64_t *hash);
+void block_cache_put(uint64_t key, const char *html, size_t len, uint64_t hash);
+
+void block_cache_get_stats(struct block_cache_stats *stats);
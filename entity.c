@@ -2163,28 +2163,405 @@ static const struct entity entity_table[] = {
 };
 
 
-struct entity_key {
-    const char* name;
-    size_t name_size;
+/* Minimal perfect hash of entity_table[]: The first level hash of a name
+ * selects entity_displacement[]. A negative value -1-i there says the name
+ * can only be entity_slot[i], otherwise the value is the seed of the second
+ * level hash which tells the slot. The name still has to be compared as it
+ * may be no entity at all. */
+/* BEGIN GENERATED ENTITY HASH (scripts/build_entity_hash.py) */
+#define ENTITY_COUNT 2131
+
+static const short entity_displacement[ENTITY_COUNT] = {
+    1, 0, -2131, -2126, 0, 0, -2124, 0, 0, 1, -2122, 0,
+    0, -2121, 1, -2114, 1, 2, 1, 0, 0, 0, 0, -2113,
+    -2112, 0, 1, 2, -2110, -2108, -2103, 0, 1, -2102, 0, 1,
+    1, 1, -2101, -2100, 0, -2099, 1, 0, -2098, 0, -2097, 0,
+    0, 2, 0, 1, 0, 0, -2096, -2095, 0, 1, -2094, -2093,
+    0, 1, -2089, 1, -2084, -2082, 2, -2077, 0, -2076, -2074, -2072,
+    -2068, 0, 0, 0, 0, 1, 1, 0, 0, 1, 2, 1,
+    -2064, 1, -2061, 0, 3, -2059, 1, 0, 2, -2058, 1, 0,
+    1, -2057, -2056, -2050, -2048, 0, 0, -2047, 2, 0, 0, 2,
+    -2045, -2035, -2031, 1, -2030, 0, -2027, 0, 0, 1, 0, 0,
+    1, 2, 0, 0, 0, 2, 0, 1, 1, 0, 0, 0,
+    0, 1, -2025, 0, 1, 0, -2023, -2020, -2018, 0, -2016, -2015,
+    1, 0, 0, -2014, 0, 0, 0, 0, 0, 0, 2, 1,
+    -2013, 0, 1, 1, 0, -2012, -2009, 0, -2001, -1995, 0, 0,
+    -1994, 0, -1989, 0, 1, -1985, 0, 0, 0, 0, -1984, -1983,
+    0, 0, -1978, 2, 1, 0, 0, 0, -1973, 0, 8, 0,
+    2, -1972, -1971, -1967, -1966, 0, 1, -1963, 2, 0, 1, 0,
+    -1962, 0, 1, -1961, 0, -1958, -1957, 0, 6, -1956, 0, -1950,
+    0, 2, 1, 1, -1949, -1948, -1945, 0, -1944, 2, -1943, 0,
+    2, 0, -1941, -1935, -1934, 0, 1, 1, -1930, 3, 0, 6,
+    -1928, 0, 0, 4, 1, 1, 0, 1, 0, 0, 1, 0,
+    -1927, 0, -1926, 0, -1925, -1923, -1916, -1912, 2, -1908, 0, 0,
+    -1907, -1904, -1902, 0, 2, -1899, 0, -1893, 0, -1890, 1, -1888,
+    -1885, 0, -1879, -1872, -1870, -1869, 0, -1867, 0, 5, 1, -1864,
+    0, -1862, 1, -1855, 0, -1853, 2, -1852, 1, 0, 4, 0,
+    -1850, -1848, 0, 0, 0, -1842, -1840, -1838, 0, 2, 1, 0,
+    -1837, 0, 0, -1833, 0, 0, -1830, 0, 0, 0, 0, 0,
+    0, 1, -1829, 0, -1828, -1821, 4, 0, -1814, 0, 1, -1812,
+    0, 0, 0, 0, 1, -1810, 1, -1804, 0, -1802, 0, -1800,
+    0, -1799, 0, 1, -1797, 4, 0, 6, -1796, 0, 2, 0,
+    1, -1795, -1788, 0, 0, 1, -1786, -1782, 0, -1781, 0, -1777,
+    -1776, 0, -1771, -1770, 1, 0, -1768, 0, 3, 0, -1766, 0,
+    2, -1759, 0, 0, 0, -1758, 0, -1757, -1756, 0, -1747, 4,
+    -1745, -1742, 0, -1741, -1740, 0, 0, 2, 0, -1739, -1737, 1,
+    -1735, -1734, 0, 1, 0, 0, 4, 1, 1, 1, 0, 1,
+    -1732, 2, 2, 0, 0, -1731, -1729, 0, -1727, 1, 0, -1725,
+    0, -1717, 0, 1, -1715, -1713, -1712, -1711, -1705, 1, 1, 0,
+    1, 1, -1703, 0, 0, 2, 0, -1700, 0, -1699, 1, 0,
+    -1693, 1, 0, 2, -1691, 1, -1690, 0, -1689, -1688, 0, -1686,
+    -1685, 0, 0, 0, -1683, 1, 1, 3, 0, 0, -1681, 0,
+    -1679, 3, -1677, -1675, 1, 1, 0, 1, 0, 0, -1672, 1,
+    -1671, 0, 0, 1, -1666, 0, -1665, -1660, 0, -1656, -1655, 0,
+    -1654, 2, 3, -1653, 0, 0, -1652, 2, 0, 0, 0, 4,
+    -1649, 0, 5, 0, 2, -1648, -1647, 0, 3, -1640, 0, 1,
+    0, -1638, -1636, -1635, 0, 1, -1633, 4, 0, -1632, 1, 0,
+    3, 3, -1629, 0, -1626, 2, 2, 0, -1624, -1623, 5, 0,
+    1, 0, -1622, 0, 2, -1619, -1616, 2, 2, -1614, -1613, 1,
+    -1611, -1607, 1, 0, -1604, -1594, -1590, 4, 2, 0, 0, -1589,
+    0, -1588, 1, 2, 2, -1587, -1584, -1581, 0, 0, -1578, 0,
+    1, 0, 2, 5, -1571, 0, -1570, 1, 0, -1566, 0, -1565,
+    1, -1564, 3, 0, -1563, -1560, 0, 2, -1558, -1554, -1548, -1544,
+    0, 0, 0, -1539, 1, -1536, 0, 2, -1534, 1, -1533, -1529,
+    0, -1527, -1525, 2, 0, -1522, 1, -1520, -1513, -1508, -1505, -1504,
+    5, 0, 2, 0, 0, -1503, 0, -1502, -1499, 0, -1498, 2,
+    -1497, 0, -1493, 0, -1491, -1490, 3, 1, 0, 0, -1489, 0,
+    0, 0, 6, 2, 0, -1487, 0, 0, 1, -1486, 5, 1,
+    -1485, -1484, -1482, 0, -1477, 0, 0, 0, -1476, 2, 4, 1,
+    5, -1475, 0, 1, 0, -1471, 0, 1, -1465, 0, 1, 0,
+    0, 2, 1, 0, -1462, 4, 0, 0, -1461, -1453, 0, 0,
+    -1451, -1448, 4, -1446, -1440, 0, 0, 0, -1439, -1438, 0, -1436,
+    0, 1, 0, -1435, 1, 0, 1, -1433, 0, 1, 0, 0,
+    0, 0, 0, -1431, 0, 2, 3, 0, -1429, 0, 1, -1427,
+    2, 0, -1423, 0, -1421, 1, -1417, -1416, -1415, 1, -1412, -1411,
+    0, 0, -1409, -1408, -1407, 0, -1404, -1403, -1401, 3, 0, 0,
+    4, -1400, 3, -1399, 0, -1396, -1394, 0, 1, 0, -1389, 0,
+    0, 0, 0, 0, 7, 0, -1387, 1, 0, -1382, -1379, -1368,
+    2, -1367, -1362, 0, -1358, 0, 3, -1355, -1354, -1352, -1351, 1,
+    -1349, 1, -1347, 0, -1343, -1336, 2, 0, 3, -1334, 0, 0,
+    0, 0, -1333, 1, -1331, 0, 0, -1330, -1329, 0, -1328, 0,
+    0, 0, -1325, -1319, 1, -1316, 0, 0, -1308, -1307, -1302, -1301,
+    1, 0, 1, 0, -1300, -1294, -1293, -1292, 0, 0, 2, -1291,
+    0, -1289, 0, 1, 4, 5, -1285, 0, 2, 0, -1284, 5,
+    -1282, 2, 0, 2, 0, 4, -1281, 2, -1280, -1278, 0, 2,
+    1, -1276, 2, 5, 1, -1271, -1266, 2, 0, 0, -1263, -1260,
+    -1259, 0, -1258, -1250, 8, -1248, 1, 1, 0, 0, 0, -1232,
+    1, -1231, 0, 0, -1226, 0, 2, 1, 1, -1222, 1, 3,
+    0, 0, 0, -1219, 7, -1217, 0, 0, 0, 1, -1214, -1211,
+    0, 4, 0, -1208, 1, 0, 0, -1207, -1202, 0, 3, 1,
+    -1198, -1193, -1189, 0, 11, 0, 1, 6, -1182, 1, 0, -1179,
+    6, -1171, 0, 0, 0, -1165, 1, -1164, 0, 0, 0, 4,
+    -1163, -1162, -1155, -1152, 0, -1147, 0, 0, -1146, 1, -1144, -1139,
+    6, 1, 0, 0, 0, 2, 2, 0, -1138, 1, 0, 2,
+    -1137, 0, 1, 1, 0, -1136, -1127, 0, 0, 0, 0, -1125,
+    0, 0, -1124, 1, 8, -1123, -1121, 0, -1119, 0, -1112, -1110,
+    0, -1109, 0, -1108, 2, 2, 0, -1103, -1102, 3, -1101, 0,
+    -1100, 5, -1098, 0, -1097, -1096, 0, 1, 0, 0, 1, 0,
+    1, -1092, 0, 0, -1091, 0, -1088, 0, -1087, -1081, -1080, -1076,
+    1, 0, 1, 0, 0, -1074, -1070, 0, 1, -1068, -1067, 0,
+    -1065, 0, 0, -1062, -1059, -1058, 0, 0, -1054, 0, -1053, 0,
+    -1051, 0, -1044, 0, 3, 1, -1041, 0, -1040, -1033, 1, -1032,
+    3, 1, 2, -1031, -1030, -1027, -1024, -1022, 0, -1021, 0, -1019,
+    0, 0, -1018, 0, -1015, -1014, 0, 5, 0, -1013, 0, 0,
+    -1005, 0, -1004, 0, 1, 1, 0, 1, 0, -995, 10, 3,
+    0, 0, 3, 0, 0, 1, 0, -992, 0, 1, 0, 0,
+    0, 3, 0, -988, 0, -982, -980, 2, -978, -974, 4, 0,
+    -970, 1, -966, 2, 0, -963, -962, -953, 6, 0, 1, 2,
+    -951, 3, -950, -949, 0, 1, 2, -947, -945, 2, -943, 0,
+    -940, -938, 3, -936, 3, 1, -934, 0, 0, -922, 0, -921,
+    -919, 0, 0, -914, -913, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 2, 0, 1, -912, -911, -906, 0, -902, -901, -895,
+    4, -894, -892, -888, 6, 0, 1, 0, -886, 0, 0, 2,
+    2, 0, 0, 1, 1, -885, 0, 11, -881, 0, 1, 0,
+    0, 0, 1, 5, 0, 1, 2, -880, 1, -878, -876, 0,
+    6, 0, 0, 1, 0, -875, 0, -874, 4, 1, -873, 0,
+    0, 3, 1, 1, 0, 0, -869, -864, 0, 1, 0, 0,
+    -857, 0, 0, -853, -849, 0, -848, 2, 0, -846, -844, -841,
+    -840, 2, 0, 0, 7, -837, -835, -834, 4, 8, 0, -833,
+    2, -832, 2, -827, 0, 9, 0, -825, 3, 5, 0, -821,
+    0, 0, 0, -818, 3, 0, -816, 0, 5, 0, 1, 2,
+    0, 3, -814, 0, -812, -810, 1, 2, 0, 1, -809, -805,
+    2, 0, 0, -804, -794, 0, 1, -792, 1, -790, 0, -786,
+    0, -782, 0, 5, -778, 0, -775, -774, 0, -772, 1, 1,
+    2, 0, 3, -770, 1, 0, 2, -769, 0, 0, 0, -768,
+    -766, 0, 0, -762, 0, 2, -759, -757, 7, 3, -756, -751,
+    -748, 0, 0, 1, -746, -740, 0, 0, -738, 6, -733, 0,
+    -732, 1, 8, 3, -730, 2, 0, -729, -726, 4, 0, -723,
+    0, 0, 3, -721, 1, 0, -718, 2, 1, 1, 1, 1,
+    -717, 1, 2, -716, 0, -715, 0, 0, 0, 21, -711, -710,
+    0, 1, -708, 0, 0, 0, 0, -705, 2, 0, 5, -701,
+    -698, 0, 0, -688, 0, 0, 0, -686, 1, -685, 0, 0,
+    2, -683, 0, 0, -678, 1, -676, 0, 1, 0, 2, 0,
+    -675, -674, -671, -669, 0, 4, -665, 6, -664, 0, -663, 1,
+    3, -660, 4, 1, 0, -655, 1, -649, 0, 0, -648, 0,
+    0, 1, 3, 0, -646, 11, 0, 0, 0, 8, 2, -645,
+    -643, 0, 1, -642, -641, -639, 0, 1, 0, 0, -638, 1,
+    8, 0, -637, 5, 0, 0, -635, -632, -631, 1, -627, -626,
+    0, -625, 2, 0, -619, 3, 0, -618, 0, 0, -615, -614,
+    1, -610, 8, 0, 0, -607, 0, 0, 3, 0, 21, 3,
+    2, 0, -603, 0, 0, 0, 0, -601, 5, 1, -600, -598,
+    -597, 0, 0, 1, -596, 1, 1, -590, 0, 0, -588, 0,
+    0, 0, 0, -587, 0, 6, 10, 0, -586, 0, 0, 0,
+    -584, -582, 0, -579, -573, -566, 0, 1, 4, -565, 3, 2,
+    0, -562, 0, -560, -559, -557, -556, 0, 0, -550, 2, 6,
+    2, 11, -549, 0, 0, 0, 4, 0, 1, 1, 0, 1,
+    3, 9, -548, -547, -542, 5, -538, 5, 0, -536, 1, -533,
+    2, 1, 1, 0, -532, 0, -531, 9, 1, 0, 0, -530,
+    -529, -526, 0, -524, 11, 5, -523, 2, 0, -522, 0, 0,
+    0, -521, 8, -516, -513, 0, 3, -512, -504, 0, -501, 0,
+    -498, 0, -495, 7, 0, 2, 21, 0, 1, 0, 0, 0,
+    0, -492, 0, -489, -485, 0, 5, 0, -483, 0, 0, 2,
+    1, -482, -479, 0, 0, 0, 9, 0, -476, 0, 0, 0,
+    0, 0, -475, 4, -473, 1, -470, 3, 3, -465, -464, 4,
+    -460, -459, 6, 0, -452, 0, -450, -447, 0, 0, -441, 9,
+    -440, -439, -438, 3, 0, 0, 0, 0, -435, 0, 0, -430,
+    0, 0, 8, 0, -429, 0, -428, -427, 0, 2, 3, -422,
+    0, 3, -417, -416, 16, 0, 0, -414, -413, -411, -410, -406,
+    0, -402, 0, -397, 0, 0, -391, 2, 4, -389, -388, 1,
+    -386, -385, 7, -382, -376, 0, -374, 2, 0, 0, 1, -372,
+    -371, 0, 0, -369, -365, -364, 0, 0, 1, 0, -360, 4,
+    -357, 2, 0, -354, -353, -351, -346, 0, -344, 0, 0, 0,
+    -336, -335, 1, -334, 0, 0, -330, 0, 0, 0, 7, 0,
+    0, 3, 1, 2, -329, 0, 0, 0, 8, 3, 0, -327,
+    0, 6, -321, -319, -317, 0, 5, 1, 0, 0, 8, -315,
+    0, 0, 0, 1, -314, 14, 0, -312, -311, -310, 1, 0,
+    -305, -302, -297, -291, 1, -289, 1, 17, 0, 0, -288, 3,
+    -282, -281, -278, -276, 5, 0, 4, 0, -274, 1, 0, -268,
+    0, 1, 4, 0, 4, 0, -267, 8, 0, 0, 1, -266,
+    0, -262, 18, 22, 4, -261, 10, 22, 8, 0, 0, -258,
+    0, 0, 4, -256, -254, 0, 9, 12, 0, -253, 0, -249,
+    -248, 0, 1, 0, 0, -246, 0, 0, -244, -242, -236, 2,
+    -235, -234, 21, -232, 0, 2, 0, 12, 7, 5, 4, 8,
+    0, -231, -230, -228, 0, -227, 0, -226, -219, 0, -218, 0,
+    29, 1, 8, 0, 0, 5, 1, 0, 1, 0, 0, 0,
+    0, 1, -208, 0, -207, 0, 0, 0, -199, -193, -191, -189,
+    10, 0, 7, -186, 2, -182, 0, 16, -180, 0, -178, 5,
+    -175, -173, -170, -168, 0, 0, -167, 0, 0, 2, -166, -163,
+    -162, 23, -161, 0, -157, 0, -147, -143, 0, 1, 0, -142,
+    0, 0, -140, 0, 0, 1, 0, 30, -138, 0, 3, 0,
+    0, 0, 13, 0, 0, 7, -136, 0, 0, 0, 0, 4,
+    19, -135, 5, 0, -133, 0, -132, 0, 8, 23, 6, 0,
+    0, -129, 5, -128, 6, 0, 2, 0, -123, -121, 0, 2,
+    0, 1, 0, -116, 1, -115, 0, 0, 0, 0, -114, 0,
+    -112, -107, 0, -105, -104, 0, 0, 4, 0, 0, 0, 7,
+    4, -99, 0, -97, -87, -86, 6, -81, -80, -79, 0, 0,
+    0, -77, 0, -76, -58, 0, 2, -54, 0, -52, -50, 1,
+    0, 0, -49, -43, -40, 0, -29, -26, 1, 0, 0, -22,
+    -17, 6, 3, -15, 0, 2, 3, -14, 0, 5, -4, 3,
+    4, 3, 1, 0, 0, 0, 1
+};
+
+static const unsigned short entity_slot[ENTITY_COUNT] = {
+    1027, 583, 115, 1672, 1062, 849, 851, 600, 2049, 234, 1917, 1331,
+    1071, 416, 1792, 1912, 1134, 1962, 742, 1177, 1802, 870, 2079, 630,
+    1700, 756, 1787, 432, 743, 205, 436, 1258, 508, 1278, 1798, 113,
+    473, 1495, 1083, 1462, 1408, 1770, 1262, 1619, 437, 428, 166, 1954,
+    788, 1326, 2018, 241, 430, 293, 1692, 644, 2087, 907, 1287, 534,
+    1113, 1057, 1173, 1020, 1304, 1154, 1319, 654, 1906, 191, 1468, 1934,
+    1493, 1122, 1415, 919, 30, 1470, 256, 1531, 2113, 848, 2100, 1028,
+    1106, 1594, 815, 1432, 1666, 456, 251, 1577, 1441, 1784, 1562, 1174,
+    575, 1040, 507, 1861, 2010, 185, 398, 1396, 1487, 345, 1104, 1811,
+    470, 573, 1523, 661, 2060, 309, 1574, 1437, 138, 2116, 1372, 301,
+    1678, 1096, 983, 1952, 1568, 1993, 496, 1768, 79, 1835, 524, 672,
+    2106, 942, 1707, 897, 865, 1314, 107, 1095, 1041, 390, 1406, 235,
+    268, 1065, 1578, 910, 1022, 101, 37, 1525, 797, 1512, 881, 929,
+    53, 1239, 765, 218, 1446, 1183, 314, 791, 299, 1733, 1004, 736,
+    1968, 1515, 479, 215, 2105, 1213, 2017, 606, 702, 1397, 1303, 845,
+    18, 342, 252, 90, 460, 3, 122, 1519, 1640, 844, 1100, 1758,
+    905, 1116, 1508, 480, 1860, 476, 1901, 1456, 487, 1813, 1716, 1091,
+    459, 749, 621, 1937, 1862, 1271, 1114, 60, 789, 1066, 161, 1244,
+    1059, 332, 721, 1139, 167, 444, 1848, 532, 843, 1674, 1293, 1337,
+    1124, 607, 555, 1011, 347, 203, 1085, 369, 548, 1407, 1996, 337,
+    1919, 117, 619, 149, 1685, 1983, 878, 1818, 1686, 225, 71, 410,
+    533, 698, 1988, 527, 923, 343, 1068, 1194, 2120, 582, 484, 1884,
+    991, 2084, 1342, 798, 1069, 1290, 934, 617, 1944, 39, 1044, 284,
+    1664, 712, 993, 164, 2112, 7, 1483, 464, 835, 1274, 779, 750,
+    1920, 1428, 792, 451, 378, 1148, 43, 1894, 1393, 1898, 1896, 193,
+    1308, 87, 1725, 423, 543, 908, 1203, 588, 689, 1593, 329, 1731,
+    1141, 1101, 776, 894, 1132, 1645, 2097, 2121, 339, 1147, 514, 626,
+    1791, 321, 55, 1570, 1881, 85, 1219, 693, 22, 1366, 804, 465,
+    707, 313, 440, 720, 1017, 783, 2028, 1747, 120, 869, 1180, 1076,
+    709, 64, 2061, 1286, 1777, 1845, 1425, 547, 1296, 679, 1602, 177,
+    2005, 780, 485, 1108, 1489, 1452, 2059, 1998, 481, 1496, 999, 381,
+    1430, 44, 260, 569, 289, 1417, 664, 114, 1155, 1982, 1364, 1723,
+    207, 1915, 1711, 2006, 1107, 517, 969, 570, 1269, 1275, 1176, 1537,
+    1245, 450, 1395, 1576, 132, 1241, 308, 12, 1809, 1206, 1659, 93,
+    65, 139, 1056, 198, 66, 1123, 1284, 1457, 639, 1358, 1459, 1943,
+    1030, 1560, 359, 488, 1816, 1162, 1078, 1743, 142, 1994, 1522, 1042,
+    1945, 1246, 1530, 1436, 2039, 643, 785, 2012, 385, 1941, 1353, 441,
+    1620, 1165, 2086, 1224, 1356, 111, 1834, 1827, 231, 1905, 1627, 598,
+    1369, 1259, 1842, 1575, 1877, 1950, 126, 1684, 1633, 1339, 1410, 1,
+    72, 1475, 1046, 1399, 1904, 153, 1443, 1948, 1797, 888, 754, 979,
+    210, 1435, 988, 1461, 719, 1518, 1703, 2001, 2126, 613, 884, 830,
+    2128, 412, 565, 1715, 1984, 1713, 2035, 171, 860, 608, 1295, 23,
+    648, 2104, 766, 1762, 1009, 1794, 594, 352, 1045, 1090, 1840, 1424,
+    1313, 1467, 50, 348, 287, 1207, 163, 46, 9, 318, 558, 676,
+    1075, 1438, 453, 1604, 796, 1079, 1681, 186, 1991, 1557, 1306, 2127,
+    365, 805, 1237, 883, 2023, 182, 1252, 269, 811, 1958, 1992, 522,
+    1266, 902, 1089, 726, 2009, 246, 211, 1511, 344, 1321, 1472, 1460,
+    985, 744, 1929, 1690, 568, 1024, 140, 861, 49, 1391, 1907, 67,
+    790, 1779, 1855, 24, 16, 118, 467, 325, 945, 2123, 1543, 1971,
+    1144, 1706, 1851, 1312, 258, 1001, 2055, 2111, 1618, 384, 38, 1642,
+    374, 21, 931, 1379, 130, 506, 1807, 984, 2021, 495, 1997, 261,
+    538, 960, 1300, 102, 1544, 1938, 335, 103, 1370, 355, 994, 552,
+    943, 143, 695, 230, 1382, 1623, 1637, 927, 1573, 821, 1960, 2108,
+    1198, 1405, 500, 932, 1163, 61, 967, 1232, 562, 327, 425, 1234,
+    1185, 2051, 1793, 1186, 33, 682, 1260, 1614, 1774, 1442, 718, 1048,
+    1120, 34, 1850, 618, 1052, 271, 266, 996, 1329, 1012, 2118, 836,
+    1365, 2, 762, 828, 1946, 187, 1006, 5, 447, 1448, 972, 1804,
+    1034, 1698, 1776, 760, 2022, 2119, 175, 1486, 1874, 1197, 2044, 357,
+    995, 1916, 710, 411, 1873, 1553, 1608, 891, 243, 530, 1507, 150,
+    2029, 1547, 751, 400, 1214, 1754, 1900, 2052, 1152, 1341, 1067, 708,
+    501, 1974, 399, 1103, 915, 589, 1973, 1704, 825, 992, 1569, 1959,
+    98, 1819, 611, 1853, 2094, 1465, 1781, 564, 1875, 1451, 1049, 81,
+    1647, 376, 813, 1444, 1453, 2107, 1118, 1829, 1680, 1276, 1909, 1808,
+    2062, 1583, 2016, 505, 690, 1268, 612, 691, 1746, 663, 539, 675,
+    634, 954, 624, 1780, 1514, 448, 99, 438, 1671, 1591, 420, 389,
+    1736, 793, 1088, 62, 1702, 898, 1765, 267, 310, 1893, 1307, 886,
+    998, 1072, 474, 556, 1340, 233, 121, 461, 333, 579, 1660, 324,
+    1402, 492, 1892, 1688, 1636, 1766, 1947, 1540, 537, 1584, 152, 8,
+    1250, 1775, 1513, 1386, 1806, 1420, 977, 135, 738, 1879, 1913, 1732,
+    1505, 1639, 1985, 91, 1748, 671, 1572, 1026, 1170, 1414, 841, 78,
+    1739, 1790, 2081, 1111, 853, 1742, 189, 2063, 47, 110, 885, 2122,
+    2075, 1053, 716, 1923, 466, 2007, 863, 116, 292, 28, 1226, 75,
+    1821, 1211, 1838, 1055, 1229, 1297, 1238, 486, 2048, 1963, 1128, 443,
+    1330, 433, 1676, 900, 687, 1320, 364, 572, 1168, 25, 729, 1506,
+    978, 976, 1158, 311, 2058, 1010, 1412, 1003, 1670, 2056, 2130, 610,
+    958, 169, 714, 899, 2088, 405, 509, 1586, 413, 912, 962, 666,
+    1969, 704, 45, 578, 819, 51, 160, 909, 306, 1376, 1589, 1764,
+    15, 445, 1824, 1836, 833, 133, 200, 422, 890, 1390, 439, 1292,
+    322, 350, 859, 391, 1595, 1683, 1999, 1332, 1588, 192, 1872, 1782,
+    1673, 1135, 1050, 862, 660, 401, 1965, 1277, 1043, 502, 1497, 1309,
+    1882, 656, 937, 250, 263, 510, 1169, 1351, 806, 939, 587, 1500,
+    1000, 1335, 602, 2008, 1542, 1167, 20, 1378, 1191, 334, 1869, 837,
+    866, 807, 458, 597, 1635, 323, 242, 366, 593, 1799, 586, 1051,
+    1596, 1133, 1136, 670, 1744, 521, 280, 296, 540, 1532, 361, 127,
+    2083, 614, 14, 629, 1830, 295, 1471, 213, 264, 1607, 1717, 2043,
+    871, 1895, 494, 879, 1687, 1625, 1930, 701, 681, 1667, 1856, 914,
+    1610, 1864, 911, 847, 302, 545, 491, 426, 272, 2003, 1587, 173,
+    1087, 1849, 1310, 1225, 697, 188, 1195, 571, 965, 312, 1060, 84,
+    1521, 590, 1956, 1031, 703, 1212, 1887, 328, 184, 922, 595, 147,
+    1921, 928, 567, 1130, 1689, 2057, 1324, 980, 852, 1127, 872, 887,
+    288, 896, 1783, 105, 2095, 190, 1616, 1918, 1289, 1061, 483, 1036,
+    129, 2076, 209, 1942, 1317, 2034, 1231, 1751, 1536, 1243, 1362, 170,
+    449, 625, 1073, 1933, 1458, 1579, 655, 1228, 1222, 903, 403, 1539,
+    1385, 146, 1752, 737, 48, 1279, 1888, 1280, 435, 282, 1179, 1270,
+    1138, 1474, 544, 330, 73, 1926, 19, 406, 281, 829, 1175, 574,
+    1814, 358, 76, 659, 700, 1705, 1394, 653, 434, 305, 2015, 550,
+    40, 1440, 360, 997, 733, 503, 221, 2109, 1105, 294, 1503, 1810,
+    2070, 220, 810, 1981, 497, 370, 1925, 1939, 1323, 2026, 165, 705,
+    1383, 665, 482, 63, 559, 96, 2027, 1564, 633, 1074, 827, 1720,
+    2091, 1251, 2033, 1248, 1615, 2024, 240, 151, 1221, 131, 1803, 1502,
+    1137, 913, 1499, 247, 253, 511, 694, 341, 1753, 1630, 561, 921,
+    1363, 1121, 156, 1613, 1769, 80, 1157, 758, 2040, 646, 100, 442,
+    1084, 1208, 41, 375, 95, 1403, 1149, 1825, 259, 520, 1404, 938,
+    882, 1961, 1980, 1870, 394, 274, 222, 1494, 1599, 206, 273, 1281,
+    1242, 1334, 1867, 2031, 745, 478, 1632, 940, 1423, 1612, 647, 874,
+    1081, 801, 1125, 1099, 136, 340, 1694, 1478, 968, 1714, 1249, 97,
+    1710, 553, 918, 581, 89, 1008, 840, 1016, 1450, 475, 1227, 1305,
+    1354, 418, 1617, 724, 1648, 1858, 468, 1261, 319, 1986, 1757, 196,
+    950, 1737, 1202, 1786, 1230, 1360, 1080, 1534, 1922, 1729, 1038, 775,
+    419, 427, 1665, 518, 245, 1663, 1392, 764, 1634, 1696, 1839, 546,
+    232, 645, 1256, 1801, 823, 1805, 1387, 197, 1603, 1740, 1063, 1831,
+    1669, 1526, 1785, 320, 982, 1582, 1550, 2036, 1967, 803, 1697, 490,
+    276, 249, 201, 2014, 1240, 469, 57, 1772, 17, 876, 1367, 944,
+    1773, 1847, 856, 1433, 730, 2047, 2030, 817, 948, 1093, 1025, 1621,
+    1889, 1160, 1977, 88, 2025, 1935, 649, 180, 1416, 208, 635, 1054,
+    748, 1419, 1484, 104, 986, 265, 1675, 1233, 867, 2000, 331, 1236,
+    238, 1455, 1759, 808, 1976, 651, 818, 1047, 1086, 10, 1865, 2004,
+    951, 1449, 1384, 2019, 0, 657, 2042, 317, 1738, 542, 1644, 1795,
+    1628, 1719, 1201, 1910, 35, 1426, 1528, 2129, 388, 224, 1778, 1949,
+    1189, 735, 786, 1445, 1554, 393, 1151, 933, 1102, 784, 408, 1480,
+    603, 239, 1389, 1718, 1037, 1652, 658, 137, 1388, 2073, 1822, 1548,
+    1439, 217, 1741, 1171, 1763, 159, 1361, 1866, 1348, 531, 1611, 519,
+    1846, 383, 1398, 386, 31, 1597, 1972, 278, 1878, 1338, 2069, 1735,
+    291, 1951, 864, 1215, 2072, 755, 846, 529, 1344, 1501, 2078, 1204,
+    1815, 1110, 1285, 1903, 2068, 746, 270, 673, 1359, 1294, 1481, 2074,
+    1649, 685, 2046, 1890, 362, 262, 636, 1473, 795, 1693, 1401, 1145,
+    650, 1566, 599, 2125, 516, 773, 1375, 158, 2054, 1164, 257, 1533,
+    1724, 1371, 1187, 1142, 623, 1668, 2089, 1605, 27, 463, 1282, 778,
+    2092, 592, 1343, 421, 1143, 560, 1629, 1701, 901, 42, 1377, 1082,
+    667, 1223, 1979, 959, 1153, 1527, 1655, 989, 68, 504, 1349, 367,
+    1767, 145, 842, 1964, 26, 875, 1914, 1247, 953, 947, 1422, 941,
+    1516, 1477, 32, 2082, 1691, 392, 1327, 920, 2066, 774, 86, 1989,
+    822, 54, 1600, 1273, 373, 1196, 1413, 283, 990, 638, 1832, 1159,
+    584, 711, 307, 1156, 1018, 1263, 1220, 1311, 228, 591, 557, 688,
+    1712, 1490, 372, 414, 1987, 632, 402, 1788, 1315, 761, 577, 1205,
+    219, 549, 300, 123, 462, 1955, 1200, 1097, 74, 541, 236, 1333,
+    285, 1756, 1899, 916, 1643, 499, 956, 1609, 1510, 248, 154, 814,
+    812, 1990, 1559, 1070, 1482, 1682, 1966, 1978, 195, 2013, 2002, 641,
+    1658, 356, 1883, 363, 36, 782, 1014, 1374, 194, 1409, 772, 1638,
+    229, 1058, 930, 125, 2099, 713, 1545, 1622, 741, 1897, 6, 1357,
+    1092, 2064, 493, 1761, 1859, 722, 1466, 1626, 1190, 1257, 1318, 605,
+    1601, 2041, 727, 404, 889, 855, 2114, 106, 1216, 457, 1936, 1823,
+    1555, 1606, 627, 513, 2065, 723, 407, 237, 1789, 377, 800, 1654,
+    1843, 1109, 275, 1940, 604, 1192, 1931, 199, 906, 1272, 924, 975,
+    1218, 1119, 1380, 964, 917, 731, 1880, 1546, 1150, 1624, 809, 1826,
+    1210, 2071, 134, 554, 1837, 1563, 1504, 431, 1182, 787, 2101, 13,
+    1488, 2110, 29, 58, 1679, 858, 2102, 669, 1871, 715, 298, 1352,
+    286, 2053, 176, 254, 1886, 1902, 580, 1800, 2096, 1517, 395, 353,
+    379, 1641, 227, 477, 141, 338, 706, 498, 678, 1760, 1267, 1021,
+    1199, 1434, 971, 1699, 1023, 108, 831, 172, 1217, 824, 1427, 961,
+    826, 1454, 1653, 974, 1265, 1817, 52, 1325, 1891, 1552, 178, 70,
+    1828, 1932, 1749, 1677, 732, 1520, 816, 83, 1529, 409, 1368, 868,
+    1833, 525, 1796, 1657, 1429, 1995, 963, 767, 1184, 717, 1193, 471,
+    1571, 725, 699, 955, 2085, 1590, 662, 1646, 144, 1535, 351, 832,
+    2038, 1013, 2032, 1863, 585, 957, 1005, 563, 622, 686, 615, 226,
+    489, 1322, 1115, 1876, 1350, 794, 183, 1721, 1166, 336, 926, 11,
+    696, 1476, 368, 536, 2011, 216, 752, 1302, 1868, 740, 834, 952,
+    1561, 1854, 799, 179, 987, 1039, 628, 1033, 1098, 417, 244, 2045,
+    857, 1288, 880, 454, 981, 1975, 202, 1347, 1722, 1209, 162, 168,
+    620, 1567, 59, 77, 1585, 2093, 429, 1841, 326, 2098, 1345, 1328,
+    212, 904, 781, 277, 181, 2067, 566, 455, 652, 290, 1857, 2077,
+    112, 1355, 877, 1019, 304, 739, 1661, 56, 1708, 770, 2080, 2050,
+    769, 1283, 1117, 528, 854, 1728, 316, 637, 1015, 1188, 1953, 315,
+    1373, 1750, 1161, 759, 1469, 631, 297, 1592, 596, 1421, 1924, 609,
+    371, 2124, 1029, 1007, 396, 204, 1131, 1464, 1418, 354, 1112, 1631,
+    1253, 2090, 526, 1957, 1140, 892, 523, 1172, 119, 1298, 1479, 677,
+    1820, 1844, 92, 1463, 838, 1411, 1771, 2037, 2115, 2020, 157, 214,
+    1650, 279, 777, 1656, 551, 683, 936, 1316, 684, 674, 1970, 148,
+    2103, 692, 668, 1565, 820, 946, 1549, 1381, 349, 1235, 1146, 1755,
+    1812, 1291, 601, 446, 1035, 1524, 1538, 1885, 174, 472, 753, 1126,
+    1492, 1558, 1908, 1129, 1346, 82, 1178, 1064, 1551, 1299, 415, 1301,
+    303, 734, 763, 1336, 1509, 768, 382, 1491, 1002, 1662, 935, 1181,
+    1077, 1734, 535, 515, 747, 387, 397, 1485, 839, 873, 1032, 346,
+    949, 895, 640, 802, 1695, 1581, 1726, 1447, 728, 757, 970, 1727,
+    94, 850, 512, 576, 69, 925, 616, 1094, 124, 973, 380, 642,
+    452, 771, 1254, 1928, 680, 1651, 1255, 1852, 1730, 1431, 1400, 1709,
+    966, 424, 1911, 1927, 109, 1745, 1580, 1264, 1498, 4, 223, 255,
+    893, 128, 1556, 155, 1598, 1541, 2117
 };
+/* END GENERATED ENTITY HASH */
 
-static int
-entity_cmp(const void* p_key, const void* p_entity)
+/* Fails to compile if the hash is out of date. */
+typedef char entity_hash_is_current[
+    (sizeof(entity_table) / sizeof(entity_table[0]) == ENTITY_COUNT) ? 1 : -1];
+
+static unsigned
+entity_hash(unsigned seed, const char* name, size_t name_size)
 {
-    struct entity_key* key = (struct entity_key*) p_key;
-    struct entity* ent = (struct entity*) p_entity;
+    unsigned hash = (seed != 0 ? seed : 0x01000193);
+    size_t i;
 
-    return strncmp(key->name, ent->name, key->name_size);
+    for(i = 0; i < name_size; i++)
+        hash = (hash * 0x01000193) ^ (unsigned char) name[i];
+    return hash;
 }
 
 const struct entity*
 entity_lookup(const char* name, size_t name_size)
 {
-    struct entity_key key = { name, name_size };
+    const struct entity* ent;
+    int d;
+
+    d = entity_displacement[entity_hash(0, name, name_size) % ENTITY_COUNT];
+    if(d < 0)
+        ent = &entity_table[entity_slot[-d - 1]];
+    else
+        ent = &entity_table[entity_slot[entity_hash(d, name, name_size) % ENTITY_COUNT]];
 
-    return bsearch(&key,
-                   entity_table,
-                   sizeof(entity_table) / sizeof(entity_table[0]),
-                   sizeof(struct entity),
-                   entity_cmp);
+    if(strncmp(ent->name, name, name_size) != 0  ||  ent->name[name_size] != '\0')
+        return NULL;
+    return ent;
 }
@@ -0,0 +1,497 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/platform.h>
+#include <util/threading.h>
+#include <sys/stat.h>
+#include "file-watcher.h"
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#define FILE_WATCHER_INOTIFY
+#endif
+
+#define WAIT_INFINITE UINT64_MAX
+
+struct watch_dir {
+	char *path;
+	int wd;
+	long refs;
+};
+
+struct file_watch {
+	uint64_t id;
+	char *path;
+	const char *name;
+	struct watch_dir *dir;
+	uint64_t interval;
+	uint64_t next_poll;
+	uint64_t quiet;
+	uint64_t max_latency;
+	uint64_t first_event;
+	uint64_t last_event;
+	struct file_stamp stamp;
+	bool polled;
+	bool pending;
+	bool saved;
+	bool removed;
+	file_watch_cb callback;
+	void *param;
+};
+
+static struct {
+	pthread_t thread;
+	bool running;
+	volatile bool stop;
+	pthread_mutex_t mutex;
+	uint64_t next_id;
+	uint64_t suppressed;
+	struct file_watch *dispatching;
+	DARRAY(struct file_watch *) watches;
+	DARRAY(struct watch_dir *) dirs;
+#ifdef FILE_WATCHER_INOTIFY
+	int fd;
+	int wake[2];
+#else
+	os_event_t *wake;
+#endif
+} fw;
+
+void file_stamp_get(const char *path, struct file_stamp *stamp)
+{
+	memset(stamp, 0, sizeof(*stamp));
+#ifdef _WIN32
+	wchar_t *wpath = NULL;
+	if (!os_utf8_to_wcs_ptr(path, 0, &wpath))
+		return;
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	BOOL success = GetFileAttributesExW(wpath, GetFileExInfoStandard, &data);
+	bfree(wpath);
+	if (!success)
+		return;
+	stamp->exists = true;
+	stamp->mtime = (uint64_t)data.ftLastWriteTime.dwHighDateTime << 32 | data.ftLastWriteTime.dwLowDateTime;
+	stamp->size = (int64_t)data.nFileSizeHigh << 32 | data.nFileSizeLow;
+#else
+	struct stat stats;
+	if (os_stat(path, &stats) != 0)
+		return;
+	stamp->exists = true;
+	stamp->inode = (uint64_t)stats.st_ino;
+	stamp->size = (int64_t)stats.st_size;
+#ifdef __APPLE__
+	stamp->mtime = (uint64_t)stats.st_mtimespec.tv_sec * 1000000000 + (uint64_t)stats.st_mtimespec.tv_nsec;
+#else
+	stamp->mtime = (uint64_t)stats.st_mtim.tv_sec * 1000000000 + (uint64_t)stats.st_mtim.tv_nsec;
+#endif
+#endif
+}
+
+static void file_watcher_wake(void)
+{
+#ifdef FILE_WATCHER_INOTIFY
+	if (fw.wake[1] >= 0) {
+		char c = 0;
+		ssize_t written = write(fw.wake[1], &c, 1);
+		UNUSED_PARAMETER(written);
+	}
+#else
+	if (fw.wake)
+		os_event_signal(fw.wake);
+#endif
+}
+
+#ifdef FILE_WATCHER_INOTIFY
+#define DIR_EVENTS (IN_CLOSE_WRITE | IN_MODIFY | IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE_SELF | IN_MOVE_SELF)
+
+static void watch_dir_add_native(struct watch_dir *dir)
+{
+	if (fw.fd < 0 || dir->wd >= 0)
+		return;
+	dir->wd = inotify_add_watch(fw.fd, dir->path, DIR_EVENTS | IN_ONLYDIR);
+}
+
+static void watch_dir_remove_native(struct watch_dir *dir)
+{
+	if (fw.fd >= 0 && dir->wd >= 0)
+		inotify_rm_watch(fw.fd, dir->wd);
+	dir->wd = -1;
+}
+#else
+static void watch_dir_add_native(struct watch_dir *dir)
+{
+	UNUSED_PARAMETER(dir);
+}
+
+static void watch_dir_remove_native(struct watch_dir *dir)
+{
+	UNUSED_PARAMETER(dir);
+}
+#endif
+
+static struct watch_dir *watch_dir_get(const char *path)
+{
+	for (size_t i = 0; i < fw.dirs.num; i++) {
+		struct watch_dir *dir = fw.dirs.array[i];
+		if (strcmp(dir->path, path) == 0) {
+			dir->refs++;
+			return dir;
+		}
+	}
+	struct watch_dir *dir = bzalloc(sizeof(struct watch_dir));
+	dir->path = bstrdup(path);
+	dir->wd = -1;
+	dir->refs = 1;
+	watch_dir_add_native(dir);
+	da_push_back(fw.dirs, &dir);
+	return dir;
+}
+
+static void watch_dir_release(struct watch_dir *dir)
+{
+	if (--dir->refs > 0)
+		return;
+	watch_dir_remove_native(dir);
+	da_erase_item(fw.dirs, &dir);
+	bfree(dir->path);
+	bfree(dir);
+}
+
+static inline bool file_watch_is_native(const struct file_watch *watch)
+{
+	return watch->dir && watch->dir->wd >= 0;
+}
+
+/* Events are collected until the file was quiet for a while, but a file that
+ * keeps changing is still dispatched after max_latency. A single save raises
+ * several events, only the one finishing it is passed as saved, so every save
+ * but the first of a burst counts as suppressed. */
+static void file_watch_mark(struct file_watch *watch, uint64_t now, bool saved)
+{
+	if (!watch->pending)
+		watch->first_event = now;
+	if (saved && watch->saved)
+		fw.suppressed++;
+	watch->saved = watch->saved || saved;
+	watch->last_event = now;
+	watch->pending = true;
+}
+
+static void file_watch_free(struct file_watch *watch)
+{
+	if (watch->dir)
+		watch_dir_release(watch->dir);
+	bfree(watch->path);
+	bfree(watch);
+}
+
+/* Stats every polled file whose interval elapsed, sharing one stat between
+ * watches of the same path, and returns the time until the next poll. */
+static uint64_t file_watcher_poll(uint64_t now)
+{
+	uint64_t wait = WAIT_INFINITE;
+	for (size_t i = 0; i < fw.watches.num; i++) {
+		struct file_watch *watch = fw.watches.array[i];
+		if (watch->dir && watch->dir->wd < 0) {
+			watch_dir_add_native(watch->dir);
+			if (watch->dir->wd >= 0)
+				file_watch_mark(watch, now, false);
+		}
+		if (file_watch_is_native(watch))
+			continue;
+		if (watch->next_poll > now) {
+			if (watch->next_poll - now < wait)
+				wait = watch->next_poll - now;
+			continue;
+		}
+
+		struct file_stamp stamp;
+		bool found = false;
+		for (size_t j = 0; j < i; j++) {
+			struct file_watch *other = fw.watches.array[j];
+			if (other->polled && other->next_poll > now && !file_watch_is_native(other) &&
+			    strcmp(other->path, watch->path) == 0) {
+				stamp = other->stamp;
+				found = true;
+				break;
+			}
+		}
+		if (!found)
+			file_stamp_get(watch->path, &stamp);
+
+		if (watch->polled && !file_stamp_equal(&stamp, &watch->stamp))
+			file_watch_mark(watch, now, true);
+		watch->stamp = stamp;
+		watch->polled = true;
+		watch->next_poll = now + watch->interval;
+		if (watch->interval < wait)
+			wait = watch->interval;
+	}
+	return wait;
+}
+
+/* Dispatches the watches whose events settled and returns the time until the
+ * next one is due. */
+static uint64_t file_watcher_dispatch(uint64_t now)
+{
+	uint64_t wait = WAIT_INFINITE;
+	DARRAY(uint64_t) ids;
+	da_init(ids);
+	for (size_t i = 0; i < fw.watches.num; i++) {
+		struct file_watch *watch = fw.watches.array[i];
+		if (!watch->pending)
+			continue;
+		uint64_t due = watch->last_event + watch->quiet;
+		if (due > watch->first_event + watch->max_latency)
+			due = watch->first_event + watch->max_latency;
+		if (due > now) {
+			if (due - now < wait)
+				wait = due - now;
+			continue;
+		}
+		watch->pending = false;
+		watch->saved = false;
+		da_push_back(ids, &watch->id);
+	}
+
+	for (size_t i = 0; i < ids.num; i++) {
+		struct file_watch *watch = NULL;
+		for (size_t j = 0; j < fw.watches.num; j++) {
+			if (fw.watches.array[j]->id == ids.array[i]) {
+				watch = fw.watches.array[j];
+				break;
+			}
+		}
+		if (!watch)
+			continue;
+		fw.dispatching = watch;
+		watch->callback(watch->param, watch->path);
+		fw.dispatching = NULL;
+		if (watch->removed)
+			file_watch_free(watch);
+	}
+	da_free(ids);
+	return wait;
+}
+
+#ifdef FILE_WATCHER_INOTIFY
+/* A write ends with IN_CLOSE_WRITE and a replace with IN_MOVED_TO, the
+ * IN_CREATE and IN_MODIFY before them belong to the same save. */
+#define SAVE_EVENTS (IN_CLOSE_WRITE | IN_MOVED_TO | IN_DELETE)
+
+static void file_watcher_mark_dir(int wd, const char *name, uint64_t now, bool saved)
+{
+	for (size_t i = 0; i < fw.watches.num; i++) {
+		struct file_watch *watch = fw.watches.array[i];
+		if (watch->dir && watch->dir->wd == wd && (!name || strcmp(watch->name, name) == 0))
+			file_watch_mark(watch, now, saved);
+	}
+}
+
+static void file_watcher_read_events(uint64_t now)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	for (;;) {
+		ssize_t len = read(fw.fd, buf, sizeof(buf));
+		if (len <= 0)
+			break;
+		for (char *ptr = buf; ptr < buf + len;) {
+			const struct inotify_event *event = (const struct inotify_event *)ptr;
+			ptr += sizeof(struct inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW) {
+				for (size_t i = 0; i < fw.watches.num; i++)
+					file_watch_mark(fw.watches.array[i], now, false);
+				continue;
+			}
+			if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+				/* The directory itself is gone, fall back to polling
+				 * until it can be watched again. */
+				file_watcher_mark_dir(event->wd, NULL, now, false);
+				for (size_t i = 0; i < fw.dirs.num; i++) {
+					if (fw.dirs.array[i]->wd == event->wd) {
+						if (event->mask & IN_IGNORED)
+							fw.dirs.array[i]->wd = -1;
+						else
+							watch_dir_remove_native(fw.dirs.array[i]);
+					}
+				}
+				continue;
+			}
+			if (event->len)
+				file_watcher_mark_dir(event->wd, event->name, now, (event->mask & SAVE_EVENTS) != 0);
+		}
+	}
+}
+
+static void file_watcher_wait(uint64_t wait)
+{
+	struct pollfd fds[2] = {{fw.fd, POLLIN, 0}, {fw.wake[0], POLLIN, 0}};
+	int timeout = wait == WAIT_INFINITE ? -1 : (int)((wait + 999999) / 1000000);
+	if (poll(fds, 2, timeout) <= 0)
+		return;
+	if (fds[1].revents & POLLIN) {
+		char buf[64];
+		while (read(fw.wake[0], buf, sizeof(buf)) > 0) {
+		}
+	}
+}
+#else
+static void file_watcher_wait(uint64_t wait)
+{
+	if (wait == WAIT_INFINITE)
+		os_event_wait(fw.wake);
+	else
+		os_event_timedwait(fw.wake, (unsigned long)((wait + 999999) / 1000000));
+}
+#endif
+
+static void *file_watcher_thread(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("markdown_file_watcher");
+	uint64_t wait = 0;
+	while (!fw.stop) {
+		file_watcher_wait(wait);
+		if (fw.stop)
+			break;
+		pthread_mutex_lock(&fw.mutex);
+		uint64_t now = os_gettime_ns();
+#ifdef FILE_WATCHER_INOTIFY
+		if (fw.fd >= 0)
+			file_watcher_read_events(now);
+#endif
+		wait = file_watcher_poll(now);
+		uint64_t due = file_watcher_dispatch(now);
+		if (due < wait)
+			wait = due;
+		pthread_mutex_unlock(&fw.mutex);
+	}
+	return NULL;
+}
+
+bool file_watcher_start(void)
+{
+	if (fw.running)
+		return true;
+	memset(&fw, 0, sizeof(fw));
+	if (pthread_mutex_init_recursive(&fw.mutex) != 0)
+		return false;
+#ifdef FILE_WATCHER_INOTIFY
+	fw.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fw.fd < 0)
+		blog(LOG_WARNING, "[markdown] inotify unavailable, polling files instead");
+	if (pipe(fw.wake) != 0) {
+		fw.wake[0] = fw.wake[1] = -1;
+	} else {
+		fcntl(fw.wake[0], F_SETFL, O_NONBLOCK);
+		fcntl(fw.wake[1], F_SETFL, O_NONBLOCK);
+	}
+#else
+	if (os_event_init(&fw.wake, OS_EVENT_TYPE_AUTO) != 0) {
+		pthread_mutex_destroy(&fw.mutex);
+		return false;
+	}
+#endif
+	fw.running = pthread_create(&fw.thread, NULL, file_watcher_thread, NULL) == 0;
+	return fw.running;
+}
+
+void file_watcher_stop(void)
+{
+	if (!fw.running)
+		return;
+	fw.stop = true;
+	file_watcher_wake();
+	pthread_join(fw.thread, NULL);
+	fw.running = false;
+
+	for (size_t i = 0; i < fw.watches.num; i++)
+		file_watch_free(fw.watches.array[i]);
+	da_free(fw.watches);
+	while (fw.dirs.num)
+		watch_dir_release(fw.dirs.array[0]);
+	da_free(fw.dirs);
+#ifdef FILE_WATCHER_INOTIFY
+	if (fw.fd >= 0)
+		close(fw.fd);
+	if (fw.wake[0] >= 0) {
+		close(fw.wake[0]);
+		close(fw.wake[1]);
+	}
+#else
+	os_event_destroy(fw.wake);
+#endif
+	pthread_mutex_destroy(&fw.mutex);
+}
+
+struct file_watch *file_watcher_add(const char *path, uint32_t poll_interval_ms, uint32_t quiet_ms, uint32_t max_latency_ms,
+				    file_watch_cb callback, void *param)
+{
+	if (!fw.running || !path || !*path)
+		return NULL;
+
+	struct file_watch *watch = bzalloc(sizeof(struct file_watch));
+	watch->path = bstrdup(path);
+	watch->interval = (uint64_t)(poll_interval_ms ? poll_interval_ms : 1) * 1000000;
+	watch->quiet = (uint64_t)quiet_ms * 1000000;
+	watch->max_latency = (uint64_t)(max_latency_ms > quiet_ms ? max_latency_ms : quiet_ms) * 1000000;
+	watch->callback = callback;
+	watch->param = param;
+	watch->pending = true;
+
+	const char *slash = strrchr(watch->path, '/');
+#ifdef _WIN32
+	const char *backslash = strrchr(watch->path, '\\');
+	if (backslash > slash)
+		slash = backslash;
+#endif
+	watch->name = slash ? slash + 1 : watch->path;
+
+	pthread_mutex_lock(&fw.mutex);
+	watch->id = ++fw.next_id;
+#ifdef FILE_WATCHER_INOTIFY
+	if (slash) {
+		char *dir = bstrdup_n(watch->path, slash == watch->path ? 1 : (size_t)(slash - watch->path));
+		watch->dir = watch_dir_get(dir);
+		bfree(dir);
+	} else {
+		watch->dir = watch_dir_get(".");
+	}
+#endif
+	da_push_back(fw.watches, &watch);
+	pthread_mutex_unlock(&fw.mutex);
+
+	file_watcher_wake();
+	return watch;
+}
+
+void file_watcher_remove(struct file_watch *watch)
+{
+	if (!watch)
+		return;
+	pthread_mutex_lock(&fw.mutex);
+	da_erase_item(fw.watches, &watch);
+	if (fw.dispatching == watch)
+		watch->removed = true;
+	else
+		file_watch_free(watch);
+	pthread_mutex_unlock(&fw.mutex);
+}
+
+uint64_t file_watcher_get_suppressed(void)
+{
+	if (!fw.running)
+		return 0;
+	pthread_mutex_lock(&fw.mutex);
+	uint64_t suppressed = fw.suppressed;
+	pthread_mutex_unlock(&fw.mutex);
+	return suppressed;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <util/c99defs.h>
+
+struct file_watch;
+
+/* mtime is in platform units, only meant for comparing */
+struct file_stamp {
+	bool exists;
+	uint64_t inode;
+	uint64_t mtime;
+	int64_t size;
+};
+
+void file_stamp_get(const char *path, struct file_stamp *stamp);
+
+static inline bool file_stamp_equal(const struct file_stamp *a, const struct file_stamp *b)
+{
+	return a->exists == b->exists && a->inode == b->inode && a->mtime == b->mtime && a->size == b->size;
+}
+
+typedef void (*file_watch_cb)(void *param, const char *path);
+
+bool file_watcher_start(void);
+void file_watcher_stop(void);
+
+/* The callback runs on the watcher thread, once right after the watch is
+ * added and again every time the file is (re)written, replaced or removed.
+ * poll_interval_ms is used when the file can not be watched natively.
+ * A burst of changes is dispatched once, after the file was left alone for
+ * quiet_ms or at the latest max_latency_ms after the first change. */
+struct file_watch *file_watcher_add(const char *path, uint32_t poll_interval_ms, uint32_t quiet_ms, uint32_t max_latency_ms,
+				    file_watch_cb callback, void *param);
+
+/* After this returns the callback is no longer running and will not be
+ * called again. */
+void file_watcher_remove(struct file_watch *watch);
+
+/* Number of saves that were merged into an already pending one, the events
+ * raised by one save count once. */
+uint64_t file_watcher_get_suppressed(void);
@@ -1,7 +1,12 @@
 #include <obs-module.h>
 #include "version.h"
 #include "md4c-html.h"
+#include "file-watcher.h"
+#include "block-cache.h"
+#include "render-worker.h"
+#include "hash.h"
 #include <util/dstr.h>
+#include <util/darray.h>
 #include <util/threading.h>
 #include <util/platform.h>
 #include <sys/stat.h>
@@ -13,17 +18,117 @@
 #define STYLE_CSS_FILE 1
 #define STYLE_SETTINGS 2
 
+#define MARKDOWN_PARSER_FLAGS (MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS)
+#define MARKDOWN_RENDERER_FLAGS 0
+
+#define MARKDOWN_BLOCK_CACHE_BUDGET (16 * 1024 * 1024)
+
+/* parser buffers sized for a document this much larger than the current one are released */
+#define MARKDOWN_TRIM_FACTOR 4
+#define MARKDOWN_TRIM_MIN_SIZE (64 * 1024)
+
+/* how long after the page is (re)loaded the whole document is sent again, at growing intervals */
+#define MARKDOWN_RESEND_NS 10000000000ULL
+#define MARKDOWN_RESEND_INTERVAL_NS 100000000ULL
+#define MARKDOWN_RESEND_MAX_INTERVAL_NS 1000000000ULL
+
+/* larger updates are split into a sequence of events */
+#define MARKDOWN_CHUNK_SIZE (1024 * 1024)
+
+struct markdown_file {
+	struct dstr path;
+	struct file_stamp stamp;
+	uint64_t hash;
+	struct file_watch *watch;
+	/* file contents are kept here instead of in the settings, guarded by the source's file_mutex */
+	char *text;
+};
+
+struct markdown_block {
+	uint64_t hash;
+	size_t end;
+	bool raw_html;
+};
+
+struct markdown_render {
+	struct dstr html;
+	/* while rendering with a context md4c appends right to the memory of html through out, see markdown_render_lend_html() */
+	MD_HTML_BUFFER out;
+	bool html_lent;
+	DARRAY(struct markdown_block) blocks;
+	bool raw_html;
+	bool block_raw_html;
+	const char *text;
+	uint64_t cache_key;
+	bool cache_pending;
+};
+
+/* the events of an update for the page, built by the render task and only sent by the graphics thread */
+struct markdown_update {
+	/* the events follow each other, each one terminated by a 0 */
+	struct dstr json;
+	DARRAY(size_t) events;
+	uint64_t base;
+	uint64_t version;
+	bool whole;
+	/* the whole document again, it does not change what the page shows */
+	bool resync;
+};
+
+/* what the page shows once the updates handed off are sent */
+struct markdown_sent {
+	DARRAY(uint64_t) blocks;
+	bool as_blocks;
+	uint64_t version;
+};
+
 struct markdown_source_data {
 	obs_source_t *source;
 	obs_source_t *browser;
-	struct dstr html;
-	struct dstr markdown_path;
-	time_t markdown_time;
-	struct dstr css_path;
-	time_t css_time;
-	pthread_t thread;
-	bool stop;
+	/* handed off lock-free: latest text to the worker, latest update back, and an update to reuse */
+	char *volatile pending_text;
+	struct markdown_update *volatile update;
+	struct markdown_update *volatile spare_update;
+	/* set by the graphics thread when the page needs the whole document */
+	volatile bool want_whole;
+	struct render_task task;
+	volatile long dropped;
+	/* parser and renderer buffers kept between renders, only used by the render task */
+	MD_HTML_CONTEXT *html_context;
+	size_t html_context_peak;
+	/* last text and its render, an edit of it only re-renders the blocks it touches, only used by the render task */
+	char *base_text;
+	size_t base_len;
+	struct markdown_render *base;
+	/* the render before base, reused for the next one */
+	struct markdown_render *spare;
+	struct markdown_render *part;
+	/* the updates are built against one of these, the other one is what the page showed before the last update */
+	struct markdown_sent sent[2];
+	int sent_index;
+	/* the event of an update being built */
+	size_t event_start;
+	size_t event_ops;
+	/* the update last sent, only used on the graphics thread */
+	struct markdown_update *last_update;
+	uint64_t resend_until;
+	uint64_t resend_interval;
+	uint64_t next_resend;
+	/* set when the browser reloads the page, only cleared on the graphics thread */
+	volatile bool page_reloaded;
+	/* css on the page, only used on the graphics thread, new css is handed off by update */
+	char *css_text;
+	char *volatile pending_css;
+	uint64_t css_hash;
+	/* reused for every event sent from the graphics thread */
+	struct dstr json;
+	struct calldata cd;
+	struct markdown_file markdown;
+	struct markdown_file css;
+	pthread_mutex_t file_mutex;
 	uint32_t sleep;
+	uint32_t debounce;
+	uint32_t max_latency;
 };
 
 static char encoding_table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J', 'K', 'L', 'M', 'N', 'O', 'P',
@@ -32,7 +137,7 @@ static char encoding_table[] = {'A', 'B', 'C', 'D', 'E', 'F', 'G', 'H', 'I', 'J'
 				'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'};
 static size_t mod_table[] = {0, 2, 1};
 
-char *base64_encode(const unsigned char *data, size_t input_length, size_t *output_length)
+static char *base64_encode(const unsigned char *data, size_t input_length, size_t *output_length)
 {
 
 	*output_length = 4 * ((input_length + 2) / 3);
@@ -69,8 +174,551 @@ static const char *markdown_source_name(void *type_data)
 
 static void markdown_source_add_html(const MD_CHAR *tag, MD_SIZE size, void *data)
 {
-	struct dstr *dstr = data;
-	dstr_ncat(dstr, tag, size);
+	struct markdown_render *r = data;
+	dstr_ncat(&r->html, tag, size);
+}
+
+/* saves a callback and a dstr_ncat for every tag and text run, html is only up to date after markdown_render_sync_html() */
+static void markdown_render_lend_html(struct markdown_render *r)
+{
+	r->out.data = r->html.array;
+	r->out.size = (MD_SIZE)r->html.len;
+	r->out.capacity = (MD_SIZE)r->html.capacity;
+	r->html_lent = true;
+}
+
+static void markdown_render_sync_html(struct markdown_render *r)
+{
+	if (!r->html_lent)
+		return;
+	r->html.array = r->out.data;
+	r->html.len = r->out.size;
+	r->html.capacity = r->out.capacity;
+}
+
+static void markdown_render_return_html(struct markdown_render *r)
+{
+	markdown_render_sync_html(r);
+	r->html_lent = false;
+}
+
+static size_t markdown_render_block_start(struct markdown_render *r, size_t idx)
+{
+	return idx ? r->blocks.array[idx - 1].end : 0;
+}
+
+static void markdown_source_add_block(MD_BLOCKTYPE type, void *data)
+{
+	UNUSED_PARAMETER(type);
+	struct markdown_render *r = data;
+	markdown_render_sync_html(r);
+	size_t start = markdown_render_block_start(r, r->blocks.num);
+	struct markdown_block *block = da_push_back_new(r->blocks);
+	block->end = r->html.len;
+	block->hash = hash64(r->html.array + start, block->end - start, 0);
+	block->raw_html = r->block_raw_html;
+	if (r->cache_pending) {
+		block_cache_put(r->cache_key, r->html.array + start, block->end - start, block->hash);
+		r->cache_pending = false;
+	}
+}
+
+/* Blocks are cached by their source and everything else their html depends on, so identical blocks are only rendered
+ * once across all sources. */
+static int markdown_source_top_level_block(MD_TOP_LEVEL_BLOCK_DETAIL *detail, void *data)
+{
+	struct markdown_render *r = data;
+	r->block_raw_html = detail->type == MD_BLOCK_HTML;
+	if (r->block_raw_html)
+		r->raw_html = true;
+	struct {
+		uint64_t source;
+		uint32_t layout;
+		uint32_t ref_defs;
+		uint32_t parser_flags;
+		uint32_t renderer_flags;
+	} key = {hash64(r->text + detail->beg, detail->end - detail->beg, 0), detail->layout_hash, detail->ref_defs_hash,
+		 MARKDOWN_PARSER_FLAGS, MARKDOWN_RENDERER_FLAGS};
+	r->cache_key = hash64(&key, sizeof(key), 0);
+
+	uint64_t hash;
+	markdown_render_sync_html(r);
+	if (block_cache_get(r->cache_key, &r->html, &hash)) {
+		struct markdown_block *block = da_push_back_new(r->blocks);
+		block->end = r->html.len;
+		block->hash = hash;
+		block->raw_html = r->block_raw_html;
+		detail->skip = true;
+	} else {
+		r->cache_pending = true;
+	}
+	if (r->html_lent)
+		markdown_render_lend_html(r);
+	return 0;
+}
+
+/* md4c allocates through libobs so its memory shows up in the leak tracking */
+static void *markdown_alloc(size_t size, void *userdata)
+{
+	UNUSED_PARAMETER(userdata);
+	return bmalloc(size);
+}
+
+static void *markdown_resize(void *ptr, size_t old_size, size_t new_size, void *userdata)
+{
+	UNUSED_PARAMETER(old_size);
+	UNUSED_PARAMETER(userdata);
+	return brealloc(ptr, new_size);
+}
+
+static void markdown_release(void *ptr, void *userdata)
+{
+	UNUSED_PARAMETER(userdata);
+	bfree(ptr);
+}
+
+static const MD_ALLOCATOR markdown_allocator = {markdown_alloc, markdown_resize, markdown_release, NULL};
+
+static struct markdown_render *markdown_render_create(void)
+{
+	struct markdown_render *r = bzalloc(sizeof(struct markdown_render));
+	dstr_init(&r->html);
+	r->out.allocator = &markdown_allocator;
+	da_init(r->blocks);
+	return r;
+}
+
+static void markdown_render_destroy(struct markdown_render *r)
+{
+	if (!r)
+		return;
+	dstr_free(&r->html);
+	da_free(r->blocks);
+	bfree(r);
+}
+
+static void markdown_render_reset(struct markdown_render *r, const char *text)
+{
+	/* keep the memory, md4c renders right into it again */
+	r->html.len = 0;
+	if (r->html.array)
+		r->html.array[0] = 0;
+	da_resize(r->blocks, 0);
+	r->raw_html = false;
+	r->block_raw_html = false;
+	r->text = text;
+	r->cache_pending = false;
+}
+
+static void markdown_render_markdown(struct markdown_render *r, MD_HTML_CONTEXT *context, const char *text, size_t len)
+{
+	markdown_render_reset(r, text);
+	if (context) {
+		markdown_render_lend_html(r);
+		md_html_context_set_buffer(context, &r->out);
+		md_html_blocks_in_context(context, text, (MD_SIZE)len, NULL, markdown_source_add_block,
+					  markdown_source_top_level_block, r, MARKDOWN_PARSER_FLAGS, MARKDOWN_RENDERER_FLAGS);
+		md_html_context_set_buffer(context, NULL);
+		markdown_render_return_html(r);
+	} else
+		md_html_blocks(text, (MD_SIZE)len, markdown_source_add_html, markdown_source_add_block,
+			       markdown_source_top_level_block, r, MARKDOWN_PARSER_FLAGS, MARKDOWN_RENDERER_FLAGS);
+	r->text = NULL;
+}
+
+/* the edit turning the old text into the new one, as the range between their common prefix and suffix */
+static MD_EDIT markdown_find_edit(const char *old_text, size_t old_len, const char *text, size_t len)
+{
+	size_t max = old_len < len ? old_len : len;
+	size_t prefix = 0;
+	size_t suffix = 0;
+	while (prefix < max && old_text[prefix] == text[prefix])
+		prefix++;
+	while (suffix < max - prefix && old_text[old_len - 1 - suffix] == text[len - 1 - suffix])
+		suffix++;
+	MD_EDIT edit = {(MD_OFFSET)prefix, (MD_SIZE)(old_len - prefix - suffix), (MD_SIZE)(len - prefix - suffix)};
+	return edit;
+}
+
+/* r gets the blocks of base before the edit, the re-rendered blocks of part and the blocks of base behind the edit. r
+ * holds an earlier render, the blocks at its start that base still has are left where they are. */
+static void markdown_render_splice(struct markdown_render *r, struct markdown_render *base, struct markdown_render *part,
+				   const MD_REPARSE_INFO *info)
+{
+	size_t first = info->first_block;
+	size_t last = first + info->old_block_count;
+	size_t start = markdown_render_block_start(base, first);
+	size_t old_end = markdown_render_block_start(base, last);
+	size_t new_end = start + part->html.len;
+	size_t tail = base->html.len - old_end;
+
+	size_t keep = 0;
+	while (keep < first && keep < r->blocks.num && r->blocks.array[keep].hash == base->blocks.array[keep].hash &&
+	       r->blocks.array[keep].end == base->blocks.array[keep].end)
+		keep++;
+	size_t kept = markdown_render_block_start(base, keep);
+
+	dstr_ensure_capacity(&r->html, new_end + tail + 1);
+	memcpy(r->html.array + kept, base->html.array + kept, start - kept);
+	if (part->html.len)
+		memcpy(r->html.array + start, part->html.array, part->html.len);
+	memcpy(r->html.array + new_end, base->html.array + old_end, tail);
+	r->html.len = new_end + tail;
+	r->html.array[r->html.len] = 0;
+
+	size_t num = first + part->blocks.num + base->blocks.num - last;
+	da_resize(r->blocks, num);
+	struct markdown_block *block = r->blocks.array + keep;
+	for (size_t i = keep; i < first; i++)
+		*block++ = base->blocks.array[i];
+	for (size_t i = 0; i < part->blocks.num; i++, block++) {
+		*block = part->blocks.array[i];
+		block->end += start;
+	}
+	for (size_t i = last; i < base->blocks.num; i++, block++) {
+		*block = base->blocks.array[i];
+		block->end = block->end - old_end + new_end;
+	}
+	r->raw_html = false;
+	for (size_t i = 0; i < num && !r->raw_html; i++)
+		r->raw_html = r->blocks.array[i].raw_html;
+	r->block_raw_html = false;
+	r->text = NULL;
+	r->cache_pending = false;
+}
+
+/* Renders text into r, re-rendering only the blocks changed since the last call, takes ownership of text. r becomes
+ * the base of the next call as it is, it must not be the current base. */
+static void markdown_source_render_edit(struct markdown_source_data *md, struct markdown_render *r, char *text, size_t len)
+{
+	if (!md->part)
+		md->part = markdown_render_create();
+	struct markdown_render *part = md->part;
+	MD_EDIT edit;
+	MD_REPARSE_INFO info;
+	if (md->base_text)
+		edit = markdown_find_edit(md->base_text, md->base_len, text, len);
+	markdown_render_reset(part, text);
+	markdown_render_lend_html(part);
+	md_html_context_set_buffer(md->html_context, &part->out);
+	int ret = md_html_blocks_reparse_in_context(md->html_context, text, (MD_SIZE)len, md->base_text ? &edit : NULL, NULL,
+						    markdown_source_add_block, markdown_source_top_level_block, part,
+						    MARKDOWN_PARSER_FLAGS, MARKDOWN_RENDERER_FLAGS, &info);
+	md_html_context_set_buffer(md->html_context, NULL);
+	markdown_render_return_html(part);
+	part->text = NULL;
+
+	if (ret != 0 || info.full) {
+		struct markdown_render swap = *r;
+		*r = *part;
+		*part = swap;
+	} else if (md->base && info.first_block + info.old_block_count <= md->base->blocks.num) {
+		markdown_render_splice(r, md->base, part, &info);
+	} else {
+		/* base does not match the document in the context, start over */
+		markdown_render_markdown(r, md->html_context, text, len);
+	}
+
+	md->base = r;
+	bfree(md->base_text);
+	md->base_text = text;
+	md->base_len = len;
+}
+
+/* the context keeps the buffers of the largest document since the last trim, drop them once it got much smaller */
+static void markdown_source_trim_context(struct markdown_source_data *md, size_t len)
+{
+	if (len > md->html_context_peak) {
+		md->html_context_peak = len;
+	} else if (md->html_context_peak >= MARKDOWN_TRIM_MIN_SIZE && len < md->html_context_peak / MARKDOWN_TRIM_FACTOR) {
+		md_html_context_trim(md->html_context);
+		md->html_context_peak = len;
+	}
+}
+
+static struct markdown_update *markdown_update_create(void)
+{
+	struct markdown_update *u = bzalloc(sizeof(struct markdown_update));
+	dstr_init(&u->json);
+	da_init(u->events);
+	return u;
+}
+
+static void markdown_update_destroy(struct markdown_update *u)
+{
+	if (!u)
+		return;
+	dstr_free(&u->json);
+	da_free(u->events);
+	bfree(u);
+}
+
+static struct markdown_sent *markdown_source_sent(struct markdown_source_data *md)
+{
+	return &md->sent[md->sent_index];
+}
+
+/* remember what the page shows once the update for r is sent, so the next one can be a patch */
+static void markdown_source_set_sent(struct markdown_source_data *md, struct markdown_render *r)
+{
+	uint64_t version = markdown_source_sent(md)->version;
+	md->sent_index ^= 1;
+	struct markdown_sent *sent = markdown_source_sent(md);
+	da_resize(sent->blocks, r->blocks.num);
+	for (size_t i = 0; i < r->blocks.num; i++)
+		sent->blocks.array[i] = r->blocks.array[i].hash;
+	/* raw html blocks can be unbalanced, those documents are always replaced as a whole */
+	sent->as_blocks = !r->raw_html;
+	sent->version = version + 1;
+}
+
+/* the last update never left the worker, the page still shows what it showed before */
+static void markdown_source_revert_sent(struct markdown_source_data *md)
+{
+	md->sent_index ^= 1;
+}
+
+static void json_cat_escaped(struct dstr *json, const char *str, size_t len)
+{
+	static const char hex[] = "0123456789abcdef";
+	const char *end = str + len;
+	/* escaping rarely grows the string much, reserve the unescaped size up front */
+	dstr_ensure_capacity(json, json->len + len + len / 8 + 1);
+	while (str < end) {
+		const char *run = str;
+		while (str < end && (unsigned char)*str >= 0x20 && *str != '"' && *str != '\\')
+			str++;
+		dstr_ncat(json, run, str - run);
+		if (str == end)
+			break;
+		char esc[7] = {'\\', *str, 0};
+		switch (*str) {
+		case '"':
+		case '\\':
+			break;
+		case '\n':
+			esc[1] = 'n';
+			break;
+		case '\r':
+			esc[1] = 'r';
+			break;
+		case '\t':
+			esc[1] = 't';
+			break;
+		default:
+			snprintf(esc, sizeof(esc), "\\u00%c%c", hex[(unsigned char)*str >> 4], hex[*str & 0xf]);
+		}
+		dstr_cat(json, esc);
+		str++;
+	}
+}
+
+static void markdown_update_begin_event(struct markdown_source_data *md, struct markdown_update *u)
+{
+	md->event_start = u->json.len;
+	da_push_back(u->events, &md->event_start);
+	dstr_catf(&u->json, "{\"base\":%llu,\"version\":%llu,\"seq\":%zu,\"ops\":[", (unsigned long long)u->base,
+		  (unsigned long long)u->version, u->events.num - 1);
+	md->event_ops = 0;
+}
+
+static void markdown_update_end_event(struct markdown_update *u, bool done)
+{
+	dstr_cat(&u->json, done ? "],\"done\":true}" : "],\"done\":false}");
+	/* the events follow each other in json, each one is a string of its own */
+	dstr_cat_ch(&u->json, 0);
+}
+
+/* Ops are escaped straight from the render into the update. Updates larger than a chunk are split into a sequence of
+ * events, html that does not fit is continued in the next one. The page applies them once the last one arrives. */
+static void markdown_update_add_op(struct markdown_source_data *md, struct markdown_update *u, const char *op, size_t at,
+				   size_t count, const char *html, size_t len)
+{
+	do {
+		if (md->event_ops && u->json.len - md->event_start >= MARKDOWN_CHUNK_SIZE) {
+			markdown_update_end_event(u, false);
+			markdown_update_begin_event(md, u);
+		}
+		if (md->event_ops)
+			dstr_cat_ch(&u->json, ',');
+		dstr_catf(&u->json, "{\"op\":\"%s\",\"at\":%zu", op, at);
+		if (count)
+			dstr_catf(&u->json, ",\"count\":%zu", count);
+		if (html) {
+			/* a continued op starts a new event, so each piece gets at least half of one */
+			size_t event_len = u->json.len - md->event_start;
+			size_t used = event_len < MARKDOWN_CHUNK_SIZE / 2 ? event_len : MARKDOWN_CHUNK_SIZE / 2;
+			size_t space = MARKDOWN_CHUNK_SIZE - used;
+			size_t piece = len;
+			if (piece > space) {
+				/* never split a utf-8 sequence */
+				piece = space;
+				while (piece > 1 && ((unsigned char)html[piece] & 0xc0) == 0x80)
+					piece--;
+			}
+			dstr_cat(&u->json, ",\"html\":\"");
+			json_cat_escaped(&u->json, html, piece);
+			dstr_cat_ch(&u->json, '"');
+			html += piece;
+			len -= piece;
+		}
+		dstr_cat_ch(&u->json, '}');
+		md->event_ops++;
+		op = "continue";
+	} while (len);
+}
+
+static void markdown_update_add_block_op(struct markdown_source_data *md, struct markdown_update *u,
+					 struct markdown_render *r, const char *op, size_t idx)
+{
+	size_t start = markdown_render_block_start(r, idx);
+	markdown_update_add_op(md, u, op, idx, 0, r->html.array + start, r->blocks.array[idx].end - start);
+}
+
+static void markdown_update_add_full_ops(struct markdown_source_data *md, struct markdown_update *u,
+					 struct markdown_render *r)
+{
+	if (r->raw_html) {
+		markdown_update_add_op(md, u, "html", 0, 0, r->html.array ? r->html.array : "", r->html.len);
+		return;
+	}
+	markdown_update_add_op(md, u, "reset", 0, 0, NULL, 0);
+	for (size_t i = 0; i < r->blocks.num; i++)
+		markdown_update_add_block_op(md, u, r, "insert", i);
+}
+
+/* Diffs the rendered blocks against the blocks on the page. Unchanged blocks at the start and end are kept, the ones
+ * in between are replaced, inserted or removed. */
+static void markdown_update_add_patch_ops(struct markdown_source_data *md, struct markdown_update *u,
+					  struct markdown_render *r, size_t prefix, size_t suffix)
+{
+	struct markdown_sent *sent = markdown_source_sent(md);
+	struct markdown_block *blocks = r->blocks.array;
+	size_t old_end = sent->blocks.num - suffix;
+	size_t new_end = r->blocks.num - suffix;
+	for (size_t i = prefix; i < old_end && i < new_end; i++) {
+		if (sent->blocks.array[i] != blocks[i].hash)
+			markdown_update_add_block_op(md, u, r, "replace", i);
+	}
+	for (size_t i = old_end; i < new_end; i++)
+		markdown_update_add_block_op(md, u, r, "insert", i);
+	if (old_end > new_end)
+		markdown_update_add_op(md, u, "remove", new_end, old_end - new_end, NULL, 0);
+}
+
+static void markdown_update_begin(struct markdown_source_data *md, struct markdown_update *u, uint64_t base,
+				  uint64_t version, bool whole, size_t reserve)
+{
+	u->json.len = 0;
+	da_resize(u->events, 0);
+	u->base = base;
+	u->version = version;
+	u->whole = whole;
+	u->resync = false;
+	if (u->json.capacity < reserve)
+		dstr_reserve(&u->json, reserve);
+	markdown_update_begin_event(md, u);
+}
+
+/* Builds the update turning what the page shows into r, unchanged blocks are skipped by the patch. The whole document
+ * is sent when nothing is in common, or when asked to. Returns false when nothing changed. */
+static bool markdown_source_build_update(struct markdown_source_data *md, struct markdown_update *u,
+					 struct markdown_render *r, bool whole)
+{
+	struct markdown_sent *sent = markdown_source_sent(md);
+	size_t old_num = sent->blocks.num;
+	size_t new_num = r->blocks.num;
+	size_t prefix = 0;
+	size_t suffix = 0;
+	whole = whole || !sent->as_blocks || r->raw_html;
+	if (!whole) {
+		while (prefix < old_num && prefix < new_num && sent->blocks.array[prefix] == r->blocks.array[prefix].hash)
+			prefix++;
+		if (prefix == old_num && prefix == new_num)
+			return false;
+		while (suffix < old_num - prefix && suffix < new_num - prefix &&
+		       sent->blocks.array[old_num - 1 - suffix] == r->blocks.array[new_num - 1 - suffix].hash)
+			suffix++;
+		whole = !prefix && !suffix;
+	}
+
+	markdown_update_begin(md, u, sent->version, sent->version + 1, whole, whole ? r->html.len + 256 : 0);
+	if (whole)
+		markdown_update_add_full_ops(md, u, r);
+	else
+		markdown_update_add_patch_ops(md, u, r, prefix, suffix);
+	markdown_update_end_event(u, true);
+	markdown_source_set_sent(md, r);
+	return true;
+}
+
+/* the whole document with the version the page should show already, it ignores that when it does */
+static void markdown_source_build_resync(struct markdown_source_data *md, struct markdown_update *u)
+{
+	uint64_t version = markdown_source_sent(md)->version;
+	markdown_update_begin(md, u, version, version, true, md->base->html.len + 256);
+	u->resync = true;
+	markdown_update_add_full_ops(md, u, md->base);
+	markdown_update_end_event(u, true);
+}
+
+/* Runs on the render worker, only the newest text is rendered and only the newest update is kept. The update is built
+ * here as well, the graphics thread only sends it. */
+static void markdown_source_render_task(void *data)
+{
+	struct markdown_source_data *md = data;
+	char *text = render_exchange_ptr((void *volatile *)&md->pending_text, NULL);
+	bool whole = os_atomic_exchange_bool(&md->want_whole, false);
+	if (!text && !(whole && md->base))
+		return;
+
+	/* an update the graphics thread has not taken yet is replaced, the page never gets it */
+	struct markdown_update *u = render_exchange_ptr((void *volatile *)&md->update, NULL);
+	bool rebuild = false;
+	if (u) {
+		if (!u->resync) {
+			markdown_source_revert_sent(md);
+			os_atomic_inc_long(&md->dropped);
+			rebuild = true;
+		}
+		whole = whole || u->whole;
+	} else {
+		u = render_exchange_ptr((void *volatile *)&md->spare_update, NULL);
+		if (!u)
+			u = markdown_update_create();
+	}
+
+	if (text) {
+		struct markdown_render *r = md->spare ? md->spare : markdown_render_create();
+		struct markdown_render *base = md->base;
+		size_t len = strlen(text);
+		if (md->html_context) {
+			markdown_source_trim_context(md, len);
+			markdown_source_render_edit(md, r, text, len);
+		} else {
+			markdown_render_markdown(r, NULL, text, len);
+			bfree(text);
+			md->base = r;
+		}
+		md->spare = base;
+		rebuild = true;
+	}
+
+	if (!rebuild) {
+		markdown_source_build_resync(md, u);
+	} else if (!markdown_source_build_update(md, u, md->base, whole)) {
+		markdown_update_destroy(render_exchange_ptr((void *volatile *)&md->spare_update, u));
+		return;
+	}
+	render_exchange_ptr((void *volatile *)&md->update, u);
+}
+
+static bool markdown_source_send_event(struct markdown_source_data *md, proc_handler_t *ph, const char *event,
+				       const char *json)
+{
+	calldata_set_string(&md->cd, "eventName", event);
+	calldata_set_string(&md->cd, "jsonString", json);
+	return proc_handler_call(ph, "javascript_event", &md->cd);
 }
 
 static void ensure_directory(char *path)
@@ -96,26 +744,117 @@ static void ensure_directory(char *path)
 #endif
 }
 
-static void markdown_source_set_browser_settings(struct markdown_source_data *md, obs_data_t *settings, obs_data_t *bs)
-{
-	dstr_copy(&md->html, "<html>\n<head>\n<meta charset=\"UTF-8\">\n<script>\n\
-window.addEventListener('setMarkdownHtml', function(event) { \n\
-	document.body.innerHTML = event.detail.html;\n\
+/* The page is the same for all sources and never changes within a version, so it is written once. It starts out empty,
+ * the css and the document always arrive through events. */
+static const char markdown_page[] = "<html>\n<head>\n<meta charset=\"UTF-8\">\n<script>\n\
+var blocks = null;\n\
+var version = 0;\n\
+function parseBlock(html) {\n\
+	var template = document.createElement('template');\n\
+	template.innerHTML = html;\n\
+	return Array.prototype.slice.call(template.content.childNodes);\n\
+}\n\
+function insertBlock(at, html) {\n\
+	var next = null;\n\
+	for (var i = at; i < blocks.length && !next; i++)\n\
+		next = blocks[i][0] || null;\n\
+	var nodes = parseBlock(html);\n\
+	nodes.forEach(function(node) { document.body.insertBefore(node, next); });\n\
+	blocks.splice(at, 0, nodes);\n\
+}\n\
+function removeBlocks(at, count) {\n\
+	blocks.splice(at, count).forEach(function(nodes) {\n\
+		nodes.forEach(function(node) { node.remove(); });\n\
+	});\n\
+}\n\
+var pending = null;\n\
+window.addEventListener('markdownUpdate', function(event) { \n\
+	var update = event.detail;\n\
+	if (update.seq === 0)\n\
+		pending = {seq: 0, ops: []};\n\
+	else if (!pending || update.seq !== pending.seq + 1)\n\
+		return;\n\
+	pending.seq = update.seq;\n\
+	update.ops.forEach(function(op) {\n\
+		if (op.op === 'continue')\n\
+			pending.ops[pending.ops.length - 1].html += op.html;\n\
+		else\n\
+			pending.ops.push(op);\n\
+	});\n\
+	if (!update.done)\n\
+		return;\n\
+	var ops = pending.ops;\n\
+	pending = null;\n\
+	var whole = ops.length && (ops[0].op === 'reset' || ops[0].op === 'html');\n\
+	if (whole ? update.version === version : !blocks || update.base !== version)\n\
+		return;\n\
+	ops.forEach(function(op) {\n\
+		if (op.op === 'reset' || op.op === 'html') {\n\
+			document.body.innerHTML = op.html || '';\n\
+			blocks = op.op === 'reset' ? [] : null;\n\
+			return;\n\
+		}\n\
+		if (op.op !== 'insert')\n\
+			removeBlocks(op.at, op.count || 1);\n\
+		if (op.op !== 'remove')\n\
+			insertBlock(op.at, op.html);\n\
+	});\n\
+	version = update.version;\n\
 });\n\
 window.addEventListener('setMarkdownCss', function(event) { \n\
 	document.getElementById('obsBrowserCustomStyle').innerHTML = event.detail.css;\n\
 });\n\
-</script><style id='obsBrowserCustomStyle'>");
-	dstr_cat(&md->html, obs_data_get_string(settings, "css"));
-	dstr_cat(&md->html, "</style>\n</head>\n<body>");
-	const char *mdt = obs_data_get_string(settings, "text");
-	md_html(mdt, (MD_SIZE)strlen(mdt), markdown_source_add_html, &md->html,
-		MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS, 0);
-	dstr_cat(&md->html, "</body></html>");
-
-	char *fn = os_generate_formatted_filename("html", true, obs_source_get_name(md->source));
-	char *path_relative = obs_module_config_path(fn);
+</script><style id='obsBrowserCustomStyle'></style>\n</head>\n<body></body></html>";
+
+static char *markdown_page_url;
+
+/* pages written by other versions are left in the same directory, only those are removed */
+static void markdown_page_remove_stale(const char *path)
+{
+	const char *name = strrchr(path, '/');
+#ifdef _WIN32
+	const char *backslash = strrchr(path, '\\');
+	if (backslash > name)
+		name = backslash;
+#endif
+	if (!name)
+		return;
+	char *dir_path = bstrdup_n(path, name - path);
+	os_dir_t *dir = os_opendir(dir_path);
+	if (!dir) {
+		bfree(dir_path);
+		return;
+	}
+	struct dstr file;
+	dstr_init(&file);
+	struct os_dirent *entry;
+	while ((entry = os_readdir(dir)) != NULL) {
+		const char *ext = os_get_path_extension(entry->d_name);
+		if (entry->directory || strncmp(entry->d_name, "page-", 5) != 0 || !ext || strcmp(ext, ".html") != 0 ||
+		    strcmp(entry->d_name, name + 1) == 0)
+			continue;
+		dstr_printf(&file, "%s/%s", dir_path, entry->d_name);
+		os_unlink(file.array);
+	}
+	dstr_free(&file);
+	os_closedir(dir);
+	bfree(dir_path);
+}
+
+/* older versions wrote a page for every source, named after the source */
+static void markdown_page_remove_legacy(obs_source_t *source)
+{
+	char *fn = os_generate_formatted_filename("html", true, obs_source_get_name(source));
+	char *path = obs_module_config_path(fn);
 	bfree(fn);
+	if (path && os_file_exists(path))
+		os_unlink(path);
+	bfree(path);
+}
+
+static void markdown_page_init(void)
+{
+	char *path_relative = obs_module_config_path("page-" PROJECT_VERSION ".html");
 	char *path = os_get_abs_path_ptr(path_relative);
 	if (path) {
 		bfree(path_relative);
@@ -124,20 +863,48 @@ window.addEventListener('setMarkdownCss', function(event) { \n\
 	}
 	ensure_directory(path);
 	struct dstr url;
-	if (os_quick_write_utf8_file(path, md->html.array, md->html.len, false)) {
+	if (path && (os_file_exists(path) || os_quick_write_utf8_file_safe(path, markdown_page, sizeof(markdown_page) - 1,
+									     false, "tmp", NULL))) {
 		dstr_init_copy(&url, "file://");
 		dstr_cat(&url, path);
+		markdown_page_remove_stale(path);
 	} else {
+		/* only when the config directory can not be written */
 		size_t len;
-		char *b64 = base64_encode((const unsigned char *)md->html.array, md->html.len, &len);
+		char *b64 = base64_encode((const unsigned char *)markdown_page, sizeof(markdown_page) - 1, &len);
 		dstr_init_copy(&url, "data:text/html;base64,");
 		dstr_cat(&url, b64);
 		bfree(b64);
 	}
-	obs_data_set_string(bs, "url", url.array);
-	dstr_free(&url);
 	bfree(path);
-	obs_data_set_string(bs, "css", "");
+	markdown_page_url = url.array;
+}
+
+/* the cache is shared by all sources, its numbers show whether the budget fits the documents they show */
+static void markdown_block_cache_stats(struct dstr *str)
+{
+	struct block_cache_stats stats;
+	block_cache_get_stats(&stats);
+	dstr_catf(str, "%llu hits, %llu misses, %llu evictions, %zu blocks using %zu of %zu bytes",
+		  (unsigned long long)stats.hits, (unsigned long long)stats.misses, (unsigned long long)stats.evictions,
+		  stats.entries, stats.size, stats.budget);
+}
+
+static void markdown_log_block_cache(void)
+{
+	struct dstr stats;
+	dstr_init(&stats);
+	markdown_block_cache_stats(&stats);
+	blog(LOG_INFO, "[markdown] block cache: %s", stats.array);
+	dstr_free(&stats);
+}
+
+/* events sent before the page has loaded are lost, so the css and the whole document are sent again a few times */
+static void markdown_source_start_resend(struct markdown_source_data *md)
+{
+	md->resend_until = os_gettime_ns() + MARKDOWN_RESEND_NS;
+	md->resend_interval = MARKDOWN_RESEND_INTERVAL_NS;
+	md->next_resend = 0;
 }
 
 static void markdown_source_remove(void *data, calldata_t *cd)
@@ -151,56 +918,120 @@ static void markdown_source_remove(void *data, calldata_t *cd)
 	md->browser = NULL;
 }
 
-static bool markdown_source_file_changed(const char *path, time_t *time, obs_data_t *settings, const char *setting)
+static bool markdown_source_file_changed(struct markdown_source_data *md, struct markdown_file *file, const char *path)
 {
-	bool changed = false;
-	struct stat stats;
-	if (os_stat(path, &stats) != 0)
-		return changed;
-	if (stats.st_mtime == *time)
-		return changed;
+	struct file_stamp stamp;
+	file_stamp_get(path, &stamp);
+	if (!stamp.exists || file_stamp_equal(&stamp, &file->stamp))
+		return false;
 	char *text = os_quick_read_utf8_file(path);
 	if (!text)
-		return changed;
-	const char *old_text = obs_data_get_string(settings, setting);
-	if (strcmp(text, old_text) != 0) {
-		obs_data_set_string(settings, setting, text);
-		changed = true;
-		*time = stats.st_mtime;
+		return false;
+	file->stamp = stamp;
+	uint64_t hash = hash64(text, strlen(text), 0);
+	if (hash == file->hash) {
+		bfree(text);
+		return false;
 	}
-	bfree(text);
-	return changed;
+	file->hash = hash;
+	pthread_mutex_lock(&md->file_mutex);
+	char *old = file->text;
+	file->text = text;
+	pthread_mutex_unlock(&md->file_mutex);
+	bfree(old);
+	return true;
 }
 
-static void *markdown_source_thread(void *data)
+static void markdown_source_markdown_file_event(void *data, const char *path)
 {
-	struct markdown_source_data *md = (struct markdown_source_data *)data;
-	os_set_thread_name("markdown_source_thread");
-	while (!md->stop) {
-		os_sleep_ms(md->sleep);
-		if (md->css_path.len == 0 && md->markdown_path.len == 0)
-			continue;
-		obs_data_t *settings = obs_source_get_settings(md->source);
-		if (markdown_source_file_changed(md->markdown_path.array, &md->markdown_time, settings, "text") ||
-		    markdown_source_file_changed(md->css_path.array, &md->css_time, settings, "css"))
-			obs_source_update(md->source, NULL);
-		obs_data_release(settings);
-	}
-	return NULL;
+	struct markdown_source_data *md = data;
+	if (markdown_source_file_changed(md, &md->markdown, path))
+		obs_source_update(md->source, NULL);
+}
+
+static void markdown_source_css_file_event(void *data, const char *path)
+{
+	struct markdown_source_data *md = data;
+	if (markdown_source_file_changed(md, &md->css, path))
+		obs_source_update(md->source, NULL);
+}
+
+static void markdown_source_watch(struct markdown_source_data *md, struct markdown_file *file, const char *path, bool force,
+				  file_watch_cb callback)
+{
+	if (!force && strcmp(file->path.array ? file->path.array : "", path) == 0)
+		return;
+	file_watcher_remove(file->watch);
+	file->watch = NULL;
+	dstr_copy(&file->path, path);
+	memset(&file->stamp, 0, sizeof(file->stamp));
+	file->hash = 0;
+	pthread_mutex_lock(&md->file_mutex);
+	char *old = file->text;
+	file->text = NULL;
+	pthread_mutex_unlock(&md->file_mutex);
+	bfree(old);
+	if (!*path)
+		return;
+	/* read right away so this update already has the contents */
+	markdown_source_file_changed(md, file, path);
+	file->watch = file_watcher_add(path, md->sleep, md->debounce, md->max_latency, callback, md);
+}
+
+static void markdown_source_update_watches(struct markdown_source_data *md, obs_data_t *settings)
+{
+	uint32_t sleep = (uint32_t)obs_data_get_int(settings, "sleep");
+	if (!sleep)
+		sleep = 100;
+	uint32_t debounce = (uint32_t)obs_data_get_int(settings, "debounce");
+	uint32_t max_latency = (uint32_t)obs_data_get_int(settings, "max_latency");
+	bool watch_changed = sleep != md->sleep || debounce != md->debounce || max_latency != md->max_latency;
+	md->sleep = sleep;
+	md->debounce = debounce;
+	md->max_latency = max_latency;
+	bool markdown_is_file = obs_data_get_int(settings, "markdown_source") == MARKDOWN_FILE;
+	markdown_source_watch(md, &md->markdown, markdown_is_file ? obs_data_get_string(settings, "markdown_path") : "",
+			      watch_changed, markdown_source_markdown_file_event);
+	bool css_is_file = obs_data_get_int(settings, "css_source") == STYLE_CSS_FILE;
+	markdown_source_watch(md, &md->css, css_is_file ? obs_data_get_string(settings, "css_path") : "", watch_changed,
+			      markdown_source_css_file_event);
+}
+
+static char *markdown_source_get_text(struct markdown_source_data *md, struct markdown_file *file, obs_data_t *settings,
+				      const char *setting)
+{
+	if (dstr_is_empty(&file->path))
+		return bstrdup(obs_data_get_string(settings, setting));
+	pthread_mutex_lock(&md->file_mutex);
+	char *text = bstrdup(file->text ? file->text : "");
+	pthread_mutex_unlock(&md->file_mutex);
+	return text;
 }
 
 static void *markdown_source_create(obs_data_t *settings, obs_source_t *source)
 {
 	struct markdown_source_data *md = bzalloc(sizeof(struct markdown_source_data));
 	md->source = source;
-	md->sleep = 100;
+	markdown_page_remove_legacy(source);
+	pthread_mutex_init(&md->file_mutex, NULL);
+	markdown_source_update_watches(md, settings);
 
 	obs_data_t *bs = obs_data_create();
 	obs_data_set_int(bs, "width", obs_data_get_int(settings, "width"));
 	obs_data_set_int(bs, "height", obs_data_get_int(settings, "height"));
 
-	dstr_init(&md->html);
-	markdown_source_set_browser_settings(md, settings, bs);
+	md->task.callback = markdown_source_render_task;
+	md->task.param = md;
+	da_init(md->sent[0].blocks);
+	da_init(md->sent[1].blocks);
+	md->html_context = md_html_context_new(&markdown_allocator);
+	md->pending_text = markdown_source_get_text(md, &md->markdown, settings, "text");
+	md->html_context_peak = strlen(md->pending_text);
+	md->css_text = markdown_source_get_text(md, &md->css, settings, "css");
+	md->css_hash = hash64(md->css_text, strlen(md->css_text), 0);
+	markdown_source_start_resend(md);
+	obs_data_set_string(bs, "url", markdown_page_url);
+	obs_data_set_string(bs, "css", "");
 	md->browser = obs_source_create_private("browser_source", "markdown browser", bs);
 	obs_data_release(bs);
 	obs_source_add_active_child(md->source, md->browser);
@@ -208,29 +1039,42 @@ static void *markdown_source_create(obs_data_t *settings, obs_source_t *source)
 	signal_handler_t *sh = obs_source_get_signal_handler(source);
 	signal_handler_connect(sh, "remove", markdown_source_remove, md);
 
-	if (obs_data_get_int(settings, "markdown_source") == MARKDOWN_FILE) {
-		markdown_source_file_changed(obs_data_get_string(settings, "markdown_path"), &md->markdown_time, settings, "text");
-	}
-	if (obs_data_get_int(settings, "css_source") == STYLE_CSS_FILE) {
-		markdown_source_file_changed(obs_data_get_string(settings, "css_path"), &md->css_time, settings, "css");
-	}
-	pthread_create(&md->thread, NULL, markdown_source_thread, md);
-
+	render_worker_queue(&md->task);
 	return md;
 }
 
 static void markdown_source_destroy(void *data)
 {
 	struct markdown_source_data *md = data;
-	md->stop = true;
-	pthread_join(md->thread, NULL);
-	dstr_free(&md->markdown_path);
-	dstr_free(&md->css_path);
+	render_worker_cancel(&md->task);
+	file_watcher_remove(md->markdown.watch);
+	file_watcher_remove(md->css.watch);
+	dstr_free(&md->markdown.path);
+	dstr_free(&md->css.path);
+	bfree(md->markdown.text);
+	bfree(md->css.text);
+	pthread_mutex_destroy(&md->file_mutex);
 	if (md->browser) {
 		obs_source_remove_active_child(md->source, md->browser);
 		obs_source_release(md->browser);
 	}
-	dstr_free(&md->html);
+	bfree(md->pending_text);
+	bfree(md->pending_css);
+	bfree(md->css_text);
+	markdown_update_destroy(md->update);
+	markdown_update_destroy(md->spare_update);
+	markdown_update_destroy(md->last_update);
+	md_html_context_free(md->html_context);
+	bfree(md->base_text);
+	markdown_render_destroy(md->base);
+	markdown_render_destroy(md->spare);
+	markdown_render_destroy(md->part);
+	da_free(md->sent[0].blocks);
+	da_free(md->sent[1].blocks);
+	dstr_free(&md->json);
+	calldata_free(&md->cd);
+	blog(LOG_DEBUG, "[markdown] %ld intermediate versions dropped", md->dropped);
+	markdown_log_block_cache();
 	bfree(md);
 }
 
@@ -263,36 +1107,26 @@ static void markdown_source_enum_sources(void *data, obs_source_enum_proc_t enum
 static void markdown_source_update(void *data, obs_data_t *settings)
 {
 	struct markdown_source_data *md = data;
-	md->sleep = (uint32_t)obs_data_get_int(settings, "sleep");
-	if (!md->sleep)
-		md->sleep = 100;
 	obs_data_t *bs = obs_source_get_settings(md->browser);
 	if (obs_data_get_int(settings, "width") != obs_data_get_int(bs, "width") ||
 	    obs_data_get_int(settings, "height") != obs_data_get_int(bs, "height")) {
 		obs_data_set_int(bs, "width", obs_data_get_int(settings, "width"));
 		obs_data_set_int(bs, "height", obs_data_get_int(settings, "height"));
 		obs_source_update(md->browser, NULL);
-	}
-	if (obs_data_get_int(settings, "markdown_source") == MARKDOWN_FILE) {
-		const char *path = obs_data_get_string(settings, "markdown_path");
-		if (md->markdown_path.array == NULL || strcmp(md->markdown_path.array, path) != 0)
-			dstr_copy(&md->markdown_path, path);
-	} else if (md->markdown_path.len > 0) {
-		dstr_copy(&md->markdown_path, "");
+		/* the browser loads the page again for the new size */
+		os_atomic_set_bool(&md->page_reloaded, true);
 	}
 	if (obs_data_get_bool(settings, "simple_style")) {
 		obs_data_unset_user_value(settings, "simple_style");
 		obs_data_set_int(settings, "css_source", STYLE_SETTINGS);
 	}
-	long long css_source = obs_data_get_int(settings, "css_source");
-	if (css_source == STYLE_CSS_FILE) {
-		const char *path = obs_data_get_string(settings, "css_path");
-		if (md->css_path.array == NULL || strcmp(md->css_path.array, path) != 0)
-			dstr_copy(&md->css_path, path);
-	} else if (md->css_path.len > 0) {
-		dstr_copy(&md->css_path, "");
-	}
-	if (css_source == STYLE_SETTINGS) {
+	markdown_source_update_watches(md, settings);
+	/* older versions stored the file contents in the settings */
+	if (!dstr_is_empty(&md->markdown.path))
+		obs_data_unset_user_value(settings, "text");
+	if (!dstr_is_empty(&md->css.path))
+		obs_data_unset_user_value(settings, "css");
+	if (obs_data_get_int(settings, "css_source") == STYLE_SETTINGS) {
 		struct dstr css;
 		dstr_init(&css);
 		obs_data_t *font = obs_data_get_obj(settings, "font");
@@ -333,40 +1167,96 @@ table {\n\
 		obs_data_set_string(settings, "css", css.array);
 		dstr_free(&css);
 	}
-	const char *mdt = obs_data_get_string(settings, "text");
-	dstr_copy(&md->html, " ");
-	md_html(mdt, (MD_SIZE)strlen(mdt), markdown_source_add_html, &md->html,
-		MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS, 0);
-	bool refresh = false;
-	proc_handler_t *ph = obs_source_get_proc_handler(md->browser);
-	if (ph) {
-		obs_data_t *json = obs_data_create();
-		obs_data_set_string(json, "html", md->html.array);
-		struct calldata cd = {0};
-		calldata_set_string(&cd, "eventName", "setMarkdownHtml");
-		calldata_set_string(&cd, "jsonString", obs_data_get_json(json));
-		if (!proc_handler_call(ph, "javascript_event", &cd))
-			refresh = true;
-		obs_data_release(json);
-
-		json = obs_data_create();
-		obs_data_set_string(json, "css", obs_data_get_string(settings, "css"));
-		calldata_set_string(&cd, "eventName", "setMarkdownCss");
-		calldata_set_string(&cd, "jsonString", obs_data_get_json(json));
-		if (!proc_handler_call(ph, "javascript_event", &cd))
-			refresh = true;
-		calldata_free(&cd);
-		obs_data_release(json);
-	} else {
-		refresh = true;
+	char *text = markdown_source_get_text(md, &md->markdown, settings, "text");
+	text = render_exchange_ptr((void *volatile *)&md->pending_text, text);
+	if (text) {
+		os_atomic_inc_long(&md->dropped);
+		bfree(text);
 	}
-	if (refresh) {
-		markdown_source_set_browser_settings(md, settings, bs);
-		obs_source_update(md->browser, NULL);
+	render_worker_queue(&md->task);
+
+	/* identical css is not pushed again */
+	char *css = markdown_source_get_text(md, &md->css, settings, "css");
+	uint64_t css_hash = hash64(css, strlen(css), 0);
+	if (css_hash != md->css_hash) {
+		md->css_hash = css_hash;
+		css = render_exchange_ptr((void *volatile *)&md->pending_css, css);
 	}
+	bfree(css);
 	obs_data_release(bs);
 }
 
+static void markdown_source_push_css(struct markdown_source_data *md)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(md->browser);
+	if (!ph)
+		return;
+	const char *css = md->css_text ? md->css_text : "";
+	dstr_copy(&md->json, "{\"css\":\"");
+	json_cat_escaped(&md->json, css, strlen(css));
+	dstr_cat(&md->json, "\"}");
+	if (!markdown_source_send_event(md, ph, "setMarkdownCss", md->json.array))
+		markdown_source_start_resend(md);
+}
+
+/* A failed update is sent again by the resends, as it is when it was the whole document, that version is not on the
+ * page yet. Otherwise the render task is asked for the whole document. */
+static void markdown_source_push_update(struct markdown_source_data *md, struct markdown_update *u)
+{
+	proc_handler_t *ph = obs_source_get_proc_handler(md->browser);
+	if (!ph)
+		return;
+	for (size_t i = 0; i < u->events.num; i++) {
+		if (!markdown_source_send_event(md, ph, "markdownUpdate", u->json.array + u->events.array[i])) {
+			markdown_source_start_resend(md);
+			return;
+		}
+	}
+}
+
+static void markdown_source_request_whole(struct markdown_source_data *md)
+{
+	os_atomic_set_bool(&md->want_whole, true);
+	render_worker_queue(&md->task);
+}
+
+static void markdown_source_tick(void *data, float seconds)
+{
+	UNUSED_PARAMETER(seconds);
+	struct markdown_source_data *md = data;
+	char *css = render_exchange_ptr((void *volatile *)&md->pending_css, NULL);
+	if (css) {
+		bfree(md->css_text);
+		md->css_text = css;
+	}
+	struct markdown_update *u = render_exchange_ptr((void *volatile *)&md->update, NULL);
+	if (u) {
+		struct markdown_update *old = md->last_update;
+		md->last_update = u;
+		markdown_update_destroy(render_exchange_ptr((void *volatile *)&md->spare_update, old));
+	}
+	if (!md->browser)
+		return;
+
+	if (os_atomic_exchange_bool(&md->page_reloaded, false))
+		markdown_source_start_resend(md);
+	uint64_t now = os_gettime_ns();
+	bool resend = now < md->resend_until && now >= md->next_resend;
+	if (resend) {
+		md->next_resend = now + md->resend_interval;
+		md->resend_interval *= 2;
+		if (md->resend_interval > MARKDOWN_RESEND_MAX_INTERVAL_NS)
+			md->resend_interval = MARKDOWN_RESEND_MAX_INTERVAL_NS;
+	}
+	if (css || resend)
+		markdown_source_push_css(md);
+	/* the page ignores a whole document again when it already shows its version */
+	if (u || (resend && md->last_update && md->last_update->whole))
+		markdown_source_push_update(md, md->last_update);
+	else if (resend)
+		markdown_source_request_whole(md);
+}
+
 static bool markdown_source_changed(void *data, obs_properties_t *props, obs_property_t *property, obs_data_t *settings)
 {
 	UNUSED_PARAMETER(data);
@@ -377,8 +1267,10 @@ static bool markdown_source_changed(void *data, obs_properties_t *props, obs_pro
 	obs_property_set_visible(p, !markdown_is_file);
 	p = obs_properties_get(props, "markdown_path");
 	obs_property_set_visible(p, markdown_is_file);
-	p = obs_properties_get(props, "sleep");
-	obs_property_set_visible(p, markdown_is_file || obs_data_get_int(settings, "css_source") == STYLE_CSS_FILE);
+	bool watching = markdown_is_file || obs_data_get_int(settings, "css_source") == STYLE_CSS_FILE;
+	obs_property_set_visible(obs_properties_get(props, "sleep"), watching);
+	obs_property_set_visible(obs_properties_get(props, "debounce"), watching);
+	obs_property_set_visible(obs_properties_get(props, "max_latency"), watching);
 	return true;
 }
 
@@ -397,8 +1289,10 @@ static bool markdown_source_style_changed(void *data, obs_properties_t *props, o
 	obs_property_set_visible(p, style == STYLE_SETTINGS);
 	p = obs_properties_get(props, "css_path");
 	obs_property_set_visible(p, style == STYLE_CSS_FILE);
-	p = obs_properties_get(props, "sleep");
-	obs_property_set_visible(p, style == STYLE_CSS_FILE || obs_data_get_int(settings, "markdown_source") == MARKDOWN_FILE);
+	bool watching = style == STYLE_CSS_FILE || obs_data_get_int(settings, "markdown_source") == MARKDOWN_FILE;
+	obs_property_set_visible(obs_properties_get(props, "sleep"), watching);
+	obs_property_set_visible(obs_properties_get(props, "debounce"), watching);
+	obs_property_set_visible(obs_properties_get(props, "max_latency"), watching);
 	return true;
 }
 
@@ -418,7 +1312,7 @@ static obs_properties_t *markdown_source_properties(void *data)
 	obs_property_text_set_monospace(p, true);
 
 	obs_properties_add_path(props, "markdown_path", obs_module_text("MarkdownFile"), OBS_PATH_FILE,
-				"Markdown files (*.md);;All files (*.*)", md->markdown_path.array);
+				"Markdown files (*.md);;All files (*.*)", md->markdown.path.array);
 
 	p = obs_properties_add_list(props, "css_source", obs_module_text("CssSource"), OBS_COMBO_TYPE_LIST, OBS_COMBO_FORMAT_INT);
 	obs_property_list_add_int(p, obs_module_text("CssText"), STYLE_CSS);
@@ -434,10 +1328,21 @@ static obs_properties_t *markdown_source_properties(void *data)
 	obs_property_text_set_monospace(p, true);
 
 	obs_properties_add_path(props, "css_path", obs_module_text("CssFile"), OBS_PATH_FILE, "CSS files (*.css);;All files (*.*)",
-				md->css_path.array);
+				md->css.path.array);
 
 	p = obs_properties_add_int(props, "sleep", obs_module_text("Refresh"), 1, 10000, 1);
 	obs_property_int_set_suffix(p, "ms");
+	p = obs_properties_add_int(props, "debounce", obs_module_text("Debounce"), 0, 5000, 1);
+	obs_property_int_set_suffix(p, "ms");
+	p = obs_properties_add_int(props, "max_latency", obs_module_text("MaxLatency"), 0, 10000, 1);
+	obs_property_int_set_suffix(p, "ms");
+
+	struct dstr stats;
+	dstr_init_copy(&stats, obs_module_text("BlockCache"));
+	dstr_cat(&stats, ": ");
+	markdown_block_cache_stats(&stats);
+	obs_properties_add_text(props, "block_cache", stats.array, OBS_TEXT_INFO);
+	dstr_free(&stats);
 
 	obs_properties_add_text(
 		props, "plugin_info",
@@ -458,6 +1363,8 @@ static void markdown_source_defaults(obs_data_t *settings)
 	obs_data_set_default_int(settings, "width", 800);
 	obs_data_set_default_int(settings, "height", 600);
 	obs_data_set_default_int(settings, "sleep", 300);
+	obs_data_set_default_int(settings, "debounce", 50);
+	obs_data_set_default_int(settings, "max_latency", 500);
 	obs_data_set_default_int(settings, "bgcolor", 0);
 	obs_data_set_default_int(settings, "fgcolor", 0xffffffff);
 }
@@ -476,6 +1383,7 @@ struct obs_source_info markdown_source = {
 	.get_width = markdown_source_width,
 	.get_height = markdown_source_height,
 	.video_render = markdown_source_render,
+	.video_tick = markdown_source_tick,
 	.get_properties = markdown_source_properties,
 	.enum_active_sources = markdown_source_enum_sources,
 	.enum_all_sources = markdown_source_enum_sources,
@@ -488,8 +1396,22 @@ bool obs_module_load(void)
 {
 	blog(LOG_INFO, "[markdown] loaded version %s", PROJECT_VERSION);
 	obs_register_source(&markdown_source);
+	file_watcher_start();
+	block_cache_init(MARKDOWN_BLOCK_CACHE_BUDGET);
+	render_worker_start();
+	markdown_page_init();
 
 	return true;
 }
 
-void obs_module_unload(void) {}
+void obs_module_unload(void)
+{
+	blog(LOG_INFO, "[markdown] %llu intermediate file changes suppressed", (unsigned long long)file_watcher_get_suppressed());
+	file_watcher_stop();
+	render_worker_stop();
+
+	markdown_log_block_cache();
+	block_cache_free();
+	bfree(markdown_page_url);
+	markdown_page_url = NULL;
+}
@@ -0,0 +1,960 @@
+/*
+ * MD4C: Markdown parser for C
+ * (http://github.com/mity/md4c)
+ *
+ * Copyright (c) 2016-2017 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "md4c-ast.h"
+
+
+/* Memory management, see md4c.c. */
+#ifndef MD_MALLOC
+    #define MD_MALLOC   malloc
+    #define MD_REALLOC  realloc
+    #define MD_FREE     free
+#else
+    void* MD_MALLOC(size_t size);
+    void* MD_REALLOC(void* ptr, size_t size);
+    void MD_FREE(void* ptr);
+#endif
+
+
+/* The tree is this handle followed by the blob:
+ *
+ *   MD_AST_HEADER header;
+ *   MD_AST_NODE nodes[header.n_nodes];
+ *   MD_OFFSET words[header.n_words];
+ *   MD_CHAR pool[header.pool_size];
+ *
+ * The words hold what does not fit into the nodes: the counts of a table and
+ * the attributes. An attribute is stored as where its text is (AST_IN_xxxx),
+ * the offset and size of the text, the count n of its substrings, n types and
+ * n+1 offsets; so MD_ATTRIBUTE can point right into the words.
+ */
+struct MD_AST_tag {
+    const MD_ALLOCATOR* allocator;
+    size_t size;        /* Of the blob. */
+};
+
+typedef struct MD_AST_HEADER {
+    char magic[8];
+    unsigned version;
+    unsigned byte_order;
+    unsigned char_size;
+    unsigned parser_flags;
+    unsigned source_size;
+    unsigned source_hash;
+    unsigned n_nodes;
+    unsigned n_words;
+    unsigned pool_size;
+    unsigned max_depth;     /* Of the block and span nodes. */
+} MD_AST_HEADER;
+
+static const char AST_MAGIC[8] = { 'M', 'D', '4', 'C', 'A', 'S', 'T', '\0' };
+#define AST_BYTE_ORDER      0x01020304
+
+#define AST_IN_SOURCE       0
+#define AST_IN_POOL         1
+#define AST_IN_NOWHERE      2   /* MD_ATTRIBUTE::text is NULL. */
+
+/* MD_AST_NODE::flags of text nodes. */
+#define AST_FLAG_POOL       0x0001
+
+/* The attribute substring types are stored as words. */
+typedef char ast_texttype_check[sizeof(MD_TEXTTYPE) == sizeof(MD_OFFSET) ? 1 : -1];
+
+#define AST_HEADER(ast)     ((MD_AST_HEADER*) ((ast) + 1))
+#define AST_NODES(ast)      ((MD_AST_NODE*) (AST_HEADER(ast) + 1))
+#define AST_WORDS(ast)      ((MD_OFFSET*) (AST_NODES(ast) + AST_HEADER(ast)->n_nodes))
+#define AST_POOL(ast)       ((MD_CHAR*) (AST_WORDS(ast) + AST_HEADER(ast)->n_words))
+
+/* Replays of trees nesting deeper than this allocate their stack. */
+#define AST_LOCAL_DEPTH     64
+
+
+static void*
+ast_resize(const MD_ALLOCATOR* allocator, void* ptr, size_t old_size, size_t new_size)
+{
+    if(allocator != NULL)
+        return allocator->resize(ptr, old_size, new_size, allocator->userdata);
+    return MD_REALLOC(ptr, new_size);
+}
+
+static void
+ast_release(const MD_ALLOCATOR* allocator, void* ptr)
+{
+    if(ptr == NULL)
+        return;
+    if(allocator != NULL)
+        allocator->release(ptr, allocator->userdata);
+    else
+        MD_FREE(ptr);
+}
+
+/* FNV-1a, as md4c.c uses for the reference definitions. */
+static unsigned
+ast_hash(const MD_CHAR* text, MD_SIZE size)
+{
+    const unsigned char* p = (const unsigned char*) text;
+    const unsigned char* end = p + (size_t) size * sizeof(MD_CHAR);
+    unsigned hash = 2166136261U;
+
+    while(p < end) {
+        hash ^= *p++;
+        hash *= 16777619U;
+    }
+    return hash;
+}
+
+/* Makes room for n more items in a growable array. */
+static int
+ast_grow(const MD_ALLOCATOR* allocator, void** p_array, unsigned* p_alloc,
+         unsigned count, unsigned n, size_t item_size)
+{
+    unsigned new_alloc;
+    void* new_array;
+
+    if(count + n <= *p_alloc)
+        return 0;
+    if(n > (unsigned) -1 / 2 - count)
+        return -1;
+
+    new_alloc = *p_alloc + *p_alloc / 2;
+    if(new_alloc < count + n)
+        new_alloc = count + n;
+    if(new_alloc < 64)
+        new_alloc = 64;
+    new_array = ast_resize(allocator, *p_array, *p_alloc * item_size, new_alloc * item_size);
+    if(new_array == NULL)
+        return -1;
+    *p_array = new_array;
+    *p_alloc = new_alloc;
+    return 0;
+}
+
+
+/***************************
+ ***  Building the tree  ***
+ ***************************/
+
+typedef struct MD_AST_BUILD_tag MD_AST_BUILD;
+struct MD_AST_BUILD_tag {
+    const MD_CHAR* source;
+    MD_SIZE source_size;
+    const MD_ALLOCATOR* allocator;
+
+    /* The nodes are appended right to the tree, which is grown as needed.
+     * The words and the pool are joined to it when the parsing is done. */
+    MD_AST* ast;
+    unsigned n_nodes;
+    unsigned alloc_nodes;
+
+    MD_OFFSET* words;
+    unsigned n_words;
+    unsigned alloc_words;
+
+    MD_CHAR* pool;
+    unsigned pool_size;
+    unsigned alloc_pool;
+
+    /* Open block and span nodes. */
+    MD_OFFSET* stack;
+    unsigned depth;
+    unsigned alloc_stack;
+    unsigned max_depth;
+
+    /* The texts md4c makes up are mostly the same few literals, like the
+     * newline of a soft break, so the last one copied to the pool is reused
+     * if it repeats. */
+    const MD_CHAR* last_text;
+    MD_SIZE last_size;
+    MD_OFFSET last_off;
+};
+
+static MD_AST_NODE*
+ast_add_node(MD_AST_BUILD* b, MD_AST_KIND kind, unsigned type)
+{
+    MD_AST_NODE* node;
+
+    if(b->n_nodes >= b->alloc_nodes) {
+        unsigned new_alloc = b->alloc_nodes + b->alloc_nodes / 2 + 256;
+        size_t old_size = (b->ast != NULL ? sizeof(MD_AST) + sizeof(MD_AST_HEADER)
+                                            + b->alloc_nodes * sizeof(MD_AST_NODE) : 0);
+        MD_AST* new_ast;
+
+        if(new_alloc > (unsigned) -1 / sizeof(MD_AST_NODE))
+            return NULL;
+        new_ast = (MD_AST*) ast_resize(b->allocator, b->ast, old_size, sizeof(MD_AST)
+                        + sizeof(MD_AST_HEADER) + new_alloc * sizeof(MD_AST_NODE));
+        if(new_ast == NULL)
+            return NULL;
+        b->ast = new_ast;
+        b->alloc_nodes = new_alloc;
+    }
+
+    node = AST_NODES(b->ast) + b->n_nodes;
+    node->kind = (unsigned char) kind;
+    node->type = (unsigned char) type;
+    node->flags = 0;
+    node->end = ++b->n_nodes;
+    node->data[0] = 0;
+    node->data[1] = 0;
+    return node;
+}
+
+/* Records where the text is, copying it to the pool unless it is a part of
+ * the source. */
+static int
+ast_add_string(MD_AST_BUILD* b, const MD_CHAR* text, MD_SIZE size,
+               MD_OFFSET* p_where, MD_OFFSET* p_off)
+{
+    if(text == NULL) {
+        *p_where = AST_IN_NOWHERE;
+        *p_off = 0;
+        return 0;
+    }
+
+    if(text >= b->source  &&  size <= b->source_size  &&
+       (size_t) (text - b->source) <= b->source_size - size)
+    {
+        *p_where = AST_IN_SOURCE;
+        *p_off = (MD_OFFSET) (text - b->source);
+        return 0;
+    }
+
+    *p_where = AST_IN_POOL;
+    if(text == b->last_text  &&  size == b->last_size  &&
+       memcmp(b->pool + b->last_off, text, size * sizeof(MD_CHAR)) == 0)
+    {
+        *p_off = b->last_off;
+        return 0;
+    }
+
+    if(ast_grow(b->allocator, (void**) &b->pool, &b->alloc_pool, b->pool_size, size, sizeof(MD_CHAR)) != 0)
+        return -1;
+    memcpy(b->pool + b->pool_size, text, size * sizeof(MD_CHAR));
+    b->last_text = text;
+    b->last_size = size;
+    b->last_off = b->pool_size;
+    b->pool_size += size;
+    *p_off = b->last_off;
+    return 0;
+}
+
+/* Appends the attribute to the words and stores its index in *p_index. */
+static int
+ast_add_attribute(MD_AST_BUILD* b, const MD_ATTRIBUTE* attr, MD_OFFSET* p_index)
+{
+    MD_OFFSET where;
+    MD_OFFSET off;
+    unsigned n = 0;
+    MD_OFFSET* w;
+    unsigned i;
+
+    /* Indented code blocks have all zero info and lang. */
+    if(attr->substr_offsets != NULL) {
+        while(attr->substr_offsets[n] < attr->size)
+            n++;
+    }
+
+    if(ast_add_string(b, attr->text, attr->size, &where, &off) != 0)
+        return -1;
+    if(ast_grow(b->allocator, (void**) &b->words, &b->alloc_words, b->n_words, 5 + 2 * n, sizeof(MD_OFFSET)) != 0)
+        return -1;
+
+    w = b->words + b->n_words;
+    w[0] = where;
+    w[1] = off;
+    w[2] = attr->size;
+    w[3] = n;
+    for(i = 0; i < n; i++)
+        w[4 + i] = (MD_OFFSET) attr->substr_types[i];
+    for(i = 0; i < n; i++)
+        w[4 + n + i] = attr->substr_offsets[i];
+    w[4 + n + n] = attr->size;
+
+    *p_index = b->n_words;
+    b->n_words += 5 + 2 * n;
+    return 0;
+}
+
+static int
+ast_open(MD_AST_BUILD* b, MD_AST_KIND kind, unsigned type, MD_AST_NODE** p_node)
+{
+    if(ast_grow(b->allocator, (void**) &b->stack, &b->alloc_stack, b->depth, 1, sizeof(MD_OFFSET)) != 0)
+        return -1;
+    *p_node = ast_add_node(b, kind, type);
+    if(*p_node == NULL)
+        return -1;
+
+    b->stack[b->depth++] = b->n_nodes - 1;
+    if(b->depth > b->max_depth)
+        b->max_depth = b->depth;
+    return 0;
+}
+
+static int
+ast_close(MD_AST_BUILD* b)
+{
+    b->depth--;
+    AST_NODES(b->ast)[b->stack[b->depth]].end = b->n_nodes;
+    return 0;
+}
+
+static int
+ast_enter_block(MD_BLOCKTYPE type, void* detail, void* userdata)
+{
+    MD_AST_BUILD* b = (MD_AST_BUILD*) userdata;
+    MD_AST_NODE* node;
+
+    if(ast_open(b, MD_AST_BLOCK, type, &node) != 0)
+        return -1;
+
+    switch(type) {
+        case MD_BLOCK_UL:
+        {
+            const MD_BLOCK_UL_DETAIL* det = (const MD_BLOCK_UL_DETAIL*) detail;
+            node->flags = (unsigned short) det->mark;
+            node->data[0] = det->is_tight;
+            break;
+        }
+
+        case MD_BLOCK_OL:
+        {
+            const MD_BLOCK_OL_DETAIL* det = (const MD_BLOCK_OL_DETAIL*) detail;
+            node->flags = (unsigned short) det->mark_delimiter;
+            node->data[0] = det->start;
+            node->data[1] = det->is_tight;
+            break;
+        }
+
+        case MD_BLOCK_LI:
+        {
+            const MD_BLOCK_LI_DETAIL* det = (const MD_BLOCK_LI_DETAIL*) detail;
+            node->flags = (unsigned short) det->task_mark;
+            node->data[0] = det->is_task;
+            node->data[1] = det->task_mark_offset;
+            break;
+        }
+
+        case MD_BLOCK_H:
+            node->data[0] = ((const MD_BLOCK_H_DETAIL*) detail)->level;
+            break;
+
+        case MD_BLOCK_CODE:
+        {
+            const MD_BLOCK_CODE_DETAIL* det = (const MD_BLOCK_CODE_DETAIL*) detail;
+            node->flags = (unsigned short) det->fence_char;
+            if(ast_add_attribute(b, &det->info, &node->data[0]) != 0  ||
+               ast_add_attribute(b, &det->lang, &node->data[1]) != 0)
+                return -1;
+            break;
+        }
+
+        case MD_BLOCK_TABLE:
+        {
+            const MD_BLOCK_TABLE_DETAIL* det = (const MD_BLOCK_TABLE_DETAIL*) detail;
+            if(ast_grow(b->allocator, (void**) &b->words, &b->alloc_words, b->n_words, 3, sizeof(MD_OFFSET)) != 0)
+                return -1;
+            node->data[0] = b->n_words;
+            b->words[b->n_words++] = det->col_count;
+            b->words[b->n_words++] = det->head_row_count;
+            b->words[b->n_words++] = det->body_row_count;
+            break;
+        }
+
+        case MD_BLOCK_TH:
+        case MD_BLOCK_TD:
+            node->data[0] = (MD_OFFSET) ((const MD_BLOCK_TD_DETAIL*) detail)->align;
+            break;
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static int
+ast_leave_block(MD_BLOCKTYPE type, void* detail, void* userdata)
+{
+    (void) type;
+    (void) detail;
+    return ast_close((MD_AST_BUILD*) userdata);
+}
+
+static int
+ast_enter_span(MD_SPANTYPE type, void* detail, void* userdata)
+{
+    MD_AST_BUILD* b = (MD_AST_BUILD*) userdata;
+    MD_AST_NODE* node;
+
+    if(ast_open(b, MD_AST_SPAN, type, &node) != 0)
+        return -1;
+
+    switch(type) {
+        case MD_SPAN_A:
+        {
+            const MD_SPAN_A_DETAIL* det = (const MD_SPAN_A_DETAIL*) detail;
+            if(ast_add_attribute(b, &det->href, &node->data[0]) != 0  ||
+               ast_add_attribute(b, &det->title, &node->data[1]) != 0)
+                return -1;
+            break;
+        }
+
+        case MD_SPAN_IMG:
+        {
+            const MD_SPAN_IMG_DETAIL* det = (const MD_SPAN_IMG_DETAIL*) detail;
+            if(ast_add_attribute(b, &det->src, &node->data[0]) != 0  ||
+               ast_add_attribute(b, &det->title, &node->data[1]) != 0)
+                return -1;
+            break;
+        }
+
+        case MD_SPAN_WIKILINK:
+        {
+            const MD_SPAN_WIKILINK_DETAIL* det = (const MD_SPAN_WIKILINK_DETAIL*) detail;
+            if(ast_add_attribute(b, &det->target, &node->data[0]) != 0)
+                return -1;
+            break;
+        }
+
+        default:
+            break;
+    }
+
+    return 0;
+}
+
+static int
+ast_leave_span(MD_SPANTYPE type, void* detail, void* userdata)
+{
+    (void) type;
+    (void) detail;
+    return ast_close((MD_AST_BUILD*) userdata);
+}
+
+static int
+ast_text(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size, void* userdata)
+{
+    MD_AST_BUILD* b = (MD_AST_BUILD*) userdata;
+    MD_AST_NODE* node;
+    MD_OFFSET where;
+    MD_OFFSET off;
+
+    if(ast_add_string(b, text, size, &where, &off) != 0)
+        return -1;
+    node = ast_add_node(b, MD_AST_TEXT, type);
+    if(node == NULL)
+        return -1;
+    if(where == AST_IN_POOL)
+        node->flags = AST_FLAG_POOL;
+    node->data[0] = off;
+    node->data[1] = size;
+    return 0;
+}
+
+/* Joins the words and the pool to the nodes. */
+static int
+ast_finish(MD_AST_BUILD* b, unsigned parser_flags)
+{
+    size_t old_size = sizeof(MD_AST) + sizeof(MD_AST_HEADER) + b->alloc_nodes * sizeof(MD_AST_NODE);
+    size_t size = sizeof(MD_AST_HEADER) + b->n_nodes * sizeof(MD_AST_NODE)
+                  + b->n_words * sizeof(MD_OFFSET) + b->pool_size * sizeof(MD_CHAR);
+    MD_AST* ast;
+    MD_AST_HEADER* h;
+
+    ast = (MD_AST*) ast_resize(b->allocator, b->ast, old_size, sizeof(MD_AST) + size);
+    if(ast == NULL)
+        return -1;
+    b->ast = ast;
+    b->alloc_nodes = b->n_nodes;
+
+    ast->allocator = b->allocator;
+    ast->size = size;
+
+    h = AST_HEADER(ast);
+    memcpy(h->magic, AST_MAGIC, sizeof(AST_MAGIC));
+    h->version = MD_AST_VERSION;
+    h->byte_order = AST_BYTE_ORDER;
+    h->char_size = sizeof(MD_CHAR);
+    h->parser_flags = parser_flags;
+    h->source_size = b->source_size;
+    h->source_hash = ast_hash(b->source, b->source_size);
+    h->n_nodes = b->n_nodes;
+    h->n_words = b->n_words;
+    h->pool_size = b->pool_size;
+    h->max_depth = b->max_depth;
+
+    if(b->n_words > 0)
+        memcpy(AST_WORDS(ast), b->words, b->n_words * sizeof(MD_OFFSET));
+    if(b->pool_size > 0)
+        memcpy(AST_POOL(ast), b->pool, b->pool_size * sizeof(MD_CHAR));
+    return 0;
+}
+
+MD_AST*
+md_parse_to_ast(const MD_CHAR* text, MD_SIZE size, unsigned parser_flags,
+                const MD_ALLOCATOR* allocator)
+{
+    MD_AST_BUILD b;
+    int ret;
+
+    MD_PARSER parser = {
+        0,
+        parser_flags,
+        ast_enter_block,
+        ast_leave_block,
+        ast_enter_span,
+        ast_leave_span,
+        ast_text,
+        NULL,
+        NULL,
+        NULL,
+        allocator,
+        NULL
+    };
+
+    memset(&b, 0, sizeof(MD_AST_BUILD));
+    b.source = text;
+    b.source_size = size;
+    b.allocator = allocator;
+
+    ret = md_parse(text, size, &parser, (void*) &b);
+    if(ret == 0  &&  b.n_nodes > 0)
+        ret = ast_finish(&b, parser_flags);
+    else
+        ret = -1;
+
+    ast_release(allocator, b.words);
+    ast_release(allocator, b.pool);
+    ast_release(allocator, b.stack);
+    if(ret != 0) {
+        ast_release(allocator, b.ast);
+        return NULL;
+    }
+    return b.ast;
+}
+
+void
+md_ast_free(MD_AST* ast)
+{
+    if(ast != NULL)
+        ast_release(ast->allocator, ast);
+}
+
+
+/**************************
+ ***  Reading the tree  ***
+ **************************/
+
+const MD_AST_NODE*
+md_ast_nodes(const MD_AST* ast, MD_SIZE* p_count)
+{
+    *p_count = AST_HEADER(ast)->n_nodes;
+    return AST_NODES(ast);
+}
+
+const MD_CHAR*
+md_ast_text(const MD_AST* ast, const MD_CHAR* source,
+            const MD_AST_NODE* node, MD_SIZE* p_size)
+{
+    *p_size = node->data[1];
+    if(node->flags & AST_FLAG_POOL)
+        return AST_POOL(ast) + node->data[0];
+    return source + node->data[0];
+}
+
+static void
+ast_attribute(const MD_AST* ast, const MD_CHAR* source, MD_OFFSET index, MD_ATTRIBUTE* attr)
+{
+    const MD_OFFSET* w = AST_WORDS(ast) + index;
+
+    switch(w[0]) {
+        case AST_IN_SOURCE:     attr->text = source + w[1]; break;
+        case AST_IN_POOL:       attr->text = AST_POOL(ast) + w[1]; break;
+        default:                attr->text = NULL; break;
+    }
+    attr->size = w[2];
+    attr->substr_types = (const MD_TEXTTYPE*) (w + 4);
+    attr->substr_offsets = w + 4 + w[3];
+}
+
+void*
+md_ast_detail(const MD_AST* ast, const MD_CHAR* source,
+              const MD_AST_NODE* node, MD_AST_DETAIL* detail)
+{
+    if(node->kind == MD_AST_BLOCK) {
+        switch(node->type) {
+            case MD_BLOCK_UL:
+                detail->ul.is_tight = (int) node->data[0];
+                detail->ul.mark = (MD_CHAR) node->flags;
+                return &detail->ul;
+
+            case MD_BLOCK_OL:
+                detail->ol.start = node->data[0];
+                detail->ol.is_tight = (int) node->data[1];
+                detail->ol.mark_delimiter = (MD_CHAR) node->flags;
+                return &detail->ol;
+
+            case MD_BLOCK_LI:
+                detail->li.is_task = (int) node->data[0];
+                detail->li.task_mark = (MD_CHAR) node->flags;
+                detail->li.task_mark_offset = node->data[1];
+                return &detail->li;
+
+            case MD_BLOCK_H:
+                detail->h.level = node->data[0];
+                return &detail->h;
+
+            case MD_BLOCK_CODE:
+                ast_attribute(ast, source, node->data[0], &detail->code.info);
+                ast_attribute(ast, source, node->data[1], &detail->code.lang);
+                detail->code.fence_char = (MD_CHAR) node->flags;
+                return &detail->code;
+
+            case MD_BLOCK_TABLE:
+            {
+                const MD_OFFSET* w = AST_WORDS(ast) + node->data[0];
+                detail->table.col_count = w[0];
+                detail->table.head_row_count = w[1];
+                detail->table.body_row_count = w[2];
+                return &detail->table;
+            }
+
+            case MD_BLOCK_TH:
+            case MD_BLOCK_TD:
+                detail->td.align = (MD_ALIGN) node->data[0];
+                return &detail->td;
+
+            default:
+                return NULL;
+        }
+    }
+
+    if(node->kind == MD_AST_SPAN) {
+        switch(node->type) {
+            case MD_SPAN_A:
+                ast_attribute(ast, source, node->data[0], &detail->a.href);
+                ast_attribute(ast, source, node->data[1], &detail->a.title);
+                return &detail->a;
+
+            case MD_SPAN_IMG:
+                ast_attribute(ast, source, node->data[0], &detail->img.src);
+                ast_attribute(ast, source, node->data[1], &detail->img.title);
+                return &detail->img;
+
+            case MD_SPAN_WIKILINK:
+                ast_attribute(ast, source, node->data[0], &detail->wikilink.target);
+                return &detail->wikilink;
+
+            default:
+                return NULL;
+        }
+    }
+
+    return NULL;
+}
+
+static int
+ast_leave(const MD_AST* ast, const MD_CHAR* source, const MD_AST_NODE* node,
+          const MD_PARSER* parser, void* userdata)
+{
+    MD_AST_DETAIL detail;
+    void* det = md_ast_detail(ast, source, node, &detail);
+
+    if(node->kind == MD_AST_BLOCK)
+        return parser->leave_block((MD_BLOCKTYPE) node->type, det, userdata);
+    return parser->leave_span((MD_SPANTYPE) node->type, det, userdata);
+}
+
+int
+md_ast_replay(const MD_AST* ast, const MD_CHAR* source,
+              const MD_PARSER* parser, void* userdata)
+{
+    const MD_AST_HEADER* h = AST_HEADER(ast);
+    const MD_AST_NODE* nodes = AST_NODES(ast);
+    MD_OFFSET local_stack[AST_LOCAL_DEPTH];
+    MD_OFFSET* stack = local_stack;
+    unsigned depth = 0;
+    MD_OFFSET i;
+    int ret = 0;
+
+    if(h->max_depth > AST_LOCAL_DEPTH) {
+        stack = (MD_OFFSET*) ast_resize(ast->allocator, NULL, 0, h->max_depth * sizeof(MD_OFFSET));
+        if(stack == NULL)
+            return -1;
+    }
+
+    for(i = 0; i < h->n_nodes; i++) {
+        const MD_AST_NODE* node = &nodes[i];
+        MD_AST_DETAIL detail;
+
+        while(depth > 0  &&  nodes[stack[depth-1]].end <= i) {
+            depth--;
+            ret = ast_leave(ast, source, &nodes[stack[depth]], parser, userdata);
+            if(ret != 0)
+                goto abort;
+        }
+
+        switch(node->kind) {
+            case MD_AST_BLOCK:
+                ret = parser->enter_block((MD_BLOCKTYPE) node->type,
+                            md_ast_detail(ast, source, node, &detail), userdata);
+                stack[depth++] = i;
+                break;
+
+            case MD_AST_SPAN:
+                ret = parser->enter_span((MD_SPANTYPE) node->type,
+                            md_ast_detail(ast, source, node, &detail), userdata);
+                stack[depth++] = i;
+                break;
+
+            default:
+            {
+                MD_SIZE size;
+                const MD_CHAR* text = md_ast_text(ast, source, node, &size);
+                ret = parser->text((MD_TEXTTYPE) node->type, text, size, userdata);
+                break;
+            }
+        }
+        if(ret != 0)
+            goto abort;
+    }
+
+    while(depth > 0) {
+        depth--;
+        ret = ast_leave(ast, source, &nodes[stack[depth]], parser, userdata);
+        if(ret != 0)
+            goto abort;
+    }
+
+abort:
+    if(stack != local_stack)
+        ast_release(ast->allocator, stack);
+    return ret;
+}
+
+
+/****************************
+ ***  Saving and loading  ***
+ ****************************/
+
+const void*
+md_ast_blob(const MD_AST* ast, size_t* p_size)
+{
+    *p_size = ast->size;
+    return AST_HEADER(ast);
+}
+
+/* Checks the range [off, off + size) lies within limit. */
+#define AST_IN_RANGE(off, size, limit)  ((size) <= (limit)  &&  (off) <= (limit) - (size))
+
+static int
+ast_check_attribute(const MD_AST* ast, MD_OFFSET index)
+{
+    const MD_AST_HEADER* h = AST_HEADER(ast);
+    const MD_OFFSET* w = AST_WORDS(ast) + index;
+    MD_OFFSET n;
+    MD_OFFSET i;
+
+    if(!AST_IN_RANGE(index, 5, h->n_words))
+        return -1;
+    n = w[3];
+    if(n > (h->n_words - index - 5) / 2)
+        return -1;
+
+    switch(w[0]) {
+        case AST_IN_SOURCE:
+            if(!AST_IN_RANGE(w[1], w[2], h->source_size))
+                return -1;
+            break;
+        case AST_IN_POOL:
+            if(!AST_IN_RANGE(w[1], w[2], h->pool_size))
+                return -1;
+            break;
+        case AST_IN_NOWHERE:
+            if(w[2] != 0)
+                return -1;
+            break;
+        default:
+            return -1;
+    }
+
+    /* The consumers walk the substrings until the offset reaches the size. */
+    for(i = 0; i < n; i++) {
+        if(w[4 + i] > MD_TEXT_LATEXMATH  ||  w[4 + n + i] > w[4 + n + i + 1])
+            return -1;
+    }
+    if(w[4 + n + n] != w[2])
+        return -1;
+    return 0;
+}
+
+static int
+ast_check_node(const MD_AST* ast, const MD_AST_NODE* node)
+{
+    const MD_AST_HEADER* h = AST_HEADER(ast);
+
+    switch(node->kind) {
+        case MD_AST_BLOCK:
+            switch(node->type) {
+                case MD_BLOCK_H:
+                    return (node->data[0] >= 1  &&  node->data[0] <= 6 ? 0 : -1);
+                case MD_BLOCK_CODE:
+                    if(ast_check_attribute(ast, node->data[0]) != 0)
+                        return -1;
+                    return ast_check_attribute(ast, node->data[1]);
+                case MD_BLOCK_TABLE:
+                    return (AST_IN_RANGE(node->data[0], 3, h->n_words) ? 0 : -1);
+                case MD_BLOCK_TH:
+                case MD_BLOCK_TD:
+                    return (node->data[0] <= MD_ALIGN_RIGHT ? 0 : -1);
+                default:
+                    return (node->type <= MD_BLOCK_TD ? 0 : -1);
+            }
+
+        case MD_AST_SPAN:
+            switch(node->type) {
+                case MD_SPAN_A:
+                case MD_SPAN_IMG:
+                    if(ast_check_attribute(ast, node->data[0]) != 0)
+                        return -1;
+                    return ast_check_attribute(ast, node->data[1]);
+                case MD_SPAN_WIKILINK:
+                    return ast_check_attribute(ast, node->data[0]);
+                default:
+                    return (node->type <= MD_SPAN_U ? 0 : -1);
+            }
+
+        case MD_AST_TEXT:
+            if(node->type > MD_TEXT_LATEXMATH)
+                return -1;
+            if(node->flags & AST_FLAG_POOL)
+                return (AST_IN_RANGE(node->data[0], node->data[1], h->pool_size) ? 0 : -1);
+            return (AST_IN_RANGE(node->data[0], node->data[1], h->source_size) ? 0 : -1);
+
+        default:
+            return -1;
+    }
+}
+
+/* Checks the nodes nest properly within the document and within the depth
+ * the replay makes room for. */
+static int
+ast_check_nodes(const MD_AST* ast)
+{
+    const MD_AST_HEADER* h = AST_HEADER(ast);
+    const MD_AST_NODE* nodes = AST_NODES(ast);
+    MD_OFFSET* stack;
+    unsigned depth = 0;
+    MD_OFFSET i;
+    int ret = -1;
+
+    if(h->n_nodes == 0  ||  h->max_depth == 0  ||  h->max_depth > h->n_nodes)
+        return -1;
+    if(nodes[0].kind != MD_AST_BLOCK  ||  nodes[0].type != MD_BLOCK_DOC  ||  nodes[0].end != h->n_nodes)
+        return -1;
+
+    stack = (MD_OFFSET*) ast_resize(ast->allocator, NULL, 0, h->max_depth * sizeof(MD_OFFSET));
+    if(stack == NULL)
+        return -1;
+
+    for(i = 0; i < h->n_nodes; i++) {
+        const MD_AST_NODE* node = &nodes[i];
+
+        while(depth > 0  &&  nodes[stack[depth-1]].end == i)
+            depth--;
+        if((depth == 0) != (i == 0))
+            goto abort;
+        if(node->end <= i  ||  (depth > 0  &&  node->end > nodes[stack[depth-1]].end))
+            goto abort;
+        if(ast_check_node(ast, node) != 0)
+            goto abort;
+
+        if(node->kind == MD_AST_TEXT) {
+            if(node->end != i + 1)
+                goto abort;
+        } else {
+            if(depth >= h->max_depth)
+                goto abort;
+            stack[depth++] = i;
+        }
+    }
+    ret = 0;
+
+abort:
+    ast_release(ast->allocator, stack);
+    return ret;
+}
+
+MD_AST*
+md_ast_load(const void* blob, size_t blob_size,
+            const MD_CHAR* source, MD_SIZE source_size, unsigned parser_flags,
+            const MD_ALLOCATOR* allocator)
+{
+    MD_AST_HEADER h;
+    size_t size;
+    MD_AST* ast;
+
+    if(blob_size < sizeof(MD_AST_HEADER))
+        return NULL;
+    memcpy(&h, blob, sizeof(MD_AST_HEADER));
+    if(memcmp(h.magic, AST_MAGIC, sizeof(AST_MAGIC)) != 0  ||  h.version != MD_AST_VERSION  ||
+       h.byte_order != AST_BYTE_ORDER  ||  h.char_size != sizeof(MD_CHAR)  ||
+       h.parser_flags != parser_flags  ||  h.source_size != source_size)
+        return NULL;
+
+    /* The counts are 32 bits, so this cannot overflow a 64-bit size_t. On
+     * 32 bits, the blob cannot be that large anyway. */
+    size = sizeof(MD_AST_HEADER);
+    if(h.n_nodes > (blob_size - size) / sizeof(MD_AST_NODE))
+        return NULL;
+    size += h.n_nodes * sizeof(MD_AST_NODE);
+    if(h.n_words > (blob_size - size) / sizeof(MD_OFFSET))
+        return NULL;
+    size += h.n_words * sizeof(MD_OFFSET);
+    if(h.pool_size > (blob_size - size) / sizeof(MD_CHAR))
+        return NULL;
+    size += h.pool_size * sizeof(MD_CHAR);
+    if(size != blob_size)
+        return NULL;
+
+    if(h.source_hash != ast_hash(source, source_size))
+        return NULL;
+
+    ast = (MD_AST*) ast_resize(allocator, NULL, 0, sizeof(MD_AST) + size);
+    if(ast == NULL)
+        return NULL;
+    ast->allocator = allocator;
+    ast->size = size;
+    memcpy(AST_HEADER(ast), blob, size);
+
+    if(ast_check_nodes(ast) != 0) {
+        md_ast_free(ast);
+        return NULL;
+    }
+    return ast;
+}
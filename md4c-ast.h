@@ -0,0 +1,145 @@
+/*
+ * MD4C: Markdown parser for C
+ * (http://github.com/mity/md4c)
+ *
+ * Copyright (c) 2016-2017 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MD4C_AST_H
+#define MD4C_AST_H
+
+#include "md4c.h"
+
+#ifdef __cplusplus
+    extern "C" {
+#endif
+
+
+/* Parsed document kept as a flat array of nodes.
+ *
+ * The nodes are stored in the order md_parse() would call the callbacks for
+ * them. Each block or span node is followed by its children, and its end is
+ * the index of the first node behind them, so a whole subtree can be skipped
+ * at once. The first node is always the MD_BLOCK_DOC.
+ *
+ * Nothing in the tree is a pointer. Texts are offsets into the source, or
+ * into a string pool in the tree for the few texts md4c makes up itself
+ * (like unescaped link destinations). So the whole tree, including the
+ * details, is one block of memory which can be saved as it is and loaded
+ * again, see md_ast_blob() and md_ast_load(). The source is needed for
+ * anything but walking the nodes though.
+ */
+typedef struct MD_AST_tag MD_AST;
+
+typedef enum MD_AST_KIND {
+    MD_AST_BLOCK = 0,
+    MD_AST_SPAN,
+    MD_AST_TEXT
+} MD_AST_KIND;
+
+typedef struct MD_AST_NODE {
+    unsigned char kind;     /* MD_AST_KIND */
+    unsigned char type;     /* MD_BLOCKTYPE, MD_SPANTYPE or MD_TEXTTYPE as per kind. */
+    unsigned short flags;   /* Private. */
+    MD_OFFSET end;          /* Index of the node behind the subtree. */
+    MD_OFFSET data[2];      /* Private, see md_ast_text() and md_ast_detail(). */
+} MD_AST_NODE;
+
+/* Any of the details of md4c.h, as filled by md_ast_detail(). */
+typedef union MD_AST_DETAIL {
+    MD_BLOCK_UL_DETAIL ul;
+    MD_BLOCK_OL_DETAIL ol;
+    MD_BLOCK_LI_DETAIL li;
+    MD_BLOCK_H_DETAIL h;
+    MD_BLOCK_CODE_DETAIL code;
+    MD_BLOCK_TABLE_DETAIL table;
+    MD_BLOCK_TD_DETAIL td;
+    MD_SPAN_A_DETAIL a;
+    MD_SPAN_IMG_DETAIL img;
+    MD_SPAN_WIKILINK_DETAIL wikilink;
+} MD_AST_DETAIL;
+
+/* Version of the layout of the tree, and so of md_ast_blob(). */
+#define MD_AST_VERSION      1
+
+
+/* Parses the text like md_parse() with the parser_flags and returns the tree,
+ * or NULL if it fails.
+ *
+ * The optional allocator is used for the parsing and for the tree, which is
+ * a single allocation. So with md_arena_allocator() a document and its tree
+ * live in one arena.
+ */
+MD_AST* md_parse_to_ast(const MD_CHAR* text, MD_SIZE size, unsigned parser_flags,
+                        const MD_ALLOCATOR* allocator);
+
+void md_ast_free(MD_AST* ast);
+
+/* Returns the nodes, and their count in *p_count. */
+const MD_AST_NODE* md_ast_nodes(const MD_AST* ast, MD_SIZE* p_count);
+
+/* Returns the text of an MD_AST_TEXT node and its size in *p_size. Param
+ * source is the text the tree has been parsed from. */
+const MD_CHAR* md_ast_text(const MD_AST* ast, const MD_CHAR* source,
+                           const MD_AST_NODE* node, MD_SIZE* p_size);
+
+/* Fills in the detail of a block or span node and returns it as md_parse()
+ * would pass it to the callback, i.e. NULL for types without any detail. The
+ * attributes point into the source and into the tree. */
+void* md_ast_detail(const MD_AST* ast, const MD_CHAR* source,
+                    const MD_AST_NODE* node, MD_AST_DETAIL* detail);
+
+/* Calls the callbacks of the parser for the tree as md_parse() did when it
+ * was built; MD_PARSER::flags and the optional members are not used.
+ *
+ * Returns 0, -1 if some memory cannot be allocated, or the non-zero value
+ * returned by a callback, which aborts the replay.
+ */
+int md_ast_replay(const MD_AST* ast, const MD_CHAR* source,
+                  const MD_PARSER* parser, void* userdata);
+
+
+/* Returns the tree as a blob of *p_size bytes which can be stored and passed
+ * to md_ast_load() later. It is not a copy, it lives as long as the tree.
+ *
+ * The blob starts with MD_AST_VERSION and records the byte order, the size of
+ * MD_CHAR, the parser flags and a hash of the source. It does not contain the
+ * source itself.
+ */
+const void* md_ast_blob(const MD_AST* ast, size_t* p_size);
+
+/* Makes a tree of a copy of the blob if it has been made from the source with
+ * the parser_flags by this version of md4c on a machine of the same kind.
+ * Returns NULL otherwise, or if the allocation fails.
+ *
+ * The whole blob is checked, so a damaged one is rejected rather than making
+ * md_ast_replay() read out of bounds.
+ */
+MD_AST* md_ast_load(const void* blob, size_t blob_size,
+                    const MD_CHAR* source, MD_SIZE source_size, unsigned parser_flags,
+                    const MD_ALLOCATOR* allocator);
+
+
+#ifdef __cplusplus
+    }  /* extern "C" { */
+#endif
+
+#endif  /* MD4C_AST_H */
@@ -24,9 +24,11 @@
  */
 
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "md4c-html.h"
+#include "md4c-simd.h"
 #include "entity.h"
 
 
@@ -45,15 +47,49 @@
     #define snprintf _snprintf
 #endif
 
+/* Memory management, see md4c.c. */
+#ifndef MD_MALLOC
+    #define MD_MALLOC   malloc
+    #define MD_REALLOC  realloc
+    #define MD_FREE     free
+#else
+    void* MD_MALLOC(size_t size);
+    void* MD_REALLOC(void* ptr, size_t size);
+    void MD_FREE(void* ptr);
+#endif
+
 
 
 typedef struct MD_HTML_tag MD_HTML;
 struct MD_HTML_tag {
     void (*process_output)(const MD_CHAR*, MD_SIZE, void*);
+    void (*process_block)(MD_BLOCKTYPE, void*);
+    int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*);
     void* userdata;
     unsigned flags;
     int image_nesting_level;
+    int block_nesting_level;
     char escape_map[256];
+    MD_SIMD_MARKS html_escape;
+    MD_SIMD_MARKS url_escape;
+
+    /* Escaped text is assembled here so it can be passed to process_output()
+     * in one piece. */
+    MD_CHAR* escape_buffer;
+    MD_SIZE escape_alloc;
+
+    /* NULL for MD_MALLOC() and friends. */
+    const MD_ALLOCATOR* allocator;
+
+    /* NULL to parse on the calling thread only. */
+    const MD_WORKER_POOL* worker_pool;
+
+    /* If not NULL, the output is appended here instead of being passed to
+     * process_output(). */
+    MD_HTML_BUFFER* buffer;
+
+    /* Set to -1 when the buffer cannot grow, so the parsing is aborted. */
+    int error;
 };
 
 #define NEED_HTML_ESC_FLAG   0x1
@@ -70,9 +106,61 @@ struct MD_HTML_tag {
 #define ISALNUM(ch)     (ISLOWER(ch) || ISUPPER(ch) || ISDIGIT(ch))
 
 
+/* Makes room for at least size more bytes and the terminating NUL in
+ * r->buffer. */
+static int
+render_buffer_grow(MD_HTML* r, MD_SIZE size)
+{
+    MD_HTML_BUFFER* b = r->buffer;
+    MD_SIZE need;
+    MD_SIZE new_capacity;
+    MD_CHAR* new_data;
+
+    if(r->error != 0)
+        return -1;
+    if(size >= (MD_SIZE) -1 - b->size)
+        goto abort;
+
+    /* Grow by half at least so appending stays linear. */
+    need = b->size + size + 1;
+    if(b->capacity <= (MD_SIZE) -1 / 3 * 2)
+        new_capacity = b->capacity + b->capacity / 2;
+    else
+        new_capacity = (MD_SIZE) -1;
+    if(new_capacity < need)
+        new_capacity = (need > 256 ? need : 256);
+
+    if(b->allocator != NULL)
+        new_data = (MD_CHAR*) b->allocator->resize(b->data, b->capacity,
+                                                   new_capacity, b->allocator->userdata);
+    else
+        new_data = (MD_CHAR*) MD_REALLOC(b->data, new_capacity);
+    if(new_data == NULL)
+        goto abort;
+    b->data = new_data;
+    b->capacity = new_capacity;
+    return 0;
+
+abort:
+    r->error = -1;
+    return -1;
+}
+
 static inline void
 render_verbatim(MD_HTML* r, const MD_CHAR* text, MD_SIZE size)
 {
+    if(r->buffer != NULL) {
+        MD_HTML_BUFFER* b = r->buffer;
+
+        /* Everything goes right behind the previous output, so adjacent
+         * text runs and tags end up merged without any extra work. */
+        if(b->capacity - b->size > size  ||  render_buffer_grow(r, size) == 0) {
+            memcpy(b->data + b->size, text, size);
+            b->size += size;
+        }
+        return;
+    }
+
     r->process_output(text, size, r->userdata);
 }
 
@@ -82,38 +170,132 @@ render_verbatim(MD_HTML* r, const MD_CHAR* text, MD_SIZE size)
         render_verbatim((r), (verbatim), (MD_SIZE) (strlen(verbatim)))
 
 
+/* Makes room for at least size bytes in r->escape_buffer. */
+static int
+render_reserve(MD_HTML* r, MD_SIZE size)
+{
+    if(size > r->escape_alloc) {
+        MD_SIZE new_alloc = (r->escape_alloc > 0 ? r->escape_alloc : 256);
+        MD_CHAR* new_buffer;
+
+        while(new_alloc < size)
+            new_alloc = (new_alloc <= size / 2 ? new_alloc * 2 : size);
+        if(r->allocator != NULL)
+            new_buffer = (MD_CHAR*) r->allocator->resize(r->escape_buffer, r->escape_alloc,
+                                                         new_alloc, r->allocator->userdata);
+        else
+            new_buffer = (MD_CHAR*) MD_REALLOC(r->escape_buffer, new_alloc);
+        if(new_buffer == NULL)
+            return -1;
+        r->escape_buffer = new_buffer;
+        r->escape_alloc = new_alloc;
+    }
+    return 0;
+}
+
+/* Returns where escaped text of up to size bytes can be assembled: right in
+ * the output buffer if there is one, in r->escape_buffer otherwise. Returns
+ * NULL if there is not enough memory. */
+static MD_CHAR*
+render_escape_begin(MD_HTML* r, MD_SIZE size)
+{
+    if(r->buffer != NULL) {
+        if(r->buffer->capacity - r->buffer->size <= size  &&  render_buffer_grow(r, size) != 0)
+            return NULL;
+        return r->buffer->data + r->buffer->size;
+    }
+
+    if(render_reserve(r, size) != 0)
+        return NULL;
+    return r->escape_buffer;
+}
+
+/* Outputs the escaped text assembled up to out. */
+static void
+render_escape_end(MD_HTML* r, MD_CHAR* out)
+{
+    if(r->buffer != NULL)
+        r->buffer->size = (MD_SIZE) (out - r->buffer->data);
+    else
+        render_verbatim(r, r->escape_buffer, (MD_SIZE) (out - r->escape_buffer));
+}
+
+static void
+render_free_buffer(MD_HTML* r)
+{
+    if(r->escape_buffer != NULL) {
+        if(r->allocator != NULL)
+            r->allocator->release(r->escape_buffer, r->allocator->userdata);
+        else
+            MD_FREE(r->escape_buffer);
+    }
+    r->escape_buffer = NULL;
+    r->escape_alloc = 0;
+}
+
+/* Escaped text is assembled a slice of the input at a time, so the room
+ * reserved for the longest replacement of every character stays small. */
+#define RENDER_ESCAPE_SLICE     4096
+
+#define APPEND_LITERAL(out, literal)                                    \
+        do {                                                            \
+            memcpy((out), (literal), sizeof(literal) - 1);              \
+            (out) += sizeof(literal) - 1;                               \
+        } while(0)
+
 static void
 render_html_escaped(MD_HTML* r, const MD_CHAR* data, MD_SIZE size)
 {
     MD_OFFSET beg = 0;
-    MD_OFFSET off = 0;
+    MD_OFFSET off;
+    MD_OFFSET end;
+    MD_CHAR* out;
 
     /* Some characters need to be escaped in normal HTML text. */
-    #define NEED_HTML_ESC(ch)   (r->escape_map[(unsigned char)(ch)] & NEED_HTML_ESC_FLAG)
+    off = (MD_OFFSET) md_simd_find_mark(&r->html_escape, data, size);
+
+    /* Optimization: Most text needs no escaping at all. Otherwise assemble
+     * the escaped text in the buffer, "&quot;" is the longest replacement. */
+    while(off < size  &&  size <= (MD_SIZE) -1 / 2) {
+        end = (size - off > RENDER_ESCAPE_SLICE ? off + RENDER_ESCAPE_SLICE : size);
+        out = render_escape_begin(r, (off - beg) + (end - off) * 6);
+        if(out == NULL)
+            break;
 
-    while(1) {
-        /* Optimization: Use some loop unrolling. */
-        while(off + 3 < size  &&  !NEED_HTML_ESC(data[off+0])  &&  !NEED_HTML_ESC(data[off+1])
-                              &&  !NEED_HTML_ESC(data[off+2])  &&  !NEED_HTML_ESC(data[off+3]))
-            off += 4;
-        while(off < size  &&  !NEED_HTML_ESC(data[off]))
-            off++;
+        memcpy(out, data + beg, off - beg);
+        out += off - beg;
+        while(1) {
+            switch(data[off]) {
+                case '&':   APPEND_LITERAL(out, "&amp;"); break;
+                case '<':   APPEND_LITERAL(out, "&lt;"); break;
+                case '>':   APPEND_LITERAL(out, "&gt;"); break;
+                case '"':   APPEND_LITERAL(out, "&quot;"); break;
+            }
+            beg = ++off;
+            off += (MD_OFFSET) md_simd_find_mark(&r->html_escape, data + off, size - off);
+            if(off >= end)
+                break;
+            memcpy(out, data + beg, off - beg);
+            out += off - beg;
+        }
+        render_escape_end(r, out);
+    }
 
+    /* The rest needs no escaping, unless there has not been enough memory to
+     * assemble it. */
+    while(1) {
         if(off > beg)
             render_verbatim(r, data + beg, off - beg);
-
-        if(off < size) {
-            switch(data[off]) {
-                case '&':   RENDER_VERBATIM(r, "&amp;"); break;
-                case '<':   RENDER_VERBATIM(r, "&lt;"); break;
-                case '>':   RENDER_VERBATIM(r, "&gt;"); break;
-                case '"':   RENDER_VERBATIM(r, "&quot;"); break;
-            }
-            off++;
-        } else {
+        if(off >= size)
             break;
+        switch(data[off]) {
+            case '&':   RENDER_VERBATIM(r, "&amp;"); break;
+            case '<':   RENDER_VERBATIM(r, "&lt;"); break;
+            case '>':   RENDER_VERBATIM(r, "&gt;"); break;
+            case '"':   RENDER_VERBATIM(r, "&quot;"); break;
         }
-        beg = off;
+        beg = ++off;
+        off += (MD_OFFSET) md_simd_find_mark(&r->html_escape, data + off, size - off);
     }
 }
 
@@ -122,35 +304,59 @@ render_url_escaped(MD_HTML* r, const MD_CHAR* data, MD_SIZE size)
 {
     static const MD_CHAR hex_chars[] = "0123456789ABCDEF";
     MD_OFFSET beg = 0;
-    MD_OFFSET off = 0;
+    MD_OFFSET off;
+    MD_OFFSET end;
+    MD_CHAR* out;
 
     /* Some characters need to be escaped in URL attributes. */
-    #define NEED_URL_ESC(ch)    (r->escape_map[(unsigned char)(ch)] & NEED_URL_ESC_FLAG)
-
-    while(1) {
-        while(off < size  &&  !NEED_URL_ESC(data[off]))
-            off++;
-        if(off > beg)
-            render_verbatim(r, data + beg, off - beg);
+    off = (MD_OFFSET) md_simd_find_mark(&r->url_escape, data, size);
 
-        if(off < size) {
-            char hex[3];
+    /* Same as above, "&amp;" is the longest replacement. */
+    while(off < size  &&  size <= (MD_SIZE) -1 / 2) {
+        end = (size - off > RENDER_ESCAPE_SLICE ? off + RENDER_ESCAPE_SLICE : size);
+        out = render_escape_begin(r, (off - beg) + (end - off) * 5);
+        if(out == NULL)
+            break;
 
+        memcpy(out, data + beg, off - beg);
+        out += off - beg;
+        while(1) {
             switch(data[off]) {
-                case '&':   RENDER_VERBATIM(r, "&amp;"); break;
+                case '&':   APPEND_LITERAL(out, "&amp;"); break;
                 default:
-                    hex[0] = '%';
-                    hex[1] = hex_chars[((unsigned)data[off] >> 4) & 0xf];
-                    hex[2] = hex_chars[((unsigned)data[off] >> 0) & 0xf];
-                    render_verbatim(r, hex, 3);
+                    *out++ = '%';
+                    *out++ = hex_chars[((unsigned)data[off] >> 4) & 0xf];
+                    *out++ = hex_chars[((unsigned)data[off] >> 0) & 0xf];
                     break;
             }
-            off++;
-        } else {
-            break;
+            beg = ++off;
+            off += (MD_OFFSET) md_simd_find_mark(&r->url_escape, data + off, size - off);
+            if(off >= end)
+                break;
+            memcpy(out, data + beg, off - beg);
+            out += off - beg;
         }
+        render_escape_end(r, out);
+    }
 
-        beg = off;
+    while(1) {
+        char hex[3];
+
+        if(off > beg)
+            render_verbatim(r, data + beg, off - beg);
+        if(off >= size)
+            break;
+        switch(data[off]) {
+            case '&':   RENDER_VERBATIM(r, "&amp;"); break;
+            default:
+                hex[0] = '%';
+                hex[1] = hex_chars[((unsigned)data[off] >> 4) & 0xf];
+                hex[2] = hex_chars[((unsigned)data[off] >> 0) & 0xf];
+                render_verbatim(r, hex, 3);
+                break;
+        }
+        beg = ++off;
+        off += (MD_OFFSET) md_simd_find_mark(&r->url_escape, data + off, size - off);
     }
 }
 
@@ -381,6 +587,8 @@ enter_block_callback(MD_BLOCKTYPE type, void* detail, void* userdata)
     static const MD_CHAR* head[6] = { "<h1>", "<h2>", "<h3>", "<h4>", "<h5>", "<h6>" };
     MD_HTML* r = (MD_HTML*) userdata;
 
+    r->block_nesting_level++;
+
     switch(type) {
         case MD_BLOCK_DOC:      /* noop */ break;
         case MD_BLOCK_QUOTE:    RENDER_VERBATIM(r, "<blockquote>\n"); break;
@@ -400,7 +608,7 @@ enter_block_callback(MD_BLOCKTYPE type, void* detail, void* userdata)
         case MD_BLOCK_TD:       render_open_td_block(r, "td", (MD_BLOCK_TD_DETAIL*)detail); break;
     }
 
-    return 0;
+    return r->error;
 }
 
 static int
@@ -428,7 +636,12 @@ leave_block_callback(MD_BLOCKTYPE type, void* detail, void* userdata)
         case MD_BLOCK_TD:       RENDER_VERBATIM(r, "</td>\n"); break;
     }
 
-    return 0;
+    /* Level 1 is MD_BLOCK_DOC, so we have just left a top-level block. */
+    r->block_nesting_level--;
+    if(r->block_nesting_level == 1  &&  r->process_block != NULL)
+        r->process_block(type, r->userdata);
+
+    return r->error;
 }
 
 static int
@@ -468,7 +681,7 @@ enter_span_callback(MD_SPANTYPE type, void* detail, void* userdata)
         case MD_SPAN_WIKILINK:          render_open_wikilink_span(r, (MD_SPAN_WIKILINK_DETAIL*) detail); break;
     }
 
-    return 0;
+    return r->error;
 }
 
 static int
@@ -497,7 +710,7 @@ leave_span_callback(MD_SPANTYPE type, void* detail, void* userdata)
         case MD_SPAN_WIKILINK:          RENDER_VERBATIM(r, "</x-wikilink>"); break;
     }
 
-    return 0;
+    return r->error;
 }
 
 static int
@@ -517,7 +730,7 @@ text_callback(MD_TEXTTYPE type, const MD_CHAR* text, MD_SIZE size, void* userdat
         default:                render_html_escaped(r, text, size); break;
     }
 
-    return 0;
+    return r->error;
 }
 
 static void
@@ -528,14 +741,44 @@ debug_log_callback(const char* msg, void* userdata)
         fprintf(stderr, "MD4C: %s\n", msg);
 }
 
-int
-md_html(const MD_CHAR* input, MD_SIZE input_size,
-        void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
-        void* userdata, unsigned parser_flags, unsigned renderer_flags)
+static int
+top_level_block_callback(MD_TOP_LEVEL_BLOCK_DETAIL* detail, void* userdata)
+{
+    MD_HTML* r = (MD_HTML*) userdata;
+    return r->top_level_block(detail, r->userdata);
+}
+
+static void
+md_html_build_escape_maps(MD_HTML* r)
 {
-    MD_HTML render = { process_output, userdata, renderer_flags, 0, { 0 } };
     int i;
 
+    /* Build map of characters which need escaping. */
+    memset(r->escape_map, 0, sizeof(r->escape_map));
+    for(i = 0; i < 256; i++) {
+        unsigned char ch = (unsigned char) i;
+
+        if(strchr("\"&<>", ch) != NULL)
+            r->escape_map[i] |= NEED_HTML_ESC_FLAG;
+
+        if(!ISALNUM(ch)  &&  strchr("~-_.+!*(),%#@?=;:/,+$", ch) == NULL)
+            r->escape_map[i] |= NEED_URL_ESC_FLAG;
+    }
+    md_simd_marks_init(&r->html_escape, r->escape_map, NEED_HTML_ESC_FLAG);
+    md_simd_marks_init(&r->url_escape, r->escape_map, NEED_URL_ESC_FLAG);
+}
+
+/* Parses with md_parse_in_context() if context is not NULL, with md_parse()
+ * otherwise. */
+static int
+md_html_render(MD_HTML* r, MD_PARSER_CONTEXT* context,
+               const MD_CHAR* input, MD_SIZE input_size, unsigned parser_flags,
+               const MD_EDIT* edit, MD_REPARSE_INFO* info)
+{
+    MD_EDIT bom_edit;
+    MD_SIZE bom_size = 0;
+    int ret;
+
     MD_PARSER parser = {
         0,
         parser_flags,
@@ -545,29 +788,259 @@ md_html(const MD_CHAR* input, MD_SIZE input_size,
         leave_span_callback,
         text_callback,
         debug_log_callback,
-        NULL
+        NULL,
+        (r->top_level_block != NULL ? top_level_block_callback : NULL),
+        r->allocator,
+        r->worker_pool
     };
 
-    /* Build map of characters which need escaping. */
-    for(i = 0; i < 256; i++) {
-        unsigned char ch = (unsigned char) i;
+    /* Consider skipping UTF-8 byte order mark (BOM). */
+    if(r->flags & MD_HTML_FLAG_SKIP_UTF8_BOM  &&  sizeof(MD_CHAR) == 1) {
+        static const MD_CHAR bom[3] = { 0xef, 0xbb, 0xbf };
+        if(input_size >= sizeof(bom)  &&  memcmp(input, bom, sizeof(bom)) == 0) {
+            bom_size = sizeof(bom);
+            input += bom_size;
+            input_size -= bom_size;
+        }
+    }
 
-        if(strchr("\"&<>", ch) != NULL)
-            render.escape_map[i] |= NEED_HTML_ESC_FLAG;
+    r->error = 0;
 
-        if(!ISALNUM(ch)  &&  strchr("~-_.+!*(),%#@?=;:/,+$", ch) == NULL)
-            render.escape_map[i] |= NEED_URL_ESC_FLAG;
+    /* Reserve the output buffer at once. The HTML is mostly a bit larger than
+     * the Markdown, so that is the size it surely grows to, more is left to
+     * the growth on the way so a reused buffer does not stay oversized.
+     * Re-rendering only the blocks touched by an edit outputs much less. */
+    if(r->buffer != NULL  &&  edit == NULL) {
+        MD_SIZE estimate = input_size;
+
+        /* Failing that is no error yet, less may be enough. */
+        if(r->buffer->capacity - r->buffer->size <= estimate  &&  render_buffer_grow(r, estimate) != 0)
+            r->error = 0;
     }
 
-    /* Consider skipping UTF-8 byte order mark (BOM). */
-    if(renderer_flags & MD_HTML_FLAG_SKIP_UTF8_BOM  &&  sizeof(MD_CHAR) == 1) {
-        static const MD_CHAR bom[3] = { 0xef, 0xbb, 0xbf };
-        if(input_size >= sizeof(bom)  &&  memcmp(input, bom, sizeof(bom)) == 0) {
-            input += sizeof(bom);
-            input_size -= sizeof(bom);
+    if(info != NULL) {
+        /* An edit of the BOM itself needs a full parse. */
+        if(edit != NULL  &&  bom_size > 0) {
+            if(edit->beg >= bom_size) {
+                bom_edit = *edit;
+                bom_edit.beg -= bom_size;
+                edit = &bom_edit;
+            } else {
+                edit = NULL;
+            }
+        }
+
+        ret = md_reparse_in_context(context, input, input_size, edit, &parser, (void*) r, info);
+        if(ret == 0) {
+            info->beg += bom_size;
+            info->end += bom_size;
         }
+    } else if(context != NULL) {
+        ret = md_parse_in_context(context, input, input_size, &parser, (void*) r);
+    } else {
+        ret = md_parse(input, input_size, &parser, (void*) r);
+    }
+
+    if(r->buffer != NULL) {
+        if(r->error != 0)
+            ret = -1;
+        else if(r->buffer->capacity > 0)
+            r->buffer->data[r->buffer->size] = '\0';
+    }
+    return ret;
+}
+
+int
+md_html(const MD_CHAR* input, MD_SIZE input_size,
+        void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+        void* userdata, unsigned parser_flags, unsigned renderer_flags)
+{
+    return md_html_blocks(input, input_size, process_output, NULL, NULL,
+                          userdata, parser_flags, renderer_flags);
+}
+
+int
+md_html_blocks(const MD_CHAR* input, MD_SIZE input_size,
+               void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+               void (*process_block)(MD_BLOCKTYPE, void*),
+               int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+               void* userdata, unsigned parser_flags, unsigned renderer_flags)
+{
+    MD_HTML render;
+    int ret;
+
+    memset(&render, 0, sizeof(MD_HTML));
+    render.process_output = process_output;
+    render.process_block = process_block;
+    render.top_level_block = top_level_block;
+    render.userdata = userdata;
+    render.flags = renderer_flags;
+    md_html_build_escape_maps(&render);
+    ret = md_html_render(&render, NULL, input, input_size, parser_flags, NULL, NULL);
+    render_free_buffer(&render);
+    return ret;
+}
+
+int
+md_html_to_buffer(const MD_CHAR* input, MD_SIZE input_size, MD_HTML_BUFFER* buffer,
+                  unsigned parser_flags, unsigned renderer_flags)
+{
+    MD_HTML render;
+    int ret;
+
+    memset(&render, 0, sizeof(MD_HTML));
+    render.flags = renderer_flags;
+    render.buffer = buffer;
+    md_html_build_escape_maps(&render);
+    ret = md_html_render(&render, NULL, input, input_size, parser_flags, NULL, NULL);
+    render_free_buffer(&render);
+    return ret;
+}
+
+int
+md_html_ast(const MD_AST* ast, const MD_CHAR* source,
+            void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+            void* userdata, unsigned renderer_flags)
+{
+    MD_HTML render;
+    int ret;
+
+    MD_PARSER parser = {
+        0,
+        0,
+        enter_block_callback,
+        leave_block_callback,
+        enter_span_callback,
+        leave_span_callback,
+        text_callback,
+        NULL,
+        NULL,
+        NULL,
+        NULL,
+        NULL
+    };
+
+    memset(&render, 0, sizeof(MD_HTML));
+    render.process_output = process_output;
+    render.userdata = userdata;
+    render.flags = renderer_flags;
+    md_html_build_escape_maps(&render);
+    ret = md_ast_replay(ast, source, &parser, (void*) &render);
+    render_free_buffer(&render);
+    return ret;
+}
+
+void
+md_html_buffer_free(MD_HTML_BUFFER* buffer)
+{
+    if(buffer->data != NULL) {
+        if(buffer->allocator != NULL)
+            buffer->allocator->release(buffer->data, buffer->allocator->userdata);
+        else
+            MD_FREE(buffer->data);
     }
+    buffer->data = NULL;
+    buffer->size = 0;
+    buffer->capacity = 0;
+}
+
+
+struct MD_HTML_CONTEXT_tag {
+    /* Only the escape tables and the escape buffer are kept between calls. */
+    MD_HTML render;
+    MD_PARSER_CONTEXT* parser;
+};
+
+MD_HTML_CONTEXT*
+md_html_context_new(const MD_ALLOCATOR* allocator)
+{
+    MD_HTML_CONTEXT* context;
+
+    context = (MD_HTML_CONTEXT*) MD_MALLOC(sizeof(MD_HTML_CONTEXT));
+    if(context == NULL)
+        return NULL;
+    memset(context, 0, sizeof(MD_HTML_CONTEXT));
 
-    return md_parse(input, input_size, &parser, (void*) &render);
+    context->parser = md_parser_context_new();
+    if(context->parser == NULL) {
+        MD_FREE(context);
+        return NULL;
+    }
+    md_html_build_escape_maps(&context->render);
+    context->render.allocator = allocator;
+    return context;
 }
 
+void
+md_html_context_free(MD_HTML_CONTEXT* context)
+{
+    if(context == NULL)
+        return;
+    md_parser_context_free(context->parser);
+    render_free_buffer(&context->render);
+    MD_FREE(context);
+}
+
+void
+md_html_context_set_worker_pool(MD_HTML_CONTEXT* context, const MD_WORKER_POOL* pool)
+{
+    context->render.worker_pool = pool;
+}
+
+void
+md_html_context_set_buffer(MD_HTML_CONTEXT* context, MD_HTML_BUFFER* buffer)
+{
+    context->render.buffer = buffer;
+}
+
+void
+md_html_context_trim(MD_HTML_CONTEXT* context)
+{
+    md_parser_context_trim(context->parser);
+    render_free_buffer(&context->render);
+}
+
+int
+md_html_in_context(MD_HTML_CONTEXT* context,
+                   const MD_CHAR* input, MD_SIZE input_size,
+                   void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                   void* userdata, unsigned parser_flags, unsigned renderer_flags)
+{
+    return md_html_blocks_in_context(context, input, input_size, process_output,
+                                     NULL, NULL, userdata, parser_flags, renderer_flags);
+}
+
+int
+md_html_blocks_in_context(MD_HTML_CONTEXT* context,
+                          const MD_CHAR* input, MD_SIZE input_size,
+                          void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                          void (*process_block)(MD_BLOCKTYPE, void*),
+                          int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+                          void* userdata, unsigned parser_flags, unsigned renderer_flags)
+{
+    return md_html_blocks_reparse_in_context(context, input, input_size, NULL,
+                process_output, process_block, top_level_block, userdata,
+                parser_flags, renderer_flags, NULL);
+}
+
+int
+md_html_blocks_reparse_in_context(MD_HTML_CONTEXT* context,
+                                  const MD_CHAR* input, MD_SIZE input_size, const MD_EDIT* edit,
+                                  void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                                  void (*process_block)(MD_BLOCKTYPE, void*),
+                                  int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+                                  void* userdata, unsigned parser_flags, unsigned renderer_flags,
+                                  MD_REPARSE_INFO* info)
+{
+    MD_HTML* r = &context->render;
+
+    r->process_output = process_output;
+    r->process_block = process_block;
+    r->top_level_block = top_level_block;
+    r->userdata = userdata;
+    r->flags = renderer_flags;
+    r->image_nesting_level = 0;
+    r->block_nesting_level = 0;
+
+    return md_html_render(r, context->parser, input, input_size, parser_flags, edit, info);
+}
@@ -27,6 +27,7 @@
 #define MD4C_HTML_H
 
 #include "md4c.h"
+#include "md4c-ast.h"
 
 #ifdef __cplusplus
     extern "C" {
@@ -60,6 +61,122 @@ int md_html(const MD_CHAR* input, MD_SIZE input_size,
             void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
             void* userdata, unsigned parser_flags, unsigned renderer_flags);
 
+/* Same as md_html() but additionally calls process_block() whenever a
+ * top-level block has been rendered completely, so the output generated since
+ * the previous call (or since the start) is exactly the HTML of that block.
+ * The block type is passed so the caller can e.g. treat raw HTML blocks, which
+ * may be unbalanced, specially.
+ *
+ * Nothing is ever output between top-level blocks, so the callback splits the
+ * whole output into self-contained pieces which can be compared or updated
+ * one by one.
+ *
+ * Optional top_level_block() is propagated as MD_PARSER::top_level_block().
+ * If it skips a block, nothing is output for it and process_block() is not
+ * called, so the caller may output e.g. a cached rendering of it instead.
+ */
+int md_html_blocks(const MD_CHAR* input, MD_SIZE input_size,
+                   void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                   void (*process_block)(MD_BLOCKTYPE, void*),
+                   int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+                   void* userdata, unsigned parser_flags, unsigned renderer_flags);
+
+
+/* Same as md_html() but renders a tree of md_parse_to_ast() (or md_ast_load())
+ * parsed from the source, without parsing it again.
+ *
+ * MD_HTML_FLAG_SKIP_UTF8_BOM has no effect here, the tree has to be parsed
+ * from the text behind the BOM for that.
+ */
+int md_html_ast(const MD_AST* ast, const MD_CHAR* source,
+                void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                void* userdata, unsigned renderer_flags);
+
+
+/* Growable buffer the HTML can be rendered into instead of passing it to a
+ * callback piece by piece, see md_html_to_buffer().
+ *
+ * The output is appended behind the first size bytes of data, which is grown
+ * as needed and NUL-terminated when the rendering is done. Start with
+ * a zeroed buffer and keep it between the calls (with size reset to 0 or not)
+ * to reuse the memory. The optional allocator is used for data, with
+ * MD_MALLOC() and friends used if it is NULL.
+ */
+typedef struct MD_HTML_BUFFER {
+    MD_CHAR* data;
+    MD_SIZE size;
+    MD_SIZE capacity;
+    const MD_ALLOCATOR* allocator;
+} MD_HTML_BUFFER;
+
+/* Same as md_html() but appends the output to the buffer.
+ *
+ * Capacity for input_size more bytes is reserved at the start, which the
+ * output of most documents does not outgrow by much. Returns -1 also if the
+ * buffer cannot grow, the buffer holds the output up to that point then.
+ */
+int md_html_to_buffer(const MD_CHAR* input, MD_SIZE input_size, MD_HTML_BUFFER* buffer,
+                      unsigned parser_flags, unsigned renderer_flags);
+
+/* Frees the data of the buffer and resets it to zero size. */
+void md_html_buffer_free(MD_HTML_BUFFER* buffer);
+
+
+/* Opaque renderer context, see MD_PARSER_CONTEXT in md4c.h.
+ *
+ * It keeps the parser buffers, the escaping tables and the buffer for
+ * escaped text between calls, so rendering the same document again (e.g.
+ * after a small edit) does not allocate anything.
+ *
+ * A context may be used by one thread at a time only.
+ */
+typedef struct MD_HTML_CONTEXT_tag MD_HTML_CONTEXT;
+
+/* Optional allocator is used for all the buffers, the context itself is
+ * always allocated with malloc(). Returns NULL if the allocation fails. */
+MD_HTML_CONTEXT* md_html_context_new(const MD_ALLOCATOR* allocator);
+
+void md_html_context_free(MD_HTML_CONTEXT* context);
+
+/* Makes the renders with the context analyze inlines of large documents on
+ * the pool (may be NULL), see MD_WORKER_POOL. The output stays the same. */
+void md_html_context_set_worker_pool(MD_HTML_CONTEXT* context, const MD_WORKER_POOL* pool);
+
+/* Makes the renders with the context append the output to the buffer (if not
+ * NULL) like md_html_to_buffer(), process_output() is not called then and may
+ * be NULL. process_block() and top_level_block() are called as usual and may
+ * look at the output rendered so far, or append to it themselves. The buffer
+ * is not owned by the context. */
+void md_html_context_set_buffer(MD_HTML_CONTEXT* context, MD_HTML_BUFFER* buffer);
+
+/* Frees the buffers retained by the context. The context remains usable. */
+void md_html_context_trim(MD_HTML_CONTEXT* context);
+
+/* Same as md_html() and md_html_blocks() but use the context. */
+int md_html_in_context(MD_HTML_CONTEXT* context,
+                       const MD_CHAR* input, MD_SIZE input_size,
+                       void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                       void* userdata, unsigned parser_flags, unsigned renderer_flags);
+int md_html_blocks_in_context(MD_HTML_CONTEXT* context,
+                              const MD_CHAR* input, MD_SIZE input_size,
+                              void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                              void (*process_block)(MD_BLOCKTYPE, void*),
+                              int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+                              void* userdata, unsigned parser_flags, unsigned renderer_flags);
+
+/* Renders only the top-level blocks affected by the edit since the last call
+ * with the context, see md_reparse_in_context(). The output replaces that of
+ * info->old_block_count top-level blocks from info->first_block on in the
+ * previous output. The offsets in info are relative to input, even if a BOM
+ * is skipped. */
+int md_html_blocks_reparse_in_context(MD_HTML_CONTEXT* context,
+                                      const MD_CHAR* input, MD_SIZE input_size, const MD_EDIT* edit,
+                                      void (*process_output)(const MD_CHAR*, MD_SIZE, void*),
+                                      void (*process_block)(MD_BLOCKTYPE, void*),
+                                      int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL*, void*),
+                                      void* userdata, unsigned parser_flags, unsigned renderer_flags,
+                                      MD_REPARSE_INFO* info);
+
 
 #ifdef __cplusplus
     }  /* extern "C" { */
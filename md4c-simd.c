@@ -0,0 +1,650 @@
+/*
+ * MD4C: Markdown parser for C
+ * (http://github.com/mity/md4c)
+ *
+ * Copyright (c) 2016-2020 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#include "md4c-simd.h"
+
+#include <string.h>
+
+#if !defined MD4C_NO_SIMD
+#if defined __x86_64__ || defined _M_X64 || defined __SSE2__ || \
+	(defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define MD_SIMD_X86
+#elif defined __aarch64__ && (defined __GNUC__ || defined __clang__)
+#define MD_SIMD_NEON
+#endif
+#endif
+
+#ifdef MD_SIMD_X86
+#include <immintrin.h>
+#if defined __GNUC__ || defined __clang__
+#define MD_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define MD_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MD_TARGET_SSSE3
+#define MD_TARGET_AVX2
+#endif
+#endif
+
+#ifdef MD_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined _MSC_VER && !defined __clang__
+#include <intrin.h>
+static inline unsigned md_ctz(unsigned x)
+{
+	unsigned long idx;
+	_BitScanForward(&idx, x);
+	return (unsigned)idx;
+}
+#else
+#define md_ctz(x) ((unsigned)__builtin_ctz(x))
+#endif
+
+/* Bit (ch >> 4) for every ASCII high nibble, nothing for bytes >= 0x80. */
+static const unsigned char md_high_nibble_bits[16] = {
+	0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, 0, 0, 0, 0, 0, 0, 0, 0};
+
+static size_t md_find_mark_scalar(const MD_SIMD_MARKS *marks, const char *str,
+				  size_t size)
+{
+	const char *map = marks->map;
+	const char mask = marks->mask;
+	size_t i = 0;
+
+#define IN_SET(ch) (map[(unsigned char)(ch)] & mask)
+	while (i + 3 < size && !IN_SET(str[i + 0]) && !IN_SET(str[i + 1]) &&
+	       !IN_SET(str[i + 2]) && !IN_SET(str[i + 3]))
+		i += 4;
+	while (i < size && !IN_SET(str[i]))
+		i++;
+#undef IN_SET
+	return i;
+}
+
+#ifdef MD_SIMD_X86
+MD_TARGET_SSSE3
+static size_t md_find_mark_ssse3(const MD_SIMD_MARKS *marks, const char *str,
+				 size_t size)
+{
+	const __m128i lo_map =
+		_mm_loadu_si128((const __m128i *)marks->nibble_map);
+	const __m128i hi_map =
+		_mm_loadu_si128((const __m128i *)md_high_nibble_bits);
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	const unsigned high = marks->high ? 0xffff : 0;
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16) {
+		__m128i v = _mm_loadu_si128((const __m128i *)(str + i));
+		__m128i lo = _mm_shuffle_epi8(lo_map, _mm_and_si128(v, nibble));
+		__m128i hi = _mm_shuffle_epi8(
+			hi_map, _mm_and_si128(_mm_srli_epi16(v, 4), nibble));
+		__m128i none = _mm_cmpeq_epi8(_mm_and_si128(lo, hi),
+					      _mm_setzero_si128());
+		unsigned mask = (~(unsigned)_mm_movemask_epi8(none) |
+				 ((unsigned)_mm_movemask_epi8(v) & high)) &
+				0xffff;
+
+		if (mask != 0)
+			return i + md_ctz(mask);
+	}
+
+	return i + md_find_mark_scalar(marks, str + i, size - i);
+}
+#endif
+
+#ifdef MD_SIMD_X86
+MD_TARGET_AVX2
+static size_t md_find_mark_avx2(const MD_SIMD_MARKS *marks, const char *str,
+				size_t size)
+{
+	const __m128i lo_map =
+		_mm_loadu_si128((const __m128i *)marks->nibble_map);
+	const __m128i hi_map =
+		_mm_loadu_si128((const __m128i *)md_high_nibble_bits);
+	const __m256i lo_map2 = _mm256_broadcastsi128_si256(lo_map);
+	const __m256i hi_map2 = _mm256_broadcastsi128_si256(hi_map);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const unsigned high = marks->high ? 0xffffffff : 0;
+	size_t i = 0;
+
+	for (; i + 32 <= size; i += 32) {
+		__m256i v = _mm256_loadu_si256((const __m256i *)(str + i));
+		__m256i lo = _mm256_shuffle_epi8(lo_map2,
+						 _mm256_and_si256(v, nibble));
+		__m256i hi = _mm256_shuffle_epi8(
+			hi_map2,
+			_mm256_and_si256(_mm256_srli_epi16(v, 4), nibble));
+		__m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi),
+						 _mm256_setzero_si256());
+		unsigned mask = ~(unsigned)_mm256_movemask_epi8(none) |
+				((unsigned)_mm256_movemask_epi8(v) & high);
+
+		if (mask != 0)
+			return i + md_ctz(mask);
+	}
+
+	/* Avoid AVX-SSE transition stalls in the caller. */
+	_mm256_zeroupper();
+	return i + md_find_mark_ssse3(marks, str + i, size - i);
+}
+
+#define MD_CPU_SSSE3 0x1
+#define MD_CPU_AVX2 0x2
+
+static int md_cpu_features(void)
+{
+	int features = 0;
+#if defined _MSC_VER && !defined __clang__
+	int info[4];
+	int max_leaf;
+
+	__cpuid(info, 0);
+	max_leaf = info[0];
+	__cpuid(info, 1);
+	if (info[2] & (1 << 9))
+		features |= MD_CPU_SSSE3;
+	/* AVX2 also needs the OS to save the YMM registers. */
+	if (max_leaf >= 7 && (info[2] & (1 << 27)) && (info[2] & (1 << 28)) &&
+	    (_xgetbv(0) & 6) == 6) {
+		__cpuidex(info, 7, 0);
+		if (info[1] & (1 << 5))
+			features |= MD_CPU_AVX2;
+	}
+#else
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("ssse3"))
+		features |= MD_CPU_SSSE3;
+	if (__builtin_cpu_supports("avx2"))
+		features |= MD_CPU_AVX2;
+#endif
+	return features;
+}
+#endif
+
+#ifdef MD_SIMD_NEON
+static size_t md_find_mark_neon(const MD_SIMD_MARKS *marks, const char *str,
+				size_t size)
+{
+	const uint8x16_t lo_map = vld1q_u8(marks->nibble_map);
+	const uint8x16_t hi_map = vld1q_u8(md_high_nibble_bits);
+	const uint8x16_t nibble = vdupq_n_u8(0x0f);
+	const uint8x16_t high = vdupq_n_u8(marks->high ? 0x80 : 0);
+	size_t i = 0;
+
+	for (; i + 16 <= size; i += 16) {
+		uint8x16_t v = vld1q_u8((const unsigned char *)str + i);
+		uint8x16_t lo = vqtbl1q_u8(lo_map, vandq_u8(v, nibble));
+		uint8x16_t hi = vqtbl1q_u8(hi_map, vshrq_n_u8(v, 4));
+		uint8x16_t hit = vorrq_u8(vtstq_u8(lo, hi), vtstq_u8(v, high));
+		uint64_t mask;
+
+		if (vmaxvq_u8(hit) == 0)
+			continue;
+		/* Four bits per byte, in byte order. */
+		mask = vget_lane_u64(
+			vreinterpret_u64_u8(
+				vshrn_n_u16(vreinterpretq_u16_u8(hit), 4)),
+			0);
+		return i + (size_t)(__builtin_ctzll(mask) >> 2);
+	}
+
+	return i + md_find_mark_scalar(marks, str + i, size - i);
+}
+#endif
+
+void md_simd_marks_init(MD_SIMD_MARKS *marks, const char *map, char mask)
+{
+	int n_high = 0;
+	int ch;
+#ifdef MD_SIMD_X86
+	int features;
+#endif
+
+	marks->map = map;
+	marks->mask = mask;
+	memset(marks->nibble_map, 0, sizeof(marks->nibble_map));
+	for (ch = 0; ch < 256; ch++) {
+		if (!(map[ch] & mask))
+			continue;
+		if (ch >= 128)
+			n_high++;
+		else
+			marks->nibble_map[ch & 0x0f] |=
+				(unsigned char)(1 << (ch >> 4));
+	}
+	marks->high = (n_high == 128);
+
+	marks->find = md_find_mark_scalar;
+	if (n_high != 0 && n_high != 128)
+		return;
+
+#ifdef MD_SIMD_X86
+	features = md_cpu_features();
+	if (features & MD_CPU_AVX2)
+		marks->find = md_find_mark_avx2;
+	else if (features & MD_CPU_SSSE3)
+		marks->find = md_find_mark_ssse3;
+#endif
+#ifdef MD_SIMD_NEON
+	marks->find = md_find_mark_neon;
+#endif
+}
+
+/* UTF-8 validation looks at every byte together with the one before it. The
+ * high nibble of the previous byte, its low nibble and the high nibble of the
+ * byte itself each select the errors the pair could be part of; the pair is
+ * invalid if all three have one in common. A continuation may follow another
+ * one only as the third or fourth byte of a sequence, that is checked against
+ * the bytes two and three positions back. */
+#define MD_UTF8_TOO_SHORT 0x01      /* 11______ 0_______, 11______ 11______ */
+#define MD_UTF8_TOO_LONG 0x02       /* 0_______ 10______ */
+#define MD_UTF8_OVERLONG_3 0x04     /* 11100000 100_____ */
+#define MD_UTF8_TOO_LARGE 0x08      /* 11110100 1001____ and above */
+#define MD_UTF8_SURROGATE 0x10      /* 11101101 101_____ */
+#define MD_UTF8_OVERLONG_2 0x20     /* 1100000_ 10______ */
+#define MD_UTF8_TOO_LARGE_1000 0x40 /* 11110101 1000____ and above */
+#define MD_UTF8_OVERLONG_4 0x40     /* 11110000 1000____ */
+#define MD_UTF8_TWO_CONTS 0x80      /* 10______ 10______ */
+#define MD_UTF8_CARRY \
+	(MD_UTF8_TOO_SHORT | MD_UTF8_TOO_LONG | MD_UTF8_TWO_CONTS)
+
+#if defined MD_SIMD_X86 || defined MD_SIMD_NEON
+/* Indexed by the high nibble of the previous byte. */
+static const unsigned char md_utf8_byte_1_high[16] = {
+	/* 0_______ */
+	MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG,
+	MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG, MD_UTF8_TOO_LONG,
+	/* 10______ */
+	MD_UTF8_TWO_CONTS, MD_UTF8_TWO_CONTS, MD_UTF8_TWO_CONTS,
+	MD_UTF8_TWO_CONTS,
+	/* 1100____ */
+	MD_UTF8_TOO_SHORT | MD_UTF8_OVERLONG_2,
+	/* 1101____ */
+	MD_UTF8_TOO_SHORT,
+	/* 1110____ */
+	MD_UTF8_TOO_SHORT | MD_UTF8_OVERLONG_3 | MD_UTF8_SURROGATE,
+	/* 1111____ */
+	MD_UTF8_TOO_SHORT | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000 |
+		MD_UTF8_OVERLONG_4};
+
+/* Indexed by the low nibble of the previous byte. */
+static const unsigned char md_utf8_byte_1_low[16] = {
+	/* ____0000 */
+	MD_UTF8_CARRY | MD_UTF8_OVERLONG_3 | MD_UTF8_OVERLONG_2 |
+		MD_UTF8_OVERLONG_4,
+	/* ____0001 */
+	MD_UTF8_CARRY | MD_UTF8_OVERLONG_2,
+	/* ____001_ */
+	MD_UTF8_CARRY, MD_UTF8_CARRY,
+	/* ____0100 */
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE,
+	/* ____0101 to ____1100 */
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	/* ____1101 */
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000 |
+		MD_UTF8_SURROGATE,
+	/* ____111_ */
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000,
+	MD_UTF8_CARRY | MD_UTF8_TOO_LARGE | MD_UTF8_TOO_LARGE_1000};
+
+/* Indexed by the high nibble of the byte. */
+static const unsigned char md_utf8_byte_2_high[16] = {
+	/* 0_______ */
+	MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT,
+	MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT,
+	MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT,
+	/* 1000____ */
+	MD_UTF8_TOO_LONG | MD_UTF8_OVERLONG_2 | MD_UTF8_TWO_CONTS |
+		MD_UTF8_OVERLONG_3 | MD_UTF8_TOO_LARGE_1000 |
+		MD_UTF8_OVERLONG_4,
+	/* 1001____ */
+	MD_UTF8_TOO_LONG | MD_UTF8_OVERLONG_2 | MD_UTF8_TWO_CONTS |
+		MD_UTF8_OVERLONG_3 | MD_UTF8_TOO_LARGE,
+	/* 101_____ */
+	MD_UTF8_TOO_LONG | MD_UTF8_OVERLONG_2 | MD_UTF8_TWO_CONTS |
+		MD_UTF8_SURROGATE | MD_UTF8_TOO_LARGE,
+	MD_UTF8_TOO_LONG | MD_UTF8_OVERLONG_2 | MD_UTF8_TWO_CONTS |
+		MD_UTF8_SURROGATE | MD_UTF8_TOO_LARGE,
+	/* 11______ */
+	MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT, MD_UTF8_TOO_SHORT,
+	MD_UTF8_TOO_SHORT};
+
+/* Bytes above these in the last positions of a block start a sequence which
+ * continues in the next block. */
+static const unsigned char md_utf8_max_incomplete[32] = {
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+	0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0 - 1, 0xe0 - 1, 0xc0 - 1};
+#endif
+
+#ifndef MD_SIMD_NEON
+static int md_classify_text_scalar(const char *str, size_t size)
+{
+	const unsigned char *s = (const unsigned char *)str;
+	int ascii = 1;
+	size_t i = 0;
+
+	while (i < size) {
+		unsigned char lead = s[i];
+		unsigned char min = 0x80;
+		unsigned char max = 0xbf;
+		size_t n, k;
+
+		if (lead < 0x80) {
+			i++;
+			continue;
+		}
+
+		ascii = 0;
+		if (lead >= 0xc2 && lead <= 0xdf) {
+			n = 1;
+		} else if (lead >= 0xe0 && lead <= 0xef) {
+			n = 2;
+			if (lead == 0xe0)
+				min = 0xa0;
+			else if (lead == 0xed)
+				max = 0x9f;
+		} else if (lead >= 0xf0 && lead <= 0xf4) {
+			n = 3;
+			if (lead == 0xf0)
+				min = 0x90;
+			else if (lead == 0xf4)
+				max = 0x8f;
+		} else {
+			return MD_SIMD_TEXT_OTHER;
+		}
+
+		if (size - i <= n || s[i + 1] < min || s[i + 1] > max)
+			return MD_SIMD_TEXT_OTHER;
+		for (k = 2; k <= n; k++) {
+			if ((s[i + k] & 0xc0) != 0x80)
+				return MD_SIMD_TEXT_OTHER;
+		}
+		i += n + 1;
+	}
+
+	return (ascii ? MD_SIMD_TEXT_ASCII : MD_SIMD_TEXT_UTF8);
+}
+#endif
+
+/* The kernels below go through the text block by block and then through one
+ * more block with the rest of it padded with zeros, so a sequence cut off at
+ * the end is an error like a sequence followed by ASCII. */
+
+#ifdef MD_SIMD_X86
+MD_TARGET_SSSE3
+static int md_classify_text_ssse3(const char *str, size_t size)
+{
+	const __m128i byte_1_high =
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_1_high);
+	const __m128i byte_1_low =
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_1_low);
+	const __m128i byte_2_high =
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_2_high);
+	const __m128i max_incomplete =
+		_mm_loadu_si128((const __m128i *)(md_utf8_max_incomplete + 16));
+	const __m128i nibble = _mm_set1_epi8(0x0f);
+	const __m128i third = _mm_set1_epi8(0xe0 - 0x80);
+	const __m128i fourth = _mm_set1_epi8(0xf0 - 0x80);
+	const __m128i high_bit = _mm_set1_epi8((char)0x80);
+	__m128i prev = _mm_setzero_si128();
+	__m128i prev_incomplete = _mm_setzero_si128();
+	__m128i error = _mm_setzero_si128();
+	char tail[16];
+	int ascii = 1;
+	size_t i = 0;
+
+	while (1) {
+		__m128i v;
+
+		if (i + 16 <= size) {
+			v = _mm_loadu_si128((const __m128i *)(str + i));
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, str + i, size - i);
+			v = _mm_loadu_si128((const __m128i *)tail);
+		}
+
+		if (_mm_movemask_epi8(v) == 0) {
+			error = _mm_or_si128(error, prev_incomplete);
+		} else {
+			__m128i prev1 = _mm_alignr_epi8(v, prev, 15);
+			__m128i prev2 = _mm_alignr_epi8(v, prev, 14);
+			__m128i prev3 = _mm_alignr_epi8(v, prev, 13);
+			__m128i special = _mm_and_si128(
+				_mm_and_si128(
+					_mm_shuffle_epi8(
+						byte_1_high,
+						_mm_and_si128(
+							_mm_srli_epi16(prev1, 4),
+							nibble)),
+					_mm_shuffle_epi8(
+						byte_1_low,
+						_mm_and_si128(prev1, nibble))),
+				_mm_shuffle_epi8(
+					byte_2_high,
+					_mm_and_si128(_mm_srli_epi16(v, 4),
+						      nibble)));
+			__m128i must_23 = _mm_and_si128(
+				_mm_or_si128(_mm_subs_epu8(prev2, third),
+					     _mm_subs_epu8(prev3, fourth)),
+				high_bit);
+
+			error = _mm_or_si128(error,
+					     _mm_xor_si128(must_23, special));
+			prev_incomplete = _mm_subs_epu8(v, max_incomplete);
+			ascii = 0;
+		}
+
+		if (i + 16 > size)
+			break;
+		prev = v;
+		i += 16;
+	}
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(error, _mm_setzero_si128())) !=
+	    0xffff)
+		return MD_SIMD_TEXT_OTHER;
+	return (ascii ? MD_SIMD_TEXT_ASCII : MD_SIMD_TEXT_UTF8);
+}
+
+MD_TARGET_AVX2
+static int md_classify_text_avx2(const char *str, size_t size)
+{
+	const __m256i byte_1_high = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_1_high));
+	const __m256i byte_1_low = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_1_low));
+	const __m256i byte_2_high = _mm256_broadcastsi128_si256(
+		_mm_loadu_si128((const __m128i *)md_utf8_byte_2_high));
+	const __m256i max_incomplete =
+		_mm256_loadu_si256((const __m256i *)md_utf8_max_incomplete);
+	const __m256i nibble = _mm256_set1_epi8(0x0f);
+	const __m256i third = _mm256_set1_epi8(0xe0 - 0x80);
+	const __m256i fourth = _mm256_set1_epi8(0xf0 - 0x80);
+	const __m256i high_bit = _mm256_set1_epi8((char)0x80);
+	__m256i prev = _mm256_setzero_si256();
+	__m256i prev_incomplete = _mm256_setzero_si256();
+	__m256i error = _mm256_setzero_si256();
+	char tail[32];
+	int ascii = 1;
+	int ret;
+	size_t i = 0;
+
+	while (1) {
+		__m256i v;
+
+		if (i + 32 <= size) {
+			v = _mm256_loadu_si256((const __m256i *)(str + i));
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, str + i, size - i);
+			v = _mm256_loadu_si256((const __m256i *)tail);
+		}
+
+		if (_mm256_movemask_epi8(v) == 0) {
+			error = _mm256_or_si256(error, prev_incomplete);
+		} else {
+			/* The previous bytes of the low lane are in the high
+			 * lane of prev. */
+			__m256i shifted = _mm256_permute2x128_si256(prev, v,
+								    0x21);
+			__m256i prev1 = _mm256_alignr_epi8(v, shifted, 15);
+			__m256i prev2 = _mm256_alignr_epi8(v, shifted, 14);
+			__m256i prev3 = _mm256_alignr_epi8(v, shifted, 13);
+			__m256i special = _mm256_and_si256(
+				_mm256_and_si256(
+					_mm256_shuffle_epi8(
+						byte_1_high,
+						_mm256_and_si256(
+							_mm256_srli_epi16(prev1,
+									  4),
+							nibble)),
+					_mm256_shuffle_epi8(
+						byte_1_low,
+						_mm256_and_si256(prev1,
+								 nibble))),
+				_mm256_shuffle_epi8(
+					byte_2_high,
+					_mm256_and_si256(
+						_mm256_srli_epi16(v, 4),
+						nibble)));
+			__m256i must_23 = _mm256_and_si256(
+				_mm256_or_si256(_mm256_subs_epu8(prev2, third),
+						_mm256_subs_epu8(prev3,
+								 fourth)),
+				high_bit);
+
+			error = _mm256_or_si256(
+				error, _mm256_xor_si256(must_23, special));
+			prev_incomplete = _mm256_subs_epu8(v, max_incomplete);
+			ascii = 0;
+		}
+
+		if (i + 32 > size)
+			break;
+		prev = v;
+		i += 32;
+	}
+
+	if (!_mm256_testz_si256(error, error))
+		ret = MD_SIMD_TEXT_OTHER;
+	else
+		ret = (ascii ? MD_SIMD_TEXT_ASCII : MD_SIMD_TEXT_UTF8);
+
+	/* Avoid AVX-SSE transition stalls in the caller. */
+	_mm256_zeroupper();
+	return ret;
+}
+#endif
+
+#ifdef MD_SIMD_NEON
+static int md_classify_text_neon(const char *str, size_t size)
+{
+	const uint8x16_t byte_1_high = vld1q_u8(md_utf8_byte_1_high);
+	const uint8x16_t byte_1_low = vld1q_u8(md_utf8_byte_1_low);
+	const uint8x16_t byte_2_high = vld1q_u8(md_utf8_byte_2_high);
+	const uint8x16_t max_incomplete = vld1q_u8(md_utf8_max_incomplete + 16);
+	const uint8x16_t nibble = vdupq_n_u8(0x0f);
+	const uint8x16_t third = vdupq_n_u8(0xe0 - 0x80);
+	const uint8x16_t fourth = vdupq_n_u8(0xf0 - 0x80);
+	const uint8x16_t high_bit = vdupq_n_u8(0x80);
+	uint8x16_t prev = vdupq_n_u8(0);
+	uint8x16_t prev_incomplete = vdupq_n_u8(0);
+	uint8x16_t error = vdupq_n_u8(0);
+	unsigned char tail[16];
+	int ascii = 1;
+	size_t i = 0;
+
+	while (1) {
+		uint8x16_t v;
+
+		if (i + 16 <= size) {
+			v = vld1q_u8((const unsigned char *)str + i);
+		} else {
+			memset(tail, 0, sizeof(tail));
+			memcpy(tail, str + i, size - i);
+			v = vld1q_u8(tail);
+		}
+
+		if (vmaxvq_u8(v) < 0x80) {
+			error = vorrq_u8(error, prev_incomplete);
+		} else {
+			uint8x16_t prev1 = vextq_u8(prev, v, 15);
+			uint8x16_t prev2 = vextq_u8(prev, v, 14);
+			uint8x16_t prev3 = vextq_u8(prev, v, 13);
+			uint8x16_t special = vandq_u8(
+				vandq_u8(vqtbl1q_u8(byte_1_high,
+						    vshrq_n_u8(prev1, 4)),
+					 vqtbl1q_u8(byte_1_low,
+						    vandq_u8(prev1, nibble))),
+				vqtbl1q_u8(byte_2_high, vshrq_n_u8(v, 4)));
+			uint8x16_t must_23 =
+				vandq_u8(vorrq_u8(vqsubq_u8(prev2, third),
+						  vqsubq_u8(prev3, fourth)),
+					 high_bit);
+
+			error = vorrq_u8(error, veorq_u8(must_23, special));
+			prev_incomplete = vqsubq_u8(v, max_incomplete);
+			ascii = 0;
+		}
+
+		if (i + 16 > size)
+			break;
+		prev = v;
+		i += 16;
+	}
+
+	if (vmaxvq_u8(error) != 0)
+		return MD_SIMD_TEXT_OTHER;
+	return (ascii ? MD_SIMD_TEXT_ASCII : MD_SIMD_TEXT_UTF8);
+}
+#endif
+
+int md_simd_classify_text(const char *str, size_t size)
+{
+#ifdef MD_SIMD_X86
+	int features = md_cpu_features();
+
+	if (features & MD_CPU_AVX2)
+		return md_classify_text_avx2(str, size);
+	if (features & MD_CPU_SSSE3)
+		return md_classify_text_ssse3(str, size);
+#endif
+#ifdef MD_SIMD_NEON
+	return md_classify_text_neon(str, size);
+#else
+	return md_classify_text_scalar(str, size);
+#endif
+}
@@ -0,0 +1,88 @@
+/*
+ * MD4C: Markdown parser for C
+ * (http://github.com/mity/md4c)
+ *
+ * Copyright (c) 2016-2020 Martin Mitas
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+ * OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+ * IN THE SOFTWARE.
+ */
+
+#ifndef MD4C_SIMD_H
+#define MD4C_SIMD_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Vectorized search for the next byte of a set, e.g. the mark characters of
+ * md_collect_marks() or the characters the HTML renderer has to escape.
+ *
+ * The set is given as a 256-entry map, a byte is in the set if its entry has
+ * any of the bits of mask. The kernels classify ASCII bytes with two 16-entry
+ * nibble tables: bit (ch >> 4) of nibble_map[ch & 0xf] is set iff ch is in
+ * the set. Bytes >= 0x80 must be either all in the set or none of them,
+ * other sets always use the scalar loop.
+ *
+ * The kernel is selected at run time: AVX2 or SSSE3 on x86, NEON on AArch64,
+ * and a scalar loop everywhere else. Defining MD4C_NO_SIMD builds the scalar
+ * loop only.
+ */
+
+typedef struct MD_SIMD_MARKS_tag MD_SIMD_MARKS;
+struct MD_SIMD_MARKS_tag {
+	const char *map;
+	char mask;
+	/* Whether all bytes >= 0x80 are in the set. */
+	unsigned char high;
+	unsigned char nibble_map[16];
+	size_t (*find)(const MD_SIMD_MARKS *marks, const char *str,
+		       size_t size);
+};
+
+void md_simd_marks_init(MD_SIMD_MARKS *marks, const char *map, char mask);
+
+/* Returns the index of the first byte of the set in str[0 .. size), or size
+ * if there is none. */
+static inline size_t md_simd_find_mark(const MD_SIMD_MARKS *marks,
+				       const char *str, size_t size)
+{
+	return marks->find(marks, str, size);
+}
+
+/* Classes of text told apart by md_simd_classify_text(). */
+#define MD_SIMD_TEXT_OTHER 0 /* Not valid UTF-8. */
+#define MD_SIMD_TEXT_UTF8 1  /* Valid UTF-8, not only ASCII. */
+#define MD_SIMD_TEXT_ASCII 2 /* Only 7-bit ASCII. */
+
+/* Returns the class of str[0 .. size). Valid UTF-8 is as RFC 3629 defines
+ * it, i.e. without overlong forms, surrogates and codepoints above U+10FFFF,
+ * and with no sequence cut off at the end.
+ *
+ * The kernel is selected like the one of md_simd_find_mark(), it checks 16
+ * or 32 bytes at a time with the lookup tables of Keiser and Lemire
+ * ("Validating UTF-8 In Less Than One Instruction Per Byte"). */
+int md_simd_classify_text(const char *str, size_t size);
+
+#ifdef __cplusplus
+} /* extern "C" { */
+#endif
+
+#endif /* MD4C_SIMD_H */
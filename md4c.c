@@ -24,6 +24,7 @@
  */
 
 #include "md4c.h"
+#include "md4c-simd.h"
 
 #include <limits.h>
 #include <stdio.h>
@@ -66,6 +67,17 @@
 #define STRINGIZE_(x) #x
 #define STRINGIZE(x) STRINGIZE_(x)
 
+/* Memory management, can be overridden e.g. to count allocations. */
+#ifndef MD_MALLOC
+#define MD_MALLOC malloc
+#define MD_REALLOC realloc
+#define MD_FREE free
+#else
+void *MD_MALLOC(size_t size);
+void *MD_REALLOC(void *ptr, size_t size);
+void MD_FREE(void *ptr);
+#endif
+
 #ifndef TRUE
 #define TRUE 1
 #define FALSE 0
@@ -143,6 +155,8 @@ typedef struct MD_MARK_tag MD_MARK;
 typedef struct MD_BLOCK_tag MD_BLOCK;
 typedef struct MD_CONTAINER_tag MD_CONTAINER;
 typedef struct MD_REF_DEF_tag MD_REF_DEF;
+typedef struct MD_REF_DEF_SLOT_tag MD_REF_DEF_SLOT;
+typedef struct MD_PARALLEL_tag MD_PARALLEL;
 
 /* During analyzes of inline marks, we need to manage some "mark chains",
  * of (yet unresolved) openers. This structure holds start/end of the chain.
@@ -154,6 +168,23 @@ struct MD_MARKCHAIN_tag {
 	int tail; /* Index of last mark in the chain, or -1 if empty. */
 };
 
+/* Top-level block as remembered for md_reparse_in_context(). */
+typedef struct MD_TOP_BLOCK_tag MD_TOP_BLOCK;
+struct MD_TOP_BLOCK_tag {
+	OFF beg; /* Start of the run the block belongs to. */
+	unsigned flags;
+};
+
+#define MD_TOP_BLOCK_RUN_START 0x0001 /* The block starts a run at beg. */
+
+/* Place where the analysis of lines starts from scratch: At the document
+ * start, or behind a blank line when no block and no container is open. */
+typedef struct MD_FRESH_POINT_tag MD_FRESH_POINT;
+struct MD_FRESH_POINT_tag {
+	OFF off;
+	int byte_off; /* ctx->n_block_bytes there. */
+};
+
 /* Context propagated through all the parsing. */
 typedef struct MD_CTX_tag MD_CTX;
 struct MD_CTX_tag {
@@ -162,10 +193,18 @@ struct MD_CTX_tag {
 	SZ size;
 	MD_PARSER parser;
 	void *userdata;
+	const MD_ALLOCATOR *allocator;
 
 	/* When this is true, it allows some optimizations. */
 	int doc_ends_with_newline;
 
+	/* MD_SIMD_TEXT_xxx of the lines md_collect_marks() works on, valid UTF-8
+	 * is decoded without any checks. See md_text_class(). */
+	int text_class;
+#define MD_TEXT_UNCLASSIFIED (-1)
+	OFF text_class_beg;
+	OFF text_class_end;
+
 	/* Helper temporary growing buffer. */
 	CHAR *buffer;
 	unsigned alloc_buffer;
@@ -174,8 +213,12 @@ struct MD_CTX_tag {
 	MD_REF_DEF *ref_defs;
 	int n_ref_defs;
 	int alloc_ref_defs;
-	void **ref_def_hashtable;
+	MD_REF_DEF_SLOT *ref_def_hashtable;
 	int ref_def_hashtable_size;
+	int alloc_ref_def_hashtable;
+	unsigned *ref_def_folds;
+	int n_ref_def_folds;
+	int alloc_ref_def_folds;
 
 	/* Stack of inline/span markers.
      * This is only used for parsing a single block contents but by storing it
@@ -189,6 +232,7 @@ struct MD_CTX_tag {
 	char mark_char_map[128];
 #else
 	char mark_char_map[256];
+	MD_SIMD_MARKS simd_marks;
 #endif
 
 	/* For resolving of inline spans. */
@@ -206,10 +250,16 @@ struct MD_CTX_tag {
 #define TILDE_OPENERS_2 (ctx->mark_chains[10])
 #define BRACKET_OPENERS (ctx->mark_chains[11])
 #define DOLLAR_OPENERS (ctx->mark_chains[12])
-#define OPENERS_CHAIN_FIRST 1
+#define OPENERS_CHAIN_FIRST 2
 #define OPENERS_CHAIN_LAST 12
 
-	int n_table_cell_boundaries;
+	/* Cell boundaries of the table row being processed and alignments of
+	 * the table columns. Kept for the subsequent rows and tables. */
+	OFF *table_boundaries;
+	int n_table_boundaries;
+	int alloc_table_boundaries;
+	MD_ALIGN *table_align;
+	int alloc_table_align;
 
 	/* For resolving links. */
 	int unresolved_link_head;
@@ -238,6 +288,29 @@ struct MD_CTX_tag {
 	int n_containers;
 	int alloc_containers;
 
+	/* Top-level blocks and fresh points, only recorded for
+	 * md_reparse_in_context(). */
+	MD_TOP_BLOCK *top_blocks;
+	int n_top_blocks;
+	int alloc_top_blocks;
+	MD_FRESH_POINT *fresh_points;
+	int n_fresh_points;
+	int alloc_fresh_points;
+	int fresh_point_index;
+	int record_top_blocks;
+
+	/* Inlines analyzed ahead on MD_PARSER::worker_pool, if used. */
+	MD_PARALLEL *parallel;
+
+	/* Blocks are processed while the lines are analyzed, see
+	 * md_pipeline_blocks(). */
+	int pipeline;
+	int doc_entered;      /* MD_BLOCK_DOC has been entered already. */
+	int ref_defs_hashed;  /* All the definitions are in the hashtable. */
+	OFF ref_defs_end;     /* No definition ends behind this offset. */
+	OFF bracket_scan_off; /* Text of the pending blocks checked for '['. */
+	int pending_bracket;  /* There is '[' in the pending blocks. */
+
 	/* Minimal indentation to call the block "indented code block". */
 	unsigned code_indent_offset;
 
@@ -246,6 +319,7 @@ struct MD_CTX_tag {
 	int html_block_type;  /* For checking closing raw HTML condition. */
 	int last_line_has_list_loosening_effect;
 	int last_list_item_starts_with_two_blank_lines;
+	int li_block_end; /* n_block_bytes after the last MD_BLOCK_LI opener. */
 };
 
 enum MD_LINETYPE_tag {
@@ -289,6 +363,48 @@ struct MD_VERBATIMLINE_tag {
  ***  Helpers  ***
  *****************/
 
+/* Memory management, everything goes through MD_PARSER::allocator. */
+static void *md_default_alloc(size_t size, void *userdata)
+{
+	MD_UNUSED(userdata);
+	return MD_MALLOC(size);
+}
+
+static void *md_default_resize(void *ptr, size_t old_size, size_t new_size,
+			       void *userdata)
+{
+	MD_UNUSED(old_size);
+	MD_UNUSED(userdata);
+	return MD_REALLOC(ptr, new_size);
+}
+
+static void md_default_release(void *ptr, void *userdata)
+{
+	MD_UNUSED(userdata);
+	MD_FREE(ptr);
+}
+
+static const MD_ALLOCATOR md_default_allocator = {
+	md_default_alloc, md_default_resize, md_default_release, NULL};
+
+static inline void *md_alloc(MD_CTX *ctx, size_t size)
+{
+	return ctx->allocator->alloc(size, ctx->allocator->userdata);
+}
+
+static inline void *md_resize(MD_CTX *ctx, void *ptr, size_t old_size,
+			      size_t new_size)
+{
+	return ctx->allocator->resize(ptr, old_size, new_size,
+				      ctx->allocator->userdata);
+}
+
+static inline void md_release(MD_CTX *ctx, void *ptr)
+{
+	if (ptr != NULL)
+		ctx->allocator->release(ptr, ctx->allocator->userdata);
+}
+
 /* Character accessors. */
 #define CH(off) (ctx->text[(off)])
 #define STR(off) (ctx->text + (off))
@@ -402,22 +518,23 @@ static int md_text_with_null_replacement(MD_CTX *ctx, MD_TEXTTYPE type,
 			goto abort; \
 	} while (0)
 
-#define MD_TEMP_BUFFER(sz)                                            \
-	do {                                                          \
-		if (sz > ctx->alloc_buffer) {                         \
-			CHAR *new_buffer;                             \
-			SZ new_size = ((sz) + (sz) / 2 + 128) & ~127; \
-                                                                      \
-			new_buffer = realloc(ctx->buffer, new_size);  \
-			if (new_buffer == NULL) {                     \
-				MD_LOG("realloc() failed.");          \
-				ret = -1;                             \
-				goto abort;                           \
-			}                                             \
-                                                                      \
-			ctx->buffer = new_buffer;                     \
-			ctx->alloc_buffer = new_size;                 \
-		}                                                     \
+#define MD_TEMP_BUFFER(sz)                                              \
+	do {                                                            \
+		if (sz > ctx->alloc_buffer) {                           \
+			CHAR *new_buffer;                               \
+			SZ new_size = ((sz) + (sz) / 2 + 128) & ~127;   \
+                                                                        \
+			new_buffer = md_resize(ctx, ctx->buffer,        \
+					       ctx->alloc_buffer, new_size);    \
+			if (new_buffer == NULL) {                       \
+				MD_LOG("realloc() failed.");            \
+				ret = -1;                               \
+				goto abort;                             \
+			}                                               \
+                                                                        \
+			ctx->buffer = new_buffer;                       \
+			ctx->alloc_buffer = new_size;                   \
+		}                                                       \
 	} while (0)
 
 #define MD_ENTER_BLOCK(type, arg)                                            \
@@ -519,319 +636,612 @@ struct MD_UNICODE_FOLD_INFO_tag {
 };
 
 #if defined MD4C_USE_UTF16 || defined MD4C_USE_UTF8
-/* Binary search over sorted "map" of codepoints. Consecutive sequences
-     * of codepoints may be encoded in the map by just using the
-     * (MIN_CODEPOINT | 0x40000000) and (MAX_CODEPOINT | 0x80000000).
-     *
-     * Returns index of the found record in the map (in the case of ranges,
-     * the minimal value is used); or -1 on failure. */
-static int md_unicode_bsearch__(unsigned codepoint, const unsigned *map,
-				size_t map_size)
+/* Properties of a codepoint: whether it is whitespace (Unicode "Zs"
+     * category) or punctuation ("Pc", "Pd", "Pe", "Pf", "Pi", "Po", "Ps"
+     * categories), and its full case folding. One codepoint foldings are
+     * stored as the difference to add to the codepoint so that whole ranges
+     * of codepoints share the same entry. */
+#define MD_UNICODE_WHITESPACE 0x01
+#define MD_UNICODE_PUNCT 0x02
+
+typedef struct MD_UNICODE_INFO_tag MD_UNICODE_INFO;
+struct MD_UNICODE_INFO_tag {
+	unsigned char flags;
+	unsigned char n_fold_codepoints; /* 0 if the codepoint folds to itself. */
+	unsigned fold_codepoints[3];
+};
+
+/* Two-stage tables: UNICODE_PAGE_MAP[] maps the high bits of a codepoint to
+     * a page of UNICODE_PAGES[], which maps the low bits to an index into
+     * UNICODE_INFO[]. Identical pages are stored only once, so all the pages
+     * of CJK ideographs, Hangul etc. share the same one. Codepoints from
+     * MD_UNICODE_LIMIT up have no properties. */
+/* BEGIN GENERATED UNICODE TABLES (scripts/build_unicode_tables.py) */
+/* Unicode 14.0.0; 172 entries, 183 pages of 32 codepoints. */
+#define MD_UNICODE_PAGE_SHIFT 5
+#define MD_UNICODE_LIMIT 0x1e960
+
+static const MD_UNICODE_INFO UNICODE_INFO[] = {
+	{0, 0, {0x0000, 0x0000, 0x0000}}, {1, 0, {0x0000, 0x0000, 0x0000}},
+	{2, 0, {0x0000, 0x0000, 0x0000}}, {0, 1, {0x0020, 0x0000, 0x0000}},
+	{0, 1, {0x0307, 0x0000, 0x0000}}, {0, 2, {0x0073, 0x0073, 0x0000}},
+	{0, 1, {0x0001, 0x0000, 0x0000}}, {0, 2, {0x0069, 0x0307, 0x0000}},
+	{0, 2, {0x02bc, 0x006e, 0x0000}}, {0, 1, {0xffffff87, 0x0000, 0x0000}},
+	{0, 1, {0xfffffef4, 0x0000, 0x0000}}, {0, 1, {0x00d2, 0x0000, 0x0000}},
+	{0, 1, {0x00ce, 0x0000, 0x0000}}, {0, 1, {0x00cd, 0x0000, 0x0000}},
+	{0, 1, {0x004f, 0x0000, 0x0000}}, {0, 1, {0x00ca, 0x0000, 0x0000}},
+	{0, 1, {0x00cb, 0x0000, 0x0000}}, {0, 1, {0x00cf, 0x0000, 0x0000}},
+	{0, 1, {0x00d3, 0x0000, 0x0000}}, {0, 1, {0x00d1, 0x0000, 0x0000}},
+	{0, 1, {0x00d5, 0x0000, 0x0000}}, {0, 1, {0x00d6, 0x0000, 0x0000}},
+	{0, 1, {0x00da, 0x0000, 0x0000}}, {0, 1, {0x00d9, 0x0000, 0x0000}},
+	{0, 1, {0x00db, 0x0000, 0x0000}}, {0, 1, {0x0002, 0x0000, 0x0000}},
+	{0, 2, {0x006a, 0x030c, 0x0000}}, {0, 1, {0xffffff9f, 0x0000, 0x0000}},
+	{0, 1, {0xffffffc8, 0x0000, 0x0000}},
+	{0, 1, {0xffffff7e, 0x0000, 0x0000}}, {0, 1, {0x2a2b, 0x0000, 0x0000}},
+	{0, 1, {0xffffff5d, 0x0000, 0x0000}}, {0, 1, {0x2a28, 0x0000, 0x0000}},
+	{0, 1, {0xffffff3d, 0x0000, 0x0000}}, {0, 1, {0x0045, 0x0000, 0x0000}},
+	{0, 1, {0x0047, 0x0000, 0x0000}}, {0, 1, {0x0074, 0x0000, 0x0000}},
+	{0, 1, {0x0026, 0x0000, 0x0000}}, {0, 1, {0x0025, 0x0000, 0x0000}},
+	{0, 1, {0x0040, 0x0000, 0x0000}}, {0, 1, {0x003f, 0x0000, 0x0000}},
+	{0, 3, {0x03b9, 0x0308, 0x0301}}, {0, 3, {0x03c5, 0x0308, 0x0301}},
+	{0, 1, {0x0008, 0x0000, 0x0000}}, {0, 1, {0xffffffe2, 0x0000, 0x0000}},
+	{0, 1, {0xffffffe7, 0x0000, 0x0000}},
+	{0, 1, {0xfffffff1, 0x0000, 0x0000}},
+	{0, 1, {0xffffffea, 0x0000, 0x0000}},
+	{0, 1, {0xffffffca, 0x0000, 0x0000}},
+	{0, 1, {0xffffffd0, 0x0000, 0x0000}},
+	{0, 1, {0xffffffc4, 0x0000, 0x0000}},
+	{0, 1, {0xffffffc0, 0x0000, 0x0000}},
+	{0, 1, {0xfffffff9, 0x0000, 0x0000}}, {0, 1, {0x0050, 0x0000, 0x0000}},
+	{0, 1, {0x000f, 0x0000, 0x0000}}, {0, 1, {0x0030, 0x0000, 0x0000}},
+	{0, 2, {0x0565, 0x0582, 0x0000}}, {0, 1, {0x1c60, 0x0000, 0x0000}},
+	{0, 1, {0xfffffff8, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7b2, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7b3, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7bc, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7be, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7bd, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7c4, 0x0000, 0x0000}},
+	{0, 1, {0xffffe7dc, 0x0000, 0x0000}}, {0, 1, {0x89c3, 0x0000, 0x0000}},
+	{0, 1, {0xfffff440, 0x0000, 0x0000}}, {0, 2, {0x0068, 0x0331, 0x0000}},
+	{0, 2, {0x0074, 0x0308, 0x0000}}, {0, 2, {0x0077, 0x030a, 0x0000}},
+	{0, 2, {0x0079, 0x030a, 0x0000}}, {0, 2, {0x0061, 0x02be, 0x0000}},
+	{0, 1, {0xffffffc6, 0x0000, 0x0000}}, {0, 2, {0x03c5, 0x0313, 0x0000}},
+	{0, 3, {0x03c5, 0x0313, 0x0300}}, {0, 3, {0x03c5, 0x0313, 0x0301}},
+	{0, 3, {0x03c5, 0x0313, 0x0342}}, {0, 2, {0x1f00, 0x03b9, 0x0000}},
+	{0, 2, {0x1f01, 0x03b9, 0x0000}}, {0, 2, {0x1f02, 0x03b9, 0x0000}},
+	{0, 2, {0x1f03, 0x03b9, 0x0000}}, {0, 2, {0x1f04, 0x03b9, 0x0000}},
+	{0, 2, {0x1f05, 0x03b9, 0x0000}}, {0, 2, {0x1f06, 0x03b9, 0x0000}},
+	{0, 2, {0x1f07, 0x03b9, 0x0000}}, {0, 2, {0x1f20, 0x03b9, 0x0000}},
+	{0, 2, {0x1f21, 0x03b9, 0x0000}}, {0, 2, {0x1f22, 0x03b9, 0x0000}},
+	{0, 2, {0x1f23, 0x03b9, 0x0000}}, {0, 2, {0x1f24, 0x03b9, 0x0000}},
+	{0, 2, {0x1f25, 0x03b9, 0x0000}}, {0, 2, {0x1f26, 0x03b9, 0x0000}},
+	{0, 2, {0x1f27, 0x03b9, 0x0000}}, {0, 2, {0x1f60, 0x03b9, 0x0000}},
+	{0, 2, {0x1f61, 0x03b9, 0x0000}}, {0, 2, {0x1f62, 0x03b9, 0x0000}},
+	{0, 2, {0x1f63, 0x03b9, 0x0000}}, {0, 2, {0x1f64, 0x03b9, 0x0000}},
+	{0, 2, {0x1f65, 0x03b9, 0x0000}}, {0, 2, {0x1f66, 0x03b9, 0x0000}},
+	{0, 2, {0x1f67, 0x03b9, 0x0000}}, {0, 2, {0x1f70, 0x03b9, 0x0000}},
+	{0, 2, {0x03b1, 0x03b9, 0x0000}}, {0, 2, {0x03ac, 0x03b9, 0x0000}},
+	{0, 2, {0x03b1, 0x0342, 0x0000}}, {0, 3, {0x03b1, 0x0342, 0x03b9}},
+	{0, 1, {0xffffffb6, 0x0000, 0x0000}},
+	{0, 1, {0xffffe3fb, 0x0000, 0x0000}}, {0, 2, {0x1f74, 0x03b9, 0x0000}},
+	{0, 2, {0x03b7, 0x03b9, 0x0000}}, {0, 2, {0x03ae, 0x03b9, 0x0000}},
+	{0, 2, {0x03b7, 0x0342, 0x0000}}, {0, 3, {0x03b7, 0x0342, 0x03b9}},
+	{0, 1, {0xffffffaa, 0x0000, 0x0000}}, {0, 3, {0x03b9, 0x0308, 0x0300}},
+	{0, 2, {0x03b9, 0x0342, 0x0000}}, {0, 3, {0x03b9, 0x0308, 0x0342}},
+	{0, 1, {0xffffff9c, 0x0000, 0x0000}}, {0, 3, {0x03c5, 0x0308, 0x0300}},
+	{0, 2, {0x03c1, 0x0313, 0x0000}}, {0, 2, {0x03c5, 0x0342, 0x0000}},
+	{0, 3, {0x03c5, 0x0308, 0x0342}}, {0, 1, {0xffffff90, 0x0000, 0x0000}},
+	{0, 2, {0x1f7c, 0x03b9, 0x0000}}, {0, 2, {0x03c9, 0x03b9, 0x0000}},
+	{0, 2, {0x03ce, 0x03b9, 0x0000}}, {0, 2, {0x03c9, 0x0342, 0x0000}},
+	{0, 3, {0x03c9, 0x0342, 0x03b9}}, {0, 1, {0xffffff80, 0x0000, 0x0000}},
+	{0, 1, {0xffffff82, 0x0000, 0x0000}},
+	{0, 1, {0xffffe2a3, 0x0000, 0x0000}},
+	{0, 1, {0xffffdf41, 0x0000, 0x0000}},
+	{0, 1, {0xffffdfba, 0x0000, 0x0000}}, {0, 1, {0x001c, 0x0000, 0x0000}},
+	{0, 1, {0x0010, 0x0000, 0x0000}}, {0, 1, {0x001a, 0x0000, 0x0000}},
+	{0, 1, {0xffffd609, 0x0000, 0x0000}},
+	{0, 1, {0xfffff11a, 0x0000, 0x0000}},
+	{0, 1, {0xffffd619, 0x0000, 0x0000}},
+	{0, 1, {0xffffd5e4, 0x0000, 0x0000}},
+	{0, 1, {0xffffd603, 0x0000, 0x0000}},
+	{0, 1, {0xffffd5e1, 0x0000, 0x0000}},
+	{0, 1, {0xffffd5e2, 0x0000, 0x0000}},
+	{0, 1, {0xffffd5c1, 0x0000, 0x0000}},
+	{0, 1, {0xffff75fc, 0x0000, 0x0000}},
+	{0, 1, {0xffff5ad8, 0x0000, 0x0000}},
+	{0, 1, {0xffff5abc, 0x0000, 0x0000}},
+	{0, 1, {0xffff5ab1, 0x0000, 0x0000}},
+	{0, 1, {0xffff5ab5, 0x0000, 0x0000}},
+	{0, 1, {0xffff5abf, 0x0000, 0x0000}},
+	{0, 1, {0xffff5aee, 0x0000, 0x0000}},
+	{0, 1, {0xffff5ad6, 0x0000, 0x0000}},
+	{0, 1, {0xffff5aeb, 0x0000, 0x0000}}, {0, 1, {0x03a0, 0x0000, 0x0000}},
+	{0, 1, {0xffff5abd, 0x0000, 0x0000}},
+	{0, 1, {0xffff75c8, 0x0000, 0x0000}},
+	{0, 1, {0xffff6830, 0x0000, 0x0000}}, {0, 2, {0x0066, 0x0066, 0x0000}},
+	{0, 2, {0x0066, 0x0069, 0x0000}}, {0, 2, {0x0066, 0x006c, 0x0000}},
+	{0, 3, {0x0066, 0x0066, 0x0069}}, {0, 3, {0x0066, 0x0066, 0x006c}},
+	{0, 2, {0x0073, 0x0074, 0x0000}}, {0, 2, {0x0574, 0x0576, 0x0000}},
+	{0, 2, {0x0574, 0x0565, 0x0000}}, {0, 2, {0x0574, 0x056b, 0x0000}},
+	{0, 2, {0x057e, 0x0576, 0x0000}}, {0, 2, {0x0574, 0x056d, 0x0000}},
+	{0, 1, {0x0028, 0x0000, 0x0000}}, {0, 1, {0x0027, 0x0000, 0x0000}},
+	{0, 1, {0x0022, 0x0000, 0x0000}}
+};
+
+static const unsigned char
+	UNICODE_PAGE_MAP[MD_UNICODE_LIMIT >> MD_UNICODE_PAGE_SHIFT] = {
+	0, 1, 2, 3, 4, 5, 6, 4, 7, 8, 9, 10, 11, 12, 13, 14, 7, 15, 16, 4, 4, 4,
+	4, 4, 4, 4, 17, 18, 19, 20, 21, 22, 23, 24, 4, 7, 25, 7, 26, 7, 7, 27,
+	28, 4, 29, 30, 31, 32, 33, 4, 4, 34, 4, 4, 35, 4, 36, 4, 4, 4, 4, 4, 4,
+	37, 4, 38, 30, 4, 4, 4, 4, 4, 4, 4, 4, 39, 4, 4, 4, 40, 4, 4, 4, 41, 4,
+	4, 4, 42, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 43, 44, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 35, 4, 4, 45, 4, 4, 4, 4, 4, 46, 47, 4, 4, 48, 4, 49, 4, 4, 4,
+	50, 4, 4, 51, 52, 53, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 54, 4, 4, 4, 55, 56, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 57, 58, 4, 4, 59, 4, 60, 4, 4, 4, 4, 61, 4, 62, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 63, 4, 4, 4, 4, 4, 64, 4, 4, 4, 4, 65, 4, 4, 4, 4, 66, 67,
+	4, 4, 4, 68, 4, 69, 4, 64, 70, 71, 72, 4, 4, 4, 4, 4, 4, 4, 4, 4, 7, 7,
+	7, 7, 73, 7, 7, 7, 74, 75, 76, 77, 78, 79, 80, 81, 82, 83, 84, 85, 86,
+	4, 4, 4, 4, 87, 4, 88, 89, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 90, 91, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 92, 93, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 94, 4, 4, 95, 96, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 97, 4, 98, 99, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	100, 101, 4, 102, 7, 7, 7, 103, 4, 4, 4, 42, 4, 4, 4, 4, 104, 105, 106,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 107, 108, 4, 4, 4, 56, 4, 53, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 64, 4, 4, 4, 4, 4, 4, 4, 4,
+	109, 4, 7, 110, 111, 4, 4, 112, 4, 113, 7, 114, 115, 116, 117, 118, 4,
+	4, 4, 119, 4, 4, 120, 121, 4, 120, 122, 4, 4, 4, 123, 4, 4, 4, 68, 4, 4,
+	4, 64, 124, 4, 4, 4, 125, 126, 126, 4, 127, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	128, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 64, 4, 4, 4, 4, 4,
+	4, 129, 130, 131, 132, 4, 4, 4, 4, 133, 134, 135, 136, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 137, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 122, 4, 42, 4, 138, 139, 4, 4, 4, 140, 141, 4, 4, 4, 4, 142,
+	143, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 43,
+	4, 4, 4, 4, 4, 122, 122, 4, 4, 4, 4, 4, 4, 4, 4, 144, 122, 4, 4, 4, 145,
+	4, 146, 4, 4, 147, 4, 4, 4, 4, 4, 4, 4, 148, 149, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 150, 4, 4, 4, 4, 151, 4, 152, 4, 4, 4, 4, 4,
+	153, 4, 4, 154, 155, 4, 4, 4, 156, 157, 4, 4, 158, 4, 4, 159, 4, 4, 4,
+	160, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 161, 4, 4, 4, 162, 4, 4, 4, 4,
+	4, 4, 4, 163, 4, 4, 4, 164, 165, 4, 166, 4, 4, 4, 167, 4, 4, 4, 4, 4, 4,
+	4, 53, 4, 4, 4, 168, 4, 4, 4, 4, 169, 4, 4, 4, 4, 170, 4, 122, 171, 4,
+	172, 137, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 173, 124, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 174, 4, 4, 4, 4, 4, 4, 4, 122,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 175, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 176, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 120, 4,
+	4, 4, 177, 4, 178, 44, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 168, 4, 179, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 170, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 122, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 180, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4, 4,
+	4, 4, 4, 4, 4, 4, 4, 4, 4, 181, 182, 64
+};
+
+static const unsigned char UNICODE_PAGES[] = {
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 1, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2, 2, 2, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 0, 0, 0, 0, 0, 2,
+	0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 4, 2, 2, 0, 0, 0, 2, 0, 0, 0, 2,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0,
+	3, 3, 3, 3, 3, 3, 3, 5, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 7, 0, 6, 0, 6, 0, 6, 0, 0, 6, 0, 6, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 8, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 9, 6, 0, 6, 0, 6, 0, 10, 0, 11, 6, 0, 6, 0, 12,
+	6, 0, 13, 13, 6, 0, 0, 14, 15, 16, 6, 0, 13, 17, 0, 18, 19, 6, 0, 0, 0,
+	18, 20, 0, 21, 6, 0, 6, 0, 6, 0, 22, 6, 0, 22, 0, 0, 6, 0, 22, 6, 0, 23,
+	23, 6, 0, 6, 0, 24, 6, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 25, 6, 0, 25, 6,
+	0, 25, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 26, 25, 6, 0, 6, 0, 27, 28,
+	6, 0, 6, 0, 6, 0, 6, 0, 29, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 30, 6, 0, 31, 32, 0, 0, 6, 0, 33, 34, 35,
+	6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 36, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 6, 0, 6, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 2, 36, 0, 0, 0, 0, 0, 0,
+	37, 2, 38, 38, 38, 0, 39, 0, 40, 40, 41, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 42, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 43, 44, 45, 0, 0, 0, 46, 47, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 48, 49, 0, 0, 50, 51, 0, 6,
+	0, 52, 6, 0, 0, 29, 29, 29, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53, 53,
+	53, 53, 53, 53, 53, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 6, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 54, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 0, 55, 55, 55, 55, 55, 55,
+	55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+	55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 0, 0, 0, 2, 2,
+	2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 56, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 0, 2,
+	0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0,
+	2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 2, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 2, 2, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 57, 57, 57, 57, 57, 57, 57, 57, 57,
+	57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57,
+	57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 57, 0, 57, 0, 0, 0, 0, 0, 57, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 58, 58, 58, 58, 58, 58, 0, 0, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 2, 2, 2, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 0, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 59, 60, 61, 62, 62, 63, 64, 65, 66, 0,
+	0, 0, 0, 0, 0, 0, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67,
+	67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67,
+	67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 67, 0, 0, 67, 67, 67, 2, 2,
+	2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 68, 69, 70, 71, 72, 73, 0, 0, 5, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	58, 58, 58, 58, 58, 58, 58, 58, 0, 0, 0, 0, 0, 0, 0, 0, 58, 58, 58, 58,
+	58, 58, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 58, 58, 58, 58, 58, 58, 58, 58, 0,
+	0, 0, 0, 0, 0, 0, 0, 58, 58, 58, 58, 58, 58, 58, 58, 0, 0, 0, 0, 0, 0,
+	0, 0, 58, 58, 58, 58, 58, 58, 0, 0, 74, 0, 75, 0, 76, 0, 77, 0, 0, 58,
+	0, 58, 0, 58, 0, 58, 0, 0, 0, 0, 0, 0, 0, 0, 58, 58, 58, 58, 58, 58, 58,
+	58, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 78, 79, 80, 81, 82,
+	83, 84, 85, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 88, 89, 90, 91, 92,
+	93, 86, 87, 88, 89, 90, 91, 92, 93, 94, 95, 96, 97, 98, 99, 100, 101,
+	94, 95, 96, 97, 98, 99, 100, 101, 0, 0, 102, 103, 104, 0, 105, 106, 58,
+	58, 107, 107, 103, 0, 108, 0, 0, 0, 109, 110, 111, 0, 112, 113, 114,
+	114, 114, 114, 110, 0, 0, 0, 0, 0, 115, 41, 0, 0, 116, 117, 58, 58, 118,
+	118, 0, 0, 0, 0, 0, 0, 119, 42, 120, 0, 121, 122, 58, 58, 123, 123, 52,
+	0, 0, 0, 0, 0, 124, 125, 126, 0, 127, 128, 129, 129, 130, 130, 125, 0,
+	0, 0, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+	0, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 1, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	131, 0, 0, 0, 132, 133, 0, 0, 0, 0, 0, 0, 134, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135, 135,
+	135, 135, 135, 135, 135, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 136,
+	136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136,
+	136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 136, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+	55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+	55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55, 55,
+	55, 55, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 137, 138,
+	139, 0, 0, 6, 0, 6, 0, 6, 0, 140, 141, 142, 143, 0, 6, 0, 0, 6, 0, 0, 0,
+	0, 0, 0, 0, 0, 144, 144, 6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 6, 0, 0,
+	0, 0, 6, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 1, 2, 2, 2, 0, 0, 0, 0,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 0, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0,
+	6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 6, 0, 6, 0, 145, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 0, 0, 0, 6, 0, 146, 0,
+	0, 6, 0, 6, 0, 0, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 6,
+	0, 6, 0, 147, 148, 149, 150, 147, 0, 151, 152, 153, 154, 6, 0, 6, 0, 6,
+	0, 6, 0, 6, 0, 6, 0, 6, 0, 6, 0, 49, 155, 156, 6, 0, 6, 0, 0, 0, 0, 0,
+	0, 6, 0, 0, 0, 0, 0, 6, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 2, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 157, 157, 157, 157,
+	157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157,
+	157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157,
+	157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157, 157,
+	157, 157, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 158, 159, 160, 161, 162, 163, 163, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 164, 165, 166, 167, 168, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 0, 2, 0, 0, 0, 0, 2, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 2, 2, 2, 2, 2, 2, 0, 2,
+	2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 2, 2, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 2, 2,
+	2, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 0, 2, 0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+	169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+	169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 169, 169, 169, 169, 169,
+	169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+	169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169, 169,
+	169, 169, 169, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 170, 170, 170, 170, 170, 170, 170, 170, 170,
+	170, 170, 0, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170, 170,
+	170, 170, 170, 0, 170, 170, 170, 170, 170, 170, 170, 0, 170, 170, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 39, 39, 39, 39, 39, 39,
+	39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+	39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39, 39,
+	39, 39, 39, 39, 39, 39, 39, 39, 39, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2,
+	2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 2, 2, 2, 2, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2,
+	2, 2, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 2, 2,
+	2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 2, 0,
+	0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2,
+	2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2,
+	0, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3, 3,
+	3, 3, 3, 3, 3, 3, 3, 3, 3, 0, 0, 0, 0, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 0, 2, 2, 0, 2, 2, 2, 2, 2, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 2, 2, 2, 2, 2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 171, 171, 171, 171, 171, 171, 171, 171, 171,
+	171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171,
+	171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 171, 0, 0, 0, 0, 0, 0,
+	0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0
+};
+/* END GENERATED UNICODE TABLES */
+
+static inline const MD_UNICODE_INFO *md_unicode_info__(unsigned codepoint)
 {
-	int beg, end;
-	int pivot_beg, pivot_end;
+	unsigned page;
 
-	beg = 0;
-	end = (int)map_size - 1;
-	while (beg <= end) {
-		/* Pivot may be a range, not just a single value. */
-		pivot_beg = pivot_end = (beg + end) / 2;
-		if (map[pivot_end] & 0x40000000)
-			pivot_end++;
-		if (map[pivot_beg] & 0x80000000)
-			pivot_beg--;
-
-		if (codepoint < (map[pivot_beg] & 0x00ffffff))
-			end = pivot_beg - 1;
-		else if (codepoint > (map[pivot_end] & 0x00ffffff))
-			beg = pivot_end + 1;
-		else
-			return pivot_beg;
-	}
+	if (codepoint >= MD_UNICODE_LIMIT)
+		return &UNICODE_INFO[0];
 
-	return -1;
+	page = UNICODE_PAGE_MAP[codepoint >> MD_UNICODE_PAGE_SHIFT];
+	return &UNICODE_INFO[UNICODE_PAGES
+				     [(page << MD_UNICODE_PAGE_SHIFT) |
+				      (codepoint &
+				       ((1 << MD_UNICODE_PAGE_SHIFT) - 1))]];
 }
 
 static int md_is_unicode_whitespace__(unsigned codepoint)
 {
-#define R(cp_min, cp_max) ((cp_min) | 0x40000000), ((cp_max) | 0x80000000)
-#define S(cp) (cp)
-	/* Unicode "Zs" category.
-         * (generated by scripts/build_whitespace_map.py) */
-	static const unsigned WHITESPACE_MAP[] = {S(0x0020), S(0x00a0),
-						  S(0x1680), R(0x2000, 0x200a),
-						  S(0x202f), S(0x205f),
-						  S(0x3000)};
-#undef R
-#undef S
-
-	/* The ASCII ones are the most frequently used ones, also CommonMark
-         * specification requests few more in this range. */
+	/* ASCII has its own ideas about whitespace. */
 	if (codepoint <= 0x7f)
 		return ISWHITESPACE_(codepoint);
 
-	return (md_unicode_bsearch__(codepoint, WHITESPACE_MAP,
-				     SIZEOF_ARRAY(WHITESPACE_MAP)) >= 0);
+	return ((md_unicode_info__(codepoint)->flags & MD_UNICODE_WHITESPACE) !=
+		0);
 }
 
 static int md_is_unicode_punct__(unsigned codepoint)
 {
-#define R(cp_min, cp_max) ((cp_min) | 0x40000000), ((cp_max) | 0x80000000)
-#define S(cp) (cp)
-	/* Unicode "Pc", "Pd", "Pe", "Pf", "Pi", "Po", "Ps" categories.
-         * (generated by scripts/build_punct_map.py) */
-	static const unsigned PUNCT_MAP[] = {
-		R(0x0021, 0x0023),   R(0x0025, 0x002a),   R(0x002c, 0x002f),
-		R(0x003a, 0x003b),   R(0x003f, 0x0040),   R(0x005b, 0x005d),
-		S(0x005f),           S(0x007b),           S(0x007d),
-		S(0x00a1),           S(0x00a7),           S(0x00ab),
-		R(0x00b6, 0x00b7),   S(0x00bb),           S(0x00bf),
-		S(0x037e),           S(0x0387),           R(0x055a, 0x055f),
-		R(0x0589, 0x058a),   S(0x05be),           S(0x05c0),
-		S(0x05c3),           S(0x05c6),           R(0x05f3, 0x05f4),
-		R(0x0609, 0x060a),   R(0x060c, 0x060d),   S(0x061b),
-		R(0x061e, 0x061f),   R(0x066a, 0x066d),   S(0x06d4),
-		R(0x0700, 0x070d),   R(0x07f7, 0x07f9),   R(0x0830, 0x083e),
-		S(0x085e),           R(0x0964, 0x0965),   S(0x0970),
-		S(0x09fd),           S(0x0a76),           S(0x0af0),
-		S(0x0c77),           S(0x0c84),           S(0x0df4),
-		S(0x0e4f),           R(0x0e5a, 0x0e5b),   R(0x0f04, 0x0f12),
-		S(0x0f14),           R(0x0f3a, 0x0f3d),   S(0x0f85),
-		R(0x0fd0, 0x0fd4),   R(0x0fd9, 0x0fda),   R(0x104a, 0x104f),
-		S(0x10fb),           R(0x1360, 0x1368),   S(0x1400),
-		S(0x166e),           R(0x169b, 0x169c),   R(0x16eb, 0x16ed),
-		R(0x1735, 0x1736),   R(0x17d4, 0x17d6),   R(0x17d8, 0x17da),
-		R(0x1800, 0x180a),   R(0x1944, 0x1945),   R(0x1a1e, 0x1a1f),
-		R(0x1aa0, 0x1aa6),   R(0x1aa8, 0x1aad),   R(0x1b5a, 0x1b60),
-		R(0x1bfc, 0x1bff),   R(0x1c3b, 0x1c3f),   R(0x1c7e, 0x1c7f),
-		R(0x1cc0, 0x1cc7),   S(0x1cd3),           R(0x2010, 0x2027),
-		R(0x2030, 0x2043),   R(0x2045, 0x2051),   R(0x2053, 0x205e),
-		R(0x207d, 0x207e),   R(0x208d, 0x208e),   R(0x2308, 0x230b),
-		R(0x2329, 0x232a),   R(0x2768, 0x2775),   R(0x27c5, 0x27c6),
-		R(0x27e6, 0x27ef),   R(0x2983, 0x2998),   R(0x29d8, 0x29db),
-		R(0x29fc, 0x29fd),   R(0x2cf9, 0x2cfc),   R(0x2cfe, 0x2cff),
-		S(0x2d70),           R(0x2e00, 0x2e2e),   R(0x2e30, 0x2e4f),
-		S(0x2e52),           R(0x3001, 0x3003),   R(0x3008, 0x3011),
-		R(0x3014, 0x301f),   S(0x3030),           S(0x303d),
-		S(0x30a0),           S(0x30fb),           R(0xa4fe, 0xa4ff),
-		R(0xa60d, 0xa60f),   S(0xa673),           S(0xa67e),
-		R(0xa6f2, 0xa6f7),   R(0xa874, 0xa877),   R(0xa8ce, 0xa8cf),
-		R(0xa8f8, 0xa8fa),   S(0xa8fc),           R(0xa92e, 0xa92f),
-		S(0xa95f),           R(0xa9c1, 0xa9cd),   R(0xa9de, 0xa9df),
-		R(0xaa5c, 0xaa5f),   R(0xaade, 0xaadf),   R(0xaaf0, 0xaaf1),
-		S(0xabeb),           R(0xfd3e, 0xfd3f),   R(0xfe10, 0xfe19),
-		R(0xfe30, 0xfe52),   R(0xfe54, 0xfe61),   S(0xfe63),
-		S(0xfe68),           R(0xfe6a, 0xfe6b),   R(0xff01, 0xff03),
-		R(0xff05, 0xff0a),   R(0xff0c, 0xff0f),   R(0xff1a, 0xff1b),
-		R(0xff1f, 0xff20),   R(0xff3b, 0xff3d),   S(0xff3f),
-		S(0xff5b),           S(0xff5d),           R(0xff5f, 0xff65),
-		R(0x10100, 0x10102), S(0x1039f),          S(0x103d0),
-		S(0x1056f),          S(0x10857),          S(0x1091f),
-		S(0x1093f),          R(0x10a50, 0x10a58), S(0x10a7f),
-		R(0x10af0, 0x10af6), R(0x10b39, 0x10b3f), R(0x10b99, 0x10b9c),
-		S(0x10ead),          R(0x10f55, 0x10f59), R(0x11047, 0x1104d),
-		R(0x110bb, 0x110bc), R(0x110be, 0x110c1), R(0x11140, 0x11143),
-		R(0x11174, 0x11175), R(0x111c5, 0x111c8), S(0x111cd),
-		S(0x111db),          R(0x111dd, 0x111df), R(0x11238, 0x1123d),
-		S(0x112a9),          R(0x1144b, 0x1144f), R(0x1145a, 0x1145b),
-		S(0x1145d),          S(0x114c6),          R(0x115c1, 0x115d7),
-		R(0x11641, 0x11643), R(0x11660, 0x1166c), R(0x1173c, 0x1173e),
-		S(0x1183b),          R(0x11944, 0x11946), S(0x119e2),
-		R(0x11a3f, 0x11a46), R(0x11a9a, 0x11a9c), R(0x11a9e, 0x11aa2),
-		R(0x11c41, 0x11c45), R(0x11c70, 0x11c71), R(0x11ef7, 0x11ef8),
-		S(0x11fff),          R(0x12470, 0x12474), R(0x16a6e, 0x16a6f),
-		S(0x16af5),          R(0x16b37, 0x16b3b), S(0x16b44),
-		R(0x16e97, 0x16e9a), S(0x16fe2),          S(0x1bc9f),
-		R(0x1da87, 0x1da8b), R(0x1e95e, 0x1e95f)};
-#undef R
-#undef S
-
 	/* The ASCII ones are the most frequently used ones, also CommonMark
          * specification requests few more in this range. */
 	if (codepoint <= 0x7f)
 		return ISPUNCT_(codepoint);
 
-	return (md_unicode_bsearch__(codepoint, PUNCT_MAP,
-				     SIZEOF_ARRAY(PUNCT_MAP)) >= 0);
+	return ((md_unicode_info__(codepoint)->flags & MD_UNICODE_PUNCT) != 0);
 }
 
 static void md_get_unicode_fold_info(unsigned codepoint,
 				     MD_UNICODE_FOLD_INFO *info)
 {
-#define R(cp_min, cp_max) ((cp_min) | 0x40000000), ((cp_max) | 0x80000000)
-#define S(cp) (cp)
-	/* Unicode "Pc", "Pd", "Pe", "Pf", "Pi", "Po", "Ps" categories.
-         * (generated by scripts/build_folding_map.py) */
-	static const unsigned FOLD_MAP_1[] = {
-		R(0x0041, 0x005a),   S(0x00b5),           R(0x00c0, 0x00d6),
-		R(0x00d8, 0x00de),   R(0x0100, 0x012e),   R(0x0132, 0x0136),
-		R(0x0139, 0x0147),   R(0x014a, 0x0176),   S(0x0178),
-		R(0x0179, 0x017d),   S(0x017f),           S(0x0181),
-		S(0x0182),           S(0x0184),           S(0x0186),
-		S(0x0187),           S(0x0189),           S(0x018a),
-		S(0x018b),           S(0x018e),           S(0x018f),
-		S(0x0190),           S(0x0191),           S(0x0193),
-		S(0x0194),           S(0x0196),           S(0x0197),
-		S(0x0198),           S(0x019c),           S(0x019d),
-		S(0x019f),           R(0x01a0, 0x01a4),   S(0x01a6),
-		S(0x01a7),           S(0x01a9),           S(0x01ac),
-		S(0x01ae),           S(0x01af),           S(0x01b1),
-		S(0x01b2),           S(0x01b3),           S(0x01b5),
-		S(0x01b7),           S(0x01b8),           S(0x01bc),
-		S(0x01c4),           S(0x01c5),           S(0x01c7),
-		S(0x01c8),           S(0x01ca),           R(0x01cb, 0x01db),
-		R(0x01de, 0x01ee),   S(0x01f1),           S(0x01f2),
-		S(0x01f4),           S(0x01f6),           S(0x01f7),
-		R(0x01f8, 0x021e),   S(0x0220),           R(0x0222, 0x0232),
-		S(0x023a),           S(0x023b),           S(0x023d),
-		S(0x023e),           S(0x0241),           S(0x0243),
-		S(0x0244),           S(0x0245),           R(0x0246, 0x024e),
-		S(0x0345),           S(0x0370),           S(0x0372),
-		S(0x0376),           S(0x037f),           S(0x0386),
-		R(0x0388, 0x038a),   S(0x038c),           S(0x038e),
-		S(0x038f),           R(0x0391, 0x03a1),   R(0x03a3, 0x03ab),
-		S(0x03c2),           S(0x03cf),           S(0x03d0),
-		S(0x03d1),           S(0x03d5),           S(0x03d6),
-		R(0x03d8, 0x03ee),   S(0x03f0),           S(0x03f1),
-		S(0x03f4),           S(0x03f5),           S(0x03f7),
-		S(0x03f9),           S(0x03fa),           R(0x03fd, 0x03ff),
-		R(0x0400, 0x040f),   R(0x0410, 0x042f),   R(0x0460, 0x0480),
-		R(0x048a, 0x04be),   S(0x04c0),           R(0x04c1, 0x04cd),
-		R(0x04d0, 0x052e),   R(0x0531, 0x0556),   R(0x10a0, 0x10c5),
-		S(0x10c7),           S(0x10cd),           R(0x13f8, 0x13fd),
-		S(0x1c80),           S(0x1c81),           S(0x1c82),
-		S(0x1c83),           S(0x1c84),           S(0x1c85),
-		S(0x1c86),           S(0x1c87),           S(0x1c88),
-		R(0x1c90, 0x1cba),   R(0x1cbd, 0x1cbf),   R(0x1e00, 0x1e94),
-		S(0x1e9b),           R(0x1ea0, 0x1efe),   R(0x1f08, 0x1f0f),
-		R(0x1f18, 0x1f1d),   R(0x1f28, 0x1f2f),   R(0x1f38, 0x1f3f),
-		R(0x1f48, 0x1f4d),   S(0x1f59),           S(0x1f5b),
-		S(0x1f5d),           S(0x1f5f),           R(0x1f68, 0x1f6f),
-		S(0x1fb8),           S(0x1fb9),           S(0x1fba),
-		S(0x1fbb),           S(0x1fbe),           R(0x1fc8, 0x1fcb),
-		S(0x1fd8),           S(0x1fd9),           S(0x1fda),
-		S(0x1fdb),           S(0x1fe8),           S(0x1fe9),
-		S(0x1fea),           S(0x1feb),           S(0x1fec),
-		S(0x1ff8),           S(0x1ff9),           S(0x1ffa),
-		S(0x1ffb),           S(0x2126),           S(0x212a),
-		S(0x212b),           S(0x2132),           R(0x2160, 0x216f),
-		S(0x2183),           R(0x24b6, 0x24cf),   R(0x2c00, 0x2c2e),
-		S(0x2c60),           S(0x2c62),           S(0x2c63),
-		S(0x2c64),           R(0x2c67, 0x2c6b),   S(0x2c6d),
-		S(0x2c6e),           S(0x2c6f),           S(0x2c70),
-		S(0x2c72),           S(0x2c75),           S(0x2c7e),
-		S(0x2c7f),           R(0x2c80, 0x2ce2),   S(0x2ceb),
-		S(0x2ced),           S(0x2cf2),           R(0xa640, 0xa66c),
-		R(0xa680, 0xa69a),   R(0xa722, 0xa72e),   R(0xa732, 0xa76e),
-		S(0xa779),           S(0xa77b),           S(0xa77d),
-		R(0xa77e, 0xa786),   S(0xa78b),           S(0xa78d),
-		S(0xa790),           S(0xa792),           R(0xa796, 0xa7a8),
-		S(0xa7aa),           S(0xa7ab),           S(0xa7ac),
-		S(0xa7ad),           S(0xa7ae),           S(0xa7b0),
-		S(0xa7b1),           S(0xa7b2),           S(0xa7b3),
-		R(0xa7b4, 0xa7be),   S(0xa7c2),           S(0xa7c4),
-		S(0xa7c5),           S(0xa7c6),           S(0xa7c7),
-		S(0xa7c9),           S(0xa7f5),           R(0xab70, 0xabbf),
-		R(0xff21, 0xff3a),   R(0x10400, 0x10427), R(0x104b0, 0x104d3),
-		R(0x10c80, 0x10cb2), R(0x118a0, 0x118bf), R(0x16e40, 0x16e5f),
-		R(0x1e900, 0x1e921)};
-	static const unsigned FOLD_MAP_1_DATA[] = {
-		0x0061,  0x007a,  0x03bc,  0x00e0,  0x00f6,  0x00f8,  0x00fe,
-		0x0101,  0x012f,  0x0133,  0x0137,  0x013a,  0x0148,  0x014b,
-		0x0177,  0x00ff,  0x017a,  0x017e,  0x0073,  0x0253,  0x0183,
-		0x0185,  0x0254,  0x0188,  0x0256,  0x0257,  0x018c,  0x01dd,
-		0x0259,  0x025b,  0x0192,  0x0260,  0x0263,  0x0269,  0x0268,
-		0x0199,  0x026f,  0x0272,  0x0275,  0x01a1,  0x01a5,  0x0280,
-		0x01a8,  0x0283,  0x01ad,  0x0288,  0x01b0,  0x028a,  0x028b,
-		0x01b4,  0x01b6,  0x0292,  0x01b9,  0x01bd,  0x01c6,  0x01c6,
-		0x01c9,  0x01c9,  0x01cc,  0x01cc,  0x01dc,  0x01df,  0x01ef,
-		0x01f3,  0x01f3,  0x01f5,  0x0195,  0x01bf,  0x01f9,  0x021f,
-		0x019e,  0x0223,  0x0233,  0x2c65,  0x023c,  0x019a,  0x2c66,
-		0x0242,  0x0180,  0x0289,  0x028c,  0x0247,  0x024f,  0x03b9,
-		0x0371,  0x0373,  0x0377,  0x03f3,  0x03ac,  0x03ad,  0x03af,
-		0x03cc,  0x03cd,  0x03ce,  0x03b1,  0x03c1,  0x03c3,  0x03cb,
-		0x03c3,  0x03d7,  0x03b2,  0x03b8,  0x03c6,  0x03c0,  0x03d9,
-		0x03ef,  0x03ba,  0x03c1,  0x03b8,  0x03b5,  0x03f8,  0x03f2,
-		0x03fb,  0x037b,  0x037d,  0x0450,  0x045f,  0x0430,  0x044f,
-		0x0461,  0x0481,  0x048b,  0x04bf,  0x04cf,  0x04c2,  0x04ce,
-		0x04d1,  0x052f,  0x0561,  0x0586,  0x2d00,  0x2d25,  0x2d27,
-		0x2d2d,  0x13f0,  0x13f5,  0x0432,  0x0434,  0x043e,  0x0441,
-		0x0442,  0x0442,  0x044a,  0x0463,  0xa64b,  0x10d0,  0x10fa,
-		0x10fd,  0x10ff,  0x1e01,  0x1e95,  0x1e61,  0x1ea1,  0x1eff,
-		0x1f00,  0x1f07,  0x1f10,  0x1f15,  0x1f20,  0x1f27,  0x1f30,
-		0x1f37,  0x1f40,  0x1f45,  0x1f51,  0x1f53,  0x1f55,  0x1f57,
-		0x1f60,  0x1f67,  0x1fb0,  0x1fb1,  0x1f70,  0x1f71,  0x03b9,
-		0x1f72,  0x1f75,  0x1fd0,  0x1fd1,  0x1f76,  0x1f77,  0x1fe0,
-		0x1fe1,  0x1f7a,  0x1f7b,  0x1fe5,  0x1f78,  0x1f79,  0x1f7c,
-		0x1f7d,  0x03c9,  0x006b,  0x00e5,  0x214e,  0x2170,  0x217f,
-		0x2184,  0x24d0,  0x24e9,  0x2c30,  0x2c5e,  0x2c61,  0x026b,
-		0x1d7d,  0x027d,  0x2c68,  0x2c6c,  0x0251,  0x0271,  0x0250,
-		0x0252,  0x2c73,  0x2c76,  0x023f,  0x0240,  0x2c81,  0x2ce3,
-		0x2cec,  0x2cee,  0x2cf3,  0xa641,  0xa66d,  0xa681,  0xa69b,
-		0xa723,  0xa72f,  0xa733,  0xa76f,  0xa77a,  0xa77c,  0x1d79,
-		0xa77f,  0xa787,  0xa78c,  0x0265,  0xa791,  0xa793,  0xa797,
-		0xa7a9,  0x0266,  0x025c,  0x0261,  0x026c,  0x026a,  0x029e,
-		0x0287,  0x029d,  0xab53,  0xa7b5,  0xa7bf,  0xa7c3,  0xa794,
-		0x0282,  0x1d8e,  0xa7c8,  0xa7ca,  0xa7f6,  0x13a0,  0x13ef,
-		0xff41,  0xff5a,  0x10428, 0x1044f, 0x104d8, 0x104fb, 0x10cc0,
-		0x10cf2, 0x118c0, 0x118df, 0x16e60, 0x16e7f, 0x1e922, 0x1e943};
-	static const unsigned FOLD_MAP_2[] = {
-		S(0x00df),         S(0x0130),         S(0x0149),
-		S(0x01f0),         S(0x0587),         S(0x1e96),
-		S(0x1e97),         S(0x1e98),         S(0x1e99),
-		S(0x1e9a),         S(0x1e9e),         S(0x1f50),
-		R(0x1f80, 0x1f87), R(0x1f88, 0x1f8f), R(0x1f90, 0x1f97),
-		R(0x1f98, 0x1f9f), R(0x1fa0, 0x1fa7), R(0x1fa8, 0x1faf),
-		S(0x1fb2),         S(0x1fb3),         S(0x1fb4),
-		S(0x1fb6),         S(0x1fbc),         S(0x1fc2),
-		S(0x1fc3),         S(0x1fc4),         S(0x1fc6),
-		S(0x1fcc),         S(0x1fd6),         S(0x1fe4),
-		S(0x1fe6),         S(0x1ff2),         S(0x1ff3),
-		S(0x1ff4),         S(0x1ff6),         S(0x1ffc),
-		S(0xfb00),         S(0xfb01),         S(0xfb02),
-		S(0xfb05),         S(0xfb06),         S(0xfb13),
-		S(0xfb14),         S(0xfb15),         S(0xfb16),
-		S(0xfb17)};
-	static const unsigned FOLD_MAP_2_DATA[] = {
-		0x0073, 0x0073, 0x0069, 0x0307, 0x02bc, 0x006e, 0x006a, 0x030c,
-		0x0565, 0x0582, 0x0068, 0x0331, 0x0074, 0x0308, 0x0077, 0x030a,
-		0x0079, 0x030a, 0x0061, 0x02be, 0x0073, 0x0073, 0x03c5, 0x0313,
-		0x1f00, 0x03b9, 0x1f07, 0x03b9, 0x1f00, 0x03b9, 0x1f07, 0x03b9,
-		0x1f20, 0x03b9, 0x1f27, 0x03b9, 0x1f20, 0x03b9, 0x1f27, 0x03b9,
-		0x1f60, 0x03b9, 0x1f67, 0x03b9, 0x1f60, 0x03b9, 0x1f67, 0x03b9,
-		0x1f70, 0x03b9, 0x03b1, 0x03b9, 0x03ac, 0x03b9, 0x03b1, 0x0342,
-		0x03b1, 0x03b9, 0x1f74, 0x03b9, 0x03b7, 0x03b9, 0x03ae, 0x03b9,
-		0x03b7, 0x0342, 0x03b7, 0x03b9, 0x03b9, 0x0342, 0x03c1, 0x0313,
-		0x03c5, 0x0342, 0x1f7c, 0x03b9, 0x03c9, 0x03b9, 0x03ce, 0x03b9,
-		0x03c9, 0x0342, 0x03c9, 0x03b9, 0x0066, 0x0066, 0x0066, 0x0069,
-		0x0066, 0x006c, 0x0073, 0x0074, 0x0073, 0x0074, 0x0574, 0x0576,
-		0x0574, 0x0565, 0x0574, 0x056b, 0x057e, 0x0576, 0x0574, 0x056d};
-	static const unsigned FOLD_MAP_3[] = {S(0x0390), S(0x03b0), S(0x1f52),
-					      S(0x1f54), S(0x1f56), S(0x1fb7),
-					      S(0x1fc7), S(0x1fd2), S(0x1fd3),
-					      S(0x1fd7), S(0x1fe2), S(0x1fe3),
-					      S(0x1fe7), S(0x1ff7), S(0xfb03),
-					      S(0xfb04)};
-	static const unsigned FOLD_MAP_3_DATA[] = {
-		0x03b9, 0x0308, 0x0301, 0x03c5, 0x0308, 0x0301, 0x03c5, 0x0313,
-		0x0300, 0x03c5, 0x0313, 0x0301, 0x03c5, 0x0313, 0x0342, 0x03b1,
-		0x0342, 0x03b9, 0x03b7, 0x0342, 0x03b9, 0x03b9, 0x0308, 0x0300,
-		0x03b9, 0x0308, 0x0301, 0x03b9, 0x0308, 0x0342, 0x03c5, 0x0308,
-		0x0300, 0x03c5, 0x0308, 0x0301, 0x03c5, 0x0308, 0x0342, 0x03c9,
-		0x0342, 0x03b9, 0x0066, 0x0066, 0x0069, 0x0066, 0x0066, 0x006c};
-#undef R
-#undef S
-	static const struct {
-		const unsigned *map;
-		const unsigned *data;
-		size_t map_size;
-		unsigned n_codepoints;
-	} FOLD_MAP_LIST[] = {
-		{FOLD_MAP_1, FOLD_MAP_1_DATA, SIZEOF_ARRAY(FOLD_MAP_1), 1},
-		{FOLD_MAP_2, FOLD_MAP_2_DATA, SIZEOF_ARRAY(FOLD_MAP_2), 2},
-		{FOLD_MAP_3, FOLD_MAP_3_DATA, SIZEOF_ARRAY(FOLD_MAP_3), 3}};
-
-	int i;
+	const MD_UNICODE_INFO *unicode_info;
 
 	/* Fast path for ASCII characters. */
 	if (codepoint <= 0x7f) {
@@ -842,50 +1252,26 @@ static void md_get_unicode_fold_info(unsigned codepoint,
 		return;
 	}
 
-	/* Try to locate the codepoint in any of the maps. */
-	for (i = 0; i < (int)SIZEOF_ARRAY(FOLD_MAP_LIST); i++) {
-		int index;
-
-		index = md_unicode_bsearch__(codepoint, FOLD_MAP_LIST[i].map,
-					     FOLD_MAP_LIST[i].map_size);
-		if (index >= 0) {
-			/* Found the mapping. */
-			unsigned n_codepoints = FOLD_MAP_LIST[i].n_codepoints;
-			const unsigned *map = FOLD_MAP_LIST[i].map;
-			const unsigned *codepoints =
-				FOLD_MAP_LIST[i].data + (index * n_codepoints);
-
-			memcpy(info->codepoints, codepoints,
-			       sizeof(unsigned) * n_codepoints);
-			info->n_codepoints = n_codepoints;
-
-			if (FOLD_MAP_LIST[i].map[index] != codepoint) {
-				/* The found mapping maps whole range of codepoints,
-                     * i.e. we have to offset info->codepoints[0] accordingly. */
-				if ((map[index] & 0x00ffffff) + 1 ==
-				    codepoints[0]) {
-					/* Alternating type of the range. */
-					info->codepoints[0] =
-						codepoint +
-						((codepoint &
-						  0x1) == (map[index] & 0x1)
-							 ? 1
-							 : 0);
-				} else {
-					/* Range to range kind of mapping. */
-					info->codepoints[0] +=
-						(codepoint -
-						 (map[index] & 0x00ffffff));
-				}
-			}
+	unicode_info = md_unicode_info__(codepoint);
+	switch (unicode_info->n_fold_codepoints) {
+	case 0:
+		/* No mapping. Map the codepoint to itself. */
+		info->codepoints[0] = codepoint;
+		info->n_codepoints = 1;
+		break;
 
-			return;
-		}
-	}
+	case 1:
+		info->codepoints[0] =
+			codepoint + unicode_info->fold_codepoints[0];
+		info->n_codepoints = 1;
+		break;
 
-	/* No mapping found. Map the codepoint to itself. */
-	info->codepoints[0] = codepoint;
-	info->n_codepoints = 1;
+	default:
+		memcpy(info->codepoints, unicode_info->fold_codepoints,
+		       sizeof(unsigned) * unicode_info->n_fold_codepoints);
+		info->n_codepoints = unicode_info->n_fold_codepoints;
+		break;
+	}
 }
 #endif
 
@@ -983,9 +1369,69 @@ static unsigned md_decode_utf8__(const CHAR *str, SZ str_size, SZ *p_size)
 	return (unsigned)str[0];
 }
 
+/* md_decode_utf8__() for valid UTF-8, where every lead byte is followed by all
+     * its tail bytes. */
+static inline unsigned md_decode_valid_utf8__(const CHAR *str, SZ *p_size)
+{
+	if (IS_UTF8_LEAD1(str[0])) {
+		*p_size = 1;
+		return (unsigned)str[0];
+	} else if (IS_UTF8_LEAD2(str[0])) {
+		*p_size = 2;
+		return (((unsigned int)str[0] & 0x1f) << 6) |
+		       (((unsigned int)str[1] & 0x3f) << 0);
+	} else if (IS_UTF8_LEAD3(str[0])) {
+		*p_size = 3;
+		return (((unsigned int)str[0] & 0x0f) << 12) |
+		       (((unsigned int)str[1] & 0x3f) << 6) |
+		       (((unsigned int)str[2] & 0x3f) << 0);
+	} else {
+		*p_size = 4;
+		return (((unsigned int)str[0] & 0x07) << 18) |
+		       (((unsigned int)str[1] & 0x3f) << 12) |
+		       (((unsigned int)str[2] & 0x3f) << 6) |
+		       (((unsigned int)str[3] & 0x3f) << 0);
+	}
+}
+
+/* The text is classified only when its first non-ASCII character needs to be
+     * decoded, ASCII text never pays for that. */
+static int md_text_class(MD_CTX *ctx)
+{
+	if (ctx->text_class == MD_TEXT_UNCLASSIFIED)
+		ctx->text_class = md_simd_classify_text(
+			STR(ctx->text_class_beg),
+			ctx->text_class_end - ctx->text_class_beg);
+	return ctx->text_class;
+}
+
+static unsigned md_decode_utf8_at__(MD_CTX *ctx, OFF off)
+{
+	SZ char_size;
+
+	/* In ASCII text, this is all there is to it. */
+	if (IS_UTF8_LEAD1(CH(off)))
+		return (unsigned)CH(off);
+
+	if (md_text_class(ctx) == MD_SIMD_TEXT_UTF8)
+		return md_decode_valid_utf8__(STR(off), &char_size);
+
+	return md_decode_utf8__(STR(off), ctx->size - off, NULL);
+}
+
 static unsigned md_decode_utf8_before__(MD_CTX *ctx, OFF off)
 {
 	if (!IS_UTF8_LEAD1(CH(off - 1))) {
+		/* In valid UTF-8, the tail bytes lead back to the lead byte. */
+		if (md_text_class(ctx) == MD_SIMD_TEXT_UTF8) {
+			OFF beg = off - 1;
+			SZ char_size;
+
+			while (IS_UTF8_TAIL(CH(beg)))
+				beg--;
+			return md_decode_valid_utf8__(STR(beg), &char_size);
+		}
+
 		if (off > 1 && IS_UTF8_LEAD2(CH(off - 2)) &&
 		    IS_UTF8_TAIL(CH(off - 1)))
 			return (((unsigned int)CH(off - 2) & 0x1f) << 6) |
@@ -1010,15 +1456,12 @@ static unsigned md_decode_utf8_before__(MD_CTX *ctx, OFF off)
 }
 
 #define ISUNICODEWHITESPACE_(codepoint) md_is_unicode_whitespace__(codepoint)
-#define ISUNICODEWHITESPACE(off)    \
-	md_is_unicode_whitespace__( \
-		md_decode_utf8__(STR(off), ctx->size - (off), NULL))
+#define ISUNICODEWHITESPACE(off) \
+	md_is_unicode_whitespace__(md_decode_utf8_at__(ctx, off))
 #define ISUNICODEWHITESPACEBEFORE(off) \
 	md_is_unicode_whitespace__(md_decode_utf8_before__(ctx, off))
 
-#define ISUNICODEPUNCT(off)    \
-	md_is_unicode_punct__( \
-		md_decode_utf8__(STR(off), ctx->size - (off), NULL))
+#define ISUNICODEPUNCT(off) md_is_unicode_punct__(md_decode_utf8_at__(ctx, off))
 #define ISUNICODEPUNCTBEFORE(off) \
 	md_is_unicode_punct__(md_decode_utf8_before__(ctx, off))
 
@@ -1107,7 +1550,7 @@ static int md_merge_lines_alloc(MD_CTX *ctx, OFF beg, OFF end,
 {
 	CHAR *buffer;
 
-	buffer = (CHAR *)malloc(sizeof(CHAR) * (end - beg));
+	buffer = (CHAR *)md_alloc(ctx, sizeof(CHAR) * (end - beg));
 	if (buffer == NULL) {
 		MD_LOG("malloc() failed.");
 		return -1;
@@ -1126,6 +1569,14 @@ static OFF md_skip_unicode_whitespace(const CHAR *label, OFF off, SZ size)
 	unsigned codepoint;
 
 	while (off < size) {
+		if (ISASCII_(label[off])) {
+			if (!ISWHITESPACE_(label[off]) &&
+			    !ISNEWLINE_(label[off]))
+				break;
+			off++;
+			continue;
+		}
+
 		codepoint = md_decode_unicode(label, off, size, &char_size);
 		if (!ISUNICODEWHITESPACE_(codepoint) && !ISNEWLINE_(label[off]))
 			break;
@@ -1536,30 +1987,29 @@ static int md_build_attr_append_substr(MD_CTX *ctx, MD_ATTRIBUTE_BUILD *build,
 	if (build->substr_count >= build->substr_alloc) {
 		MD_TEXTTYPE *new_substr_types;
 		OFF *new_substr_offsets;
+		int old_alloc = build->substr_alloc;
+		int new_alloc = (old_alloc > 0 ? old_alloc + old_alloc / 2 : 8);
 
-		build->substr_alloc =
-			(build->substr_alloc > 0
-				 ? build->substr_alloc + build->substr_alloc / 2
-				 : 8);
-		new_substr_types = (MD_TEXTTYPE *)realloc(
-			build->substr_types,
-			build->substr_alloc * sizeof(MD_TEXTTYPE));
+		new_substr_types = (MD_TEXTTYPE *)md_resize(
+			ctx, build->substr_types,
+			old_alloc * sizeof(MD_TEXTTYPE),
+			new_alloc * sizeof(MD_TEXTTYPE));
 		if (new_substr_types == NULL) {
 			MD_LOG("realloc() failed.");
 			return -1;
 		}
+		build->substr_types = new_substr_types;
 		/* Note +1 to reserve space for final offset (== raw_size). */
-		new_substr_offsets =
-			(OFF *)realloc(build->substr_offsets,
-				       (build->substr_alloc + 1) * sizeof(OFF));
+		new_substr_offsets = (OFF *)md_resize(
+			ctx, build->substr_offsets,
+			(old_alloc > 0 ? old_alloc + 1 : 0) * sizeof(OFF),
+			(new_alloc + 1) * sizeof(OFF));
 		if (new_substr_offsets == NULL) {
 			MD_LOG("realloc() failed.");
-			free(new_substr_types);
 			return -1;
 		}
-
-		build->substr_types = new_substr_types;
 		build->substr_offsets = new_substr_offsets;
+		build->substr_alloc = new_alloc;
 	}
 
 	build->substr_types[build->substr_count] = type;
@@ -1572,10 +2022,10 @@ static void md_free_attribute(MD_CTX *ctx, MD_ATTRIBUTE_BUILD *build)
 {
 	MD_UNUSED(ctx);
 
-	if (build->substr_alloc > 0) {
-		free(build->text);
-		free(build->substr_types);
-		free(build->substr_offsets);
+	if (build->substr_types != build->trivial_types) {
+		md_release(ctx, build->text);
+		md_release(ctx, build->substr_types);
+		md_release(ctx, build->substr_offsets);
 	}
 }
 
@@ -1610,7 +2060,7 @@ static int md_build_attribute(MD_CTX *ctx, const CHAR *raw_text, SZ raw_size,
 		build->trivial_offsets[1] = raw_size;
 		off = raw_size;
 	} else {
-		build->text = (CHAR *)malloc(raw_size * sizeof(CHAR));
+		build->text = (CHAR *)md_alloc(ctx, raw_size * sizeof(CHAR));
 		if (build->text == NULL) {
 			MD_LOG("malloc() failed.");
 			goto abort;
@@ -1700,358 +2150,275 @@ static inline unsigned md_fnv1a(unsigned base, const void *data, size_t n)
 struct MD_REF_DEF_tag {
 	CHAR *label;
 	CHAR *title;
-	unsigned hash;
+	unsigned hash; /* Of the folded label. */
+	int fold_beg;  /* The folded label in ctx->ref_def_folds[]. */
+	SZ fold_size;
 	SZ label_size;
 	SZ title_size;
 	OFF dest_beg;
 	OFF dest_end;
+	/* Used instead of label and title (if not owned) while the definition
+	 * is kept for md_reparse_in_context() between documents. */
+	OFF label_off;
+	OFF title_off;
 	unsigned char label_needs_free : 1;
 	unsigned char title_needs_free : 1;
 };
 
 /* Label equivalence is quite complicated with regards to whitespace and case
- * folding. This complicates computing a hash of it as well as direct comparison
- * of two labels. */
+ * folding. So the labels are compared in a folded form: The case-folded
+ * codepoints, with leading and trailing whitespace dropped and any other run
+ * of whitespace turned into a single ' '. */
 
-static unsigned md_link_label_hash(const CHAR *label, SZ size)
-{
-	unsigned hash = MD_FNV1A_BASE;
+typedef struct MD_LABEL_FOLD_tag MD_LABEL_FOLD;
+struct MD_LABEL_FOLD_tag {
+	const CHAR *label;
+	SZ size;
 	OFF off;
-	unsigned codepoint;
-	int is_whitespace = FALSE;
+	MD_UNICODE_FOLD_INFO fold_info;
+	unsigned fold_off;
+};
 
-	off = md_skip_unicode_whitespace(label, 0, size);
-	while (off < size) {
+static void md_label_fold_init(MD_LABEL_FOLD *fold, const CHAR *label,
+			       SZ size)
+{
+	fold->label = label;
+	fold->size = size;
+	fold->off = md_skip_unicode_whitespace(label, 0, size);
+	fold->fold_info.n_codepoints = 0;
+	fold->fold_off = 0;
+}
+
+/* Gets the next codepoint of the folded label. Returns FALSE at its end. */
+static int md_label_fold_next(MD_LABEL_FOLD *fold, unsigned *p_codepoint)
+{
+	if (fold->fold_off >= fold->fold_info.n_codepoints) {
+		unsigned codepoint;
 		SZ char_size;
 
-		codepoint = md_decode_unicode(label, off, size, &char_size);
-		is_whitespace = ISUNICODEWHITESPACE_(codepoint) ||
-				ISNEWLINE_(label[off]);
+		if (fold->off >= fold->size)
+			return FALSE;
 
-		if (is_whitespace) {
-			codepoint = ' ';
-			hash = md_fnv1a(hash, &codepoint, sizeof(unsigned));
-			off = md_skip_unicode_whitespace(label, off, size);
-		} else {
-			MD_UNICODE_FOLD_INFO fold_info;
+		/* Most labels are ASCII, no need to decode and look that up. */
+		codepoint = (unsigned)fold->label[fold->off];
+		if (ISASCII_(codepoint) && !ISWHITESPACE_(codepoint) &&
+		    !ISNEWLINE_(codepoint)) {
+			if (ISUPPER_(codepoint))
+				codepoint += 'a' - 'A';
+			fold->off++;
+			*p_codepoint = codepoint;
+			return TRUE;
+		}
 
-			md_get_unicode_fold_info(codepoint, &fold_info);
-			hash = md_fnv1a(hash, fold_info.codepoints,
-					fold_info.n_codepoints *
-						sizeof(unsigned));
-			off += char_size;
+		codepoint = md_decode_unicode(fold->label, fold->off,
+					      fold->size, &char_size);
+		if (ISUNICODEWHITESPACE_(codepoint) ||
+		    ISNEWLINE_(fold->label[fold->off])) {
+			fold->off = md_skip_unicode_whitespace(
+				fold->label, fold->off, fold->size);
+			if (fold->off >= fold->size)
+				return FALSE;
+			fold->fold_info.codepoints[0] = ' ';
+			fold->fold_info.n_codepoints = 1;
+		} else {
+			md_get_unicode_fold_info(codepoint, &fold->fold_info);
+			fold->off += char_size;
 		}
+		fold->fold_off = 0;
 	}
 
-	return hash;
+	*p_codepoint = fold->fold_info.codepoints[fold->fold_off++];
+	return TRUE;
 }
 
-static OFF md_link_label_cmp_load_fold_info(const CHAR *label, OFF off, SZ size,
-					    MD_UNICODE_FOLD_INFO *fold_info)
+/* Stores up to max_size codepoints of the folded label into folded[]. Returns
+ * the hash of the whole folded label and its size in *p_size. */
+static unsigned md_link_label_fold(const CHAR *label, SZ size,
+				   unsigned *folded, SZ max_size, SZ *p_size)
 {
+	MD_LABEL_FOLD fold;
+	unsigned hash = MD_FNV1A_BASE;
 	unsigned codepoint;
-	SZ char_size;
-
-	if (off >= size) {
-		/* Treat end of a link label as a whitespace. */
-		goto whitespace;
-	}
+	SZ n = 0;
 
-	codepoint = md_decode_unicode(label, off, size, &char_size);
-	off += char_size;
-	if (ISUNICODEWHITESPACE_(codepoint)) {
-		/* Treat all whitespace as equivalent */
-		goto whitespace;
+	md_label_fold_init(&fold, label, size);
+	while (md_label_fold_next(&fold, &codepoint)) {
+		if (n < max_size)
+			folded[n] = codepoint;
+		n++;
+		hash = md_fnv1a(hash, &codepoint, sizeof(unsigned));
 	}
 
-	/* Get real folding info. */
-	md_get_unicode_fold_info(codepoint, fold_info);
-	return off;
-
-whitespace:
-	fold_info->codepoints[0] = _T(' ');
-	fold_info->n_codepoints = 1;
-	return md_skip_unicode_whitespace(label, off, size);
+	*p_size = n;
+	return hash;
 }
 
-static int md_link_label_cmp(const CHAR *a_label, SZ a_size,
-			     const CHAR *b_label, SZ b_size)
+/* Compares the label with an already folded one. */
+static int md_link_label_eq_fold(const CHAR *label, SZ size,
+				 const unsigned *folded, SZ folded_size)
 {
-	OFF a_off;
-	OFF b_off;
-	MD_UNICODE_FOLD_INFO a_fi = {{0}, 0};
-	MD_UNICODE_FOLD_INFO b_fi = {{0}, 0};
-	OFF a_fi_off = 0;
-	OFF b_fi_off = 0;
-	int cmp;
-
-	a_off = md_skip_unicode_whitespace(a_label, 0, a_size);
-	b_off = md_skip_unicode_whitespace(b_label, 0, b_size);
-	while (a_off < a_size || a_fi_off < a_fi.n_codepoints ||
-	       b_off < b_size || b_fi_off < b_fi.n_codepoints) {
-		/* If needed, load fold info for next char. */
-		if (a_fi_off >= a_fi.n_codepoints) {
-			a_fi_off = 0;
-			a_off = md_link_label_cmp_load_fold_info(a_label, a_off,
-								 a_size, &a_fi);
-		}
-		if (b_fi_off >= b_fi.n_codepoints) {
-			b_fi_off = 0;
-			b_off = md_link_label_cmp_load_fold_info(b_label, b_off,
-								 b_size, &b_fi);
-		}
-
-		cmp = b_fi.codepoints[b_fi_off] - a_fi.codepoints[a_fi_off];
-		if (cmp != 0)
-			return cmp;
+	MD_LABEL_FOLD fold;
+	unsigned codepoint;
+	SZ n = 0;
 
-		a_fi_off++;
-		b_fi_off++;
+	md_label_fold_init(&fold, label, size);
+	while (md_label_fold_next(&fold, &codepoint)) {
+		if (n >= folded_size || folded[n] != codepoint)
+			return FALSE;
+		n++;
 	}
 
-	return 0;
+	return (n == folded_size);
 }
 
-typedef struct MD_REF_DEF_LIST_tag MD_REF_DEF_LIST;
-struct MD_REF_DEF_LIST_tag {
-	int n_ref_defs;
-	int alloc_ref_defs;
-	MD_REF_DEF *
-		ref_defs[]; /* Valid items always  point into ctx->ref_defs[] */
+/* ctx->ref_def_hashtable[] is an open-addressing table with linear probing.
+ * Its size is a power of two, at least twice the count of the definitions,
+ * so the probe sequences stay short. */
+struct MD_REF_DEF_SLOT_tag {
+	unsigned hash;
+	int def_index; /* Index into ctx->ref_defs[], or -1 if unused. */
 };
 
-static int md_ref_def_cmp(const void *a, const void *b)
-{
-	const MD_REF_DEF *a_ref = *(const MD_REF_DEF **)a;
-	const MD_REF_DEF *b_ref = *(const MD_REF_DEF **)b;
-
-	if (a_ref->hash < b_ref->hash)
-		return -1;
-	else if (a_ref->hash > b_ref->hash)
-		return +1;
-	else
-		return md_link_label_cmp(a_ref->label, a_ref->label_size,
-					 b_ref->label, b_ref->label_size);
-}
-
-static int md_ref_def_cmp_for_sort(const void *a, const void *b)
-{
-	int cmp;
-
-	cmp = md_ref_def_cmp(a, b);
-
-	/* Ensure stability of the sorting. */
-	if (cmp == 0) {
-		const MD_REF_DEF *a_ref = *(const MD_REF_DEF **)a;
-		const MD_REF_DEF *b_ref = *(const MD_REF_DEF **)b;
-
-		if (a_ref < b_ref)
-			cmp = -1;
-		else if (a_ref > b_ref)
-			cmp = +1;
-		else
-			cmp = 0;
-	}
-
-	return cmp;
-}
-
 static int md_build_ref_def_hashtable(MD_CTX *ctx)
 {
+	int size = 16;
 	int i, j;
 
+	ctx->ref_def_hashtable_size = 0;
+	ctx->n_ref_def_folds = 0;
+
 	if (ctx->n_ref_defs == 0)
 		return 0;
 
-	ctx->ref_def_hashtable_size = (ctx->n_ref_defs * 5) / 4;
-	ctx->ref_def_hashtable =
-		malloc(ctx->ref_def_hashtable_size * sizeof(void *));
-	if (ctx->ref_def_hashtable == NULL) {
-		MD_LOG("malloc() failed.");
-		goto abort;
-	}
-	memset(ctx->ref_def_hashtable, 0,
-	       ctx->ref_def_hashtable_size * sizeof(void *));
-
-	/* Each member of ctx->ref_def_hashtable[] can be:
-     *  -- NULL,
-     *  -- pointer to the MD_REF_DEF in ctx->ref_defs[], or
-     *  -- pointer to a MD_REF_DEF_LIST, which holds multiple pointers to
-     *     such MD_REF_DEFs.
-     */
-	for (i = 0; i < ctx->n_ref_defs; i++) {
-		MD_REF_DEF *def = &ctx->ref_defs[i];
-		void *bucket;
-		MD_REF_DEF_LIST *list;
-
-		def->hash = md_link_label_hash(def->label, def->label_size);
-		bucket = ctx->ref_def_hashtable[def->hash %
-						ctx->ref_def_hashtable_size];
-
-		if (bucket == NULL) {
-			/* The bucket is empty. Make it just point to the def. */
-			ctx->ref_def_hashtable[def->hash %
-					       ctx->ref_def_hashtable_size] =
-				def;
-			continue;
-		}
-
-		if (ctx->ref_defs <= (MD_REF_DEF *)bucket &&
-		    (MD_REF_DEF *)bucket < ctx->ref_defs + ctx->n_ref_defs) {
-			/* The bucket already contains one ref. def. Lets see whether it
-             * is the same label (ref. def. duplicate) or different one
-             * (hash conflict). */
-			MD_REF_DEF *old_def = (MD_REF_DEF *)bucket;
-
-			if (md_link_label_cmp(def->label, def->label_size,
-					      old_def->label,
-					      old_def->label_size) == 0) {
-				/* Duplicate label: Ignore this ref. def. */
-				continue;
-			}
+	while (size < 2 * ctx->n_ref_defs)
+		size *= 2;
 
-			/* Make the bucket complex, i.e. able to hold more ref. defs. */
-			list = (MD_REF_DEF_LIST *)malloc(
-				sizeof(MD_REF_DEF_LIST) +
-				2 * sizeof(MD_REF_DEF *));
-			if (list == NULL) {
-				MD_LOG("malloc() failed.");
-				goto abort;
-			}
-			list->ref_defs[0] = old_def;
-			list->ref_defs[1] = def;
-			list->n_ref_defs = 2;
-			list->alloc_ref_defs = 2;
-			ctx->ref_def_hashtable[def->hash %
-					       ctx->ref_def_hashtable_size] =
-				list;
-			continue;
-		}
+	if (size > ctx->alloc_ref_def_hashtable) {
+		MD_REF_DEF_SLOT *new_hashtable;
 
-		/* Append the def to the complex bucket list.
-         *
-         * Note in this case we ignore potential duplicates to avoid expensive
-         * iterating over the complex bucket. Below, we revisit all the complex
-         * buckets and handle it more cheaply after the complex bucket contents
-         * is sorted. */
-		list = (MD_REF_DEF_LIST *)bucket;
-		if (list->n_ref_defs >= list->alloc_ref_defs) {
-			int alloc_ref_defs =
-				list->alloc_ref_defs + list->alloc_ref_defs / 2;
-			MD_REF_DEF_LIST *list_tmp = (MD_REF_DEF_LIST *)realloc(
-				list,
-				sizeof(MD_REF_DEF_LIST) +
-					alloc_ref_defs * sizeof(MD_REF_DEF *));
-			if (list_tmp == NULL) {
-				MD_LOG("realloc() failed.");
-				goto abort;
-			}
-			list = list_tmp;
-			list->alloc_ref_defs = alloc_ref_defs;
-			ctx->ref_def_hashtable[def->hash %
-					       ctx->ref_def_hashtable_size] =
-				list;
+		new_hashtable = (MD_REF_DEF_SLOT *)md_resize(
+			ctx, ctx->ref_def_hashtable,
+			ctx->alloc_ref_def_hashtable * sizeof(MD_REF_DEF_SLOT),
+			size * sizeof(MD_REF_DEF_SLOT));
+		if (new_hashtable == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
 		}
 
-		list->ref_defs[list->n_ref_defs] = def;
-		list->n_ref_defs++;
+		ctx->ref_def_hashtable = new_hashtable;
+		ctx->alloc_ref_def_hashtable = size;
 	}
 
-	/* Sort the complex buckets so we can use bsearch() with them. */
-	for (i = 0; i < ctx->ref_def_hashtable_size; i++) {
-		void *bucket = ctx->ref_def_hashtable[i];
-		MD_REF_DEF_LIST *list;
+	for (i = 0; i < size; i++)
+		ctx->ref_def_hashtable[i].def_index = -1;
 
-		if (bucket == NULL)
-			continue;
-		if (ctx->ref_defs <= (MD_REF_DEF *)bucket &&
-		    (MD_REF_DEF *)bucket < ctx->ref_defs + ctx->n_ref_defs)
-			continue;
+	for (i = 0; i < ctx->n_ref_defs; i++) {
+		MD_REF_DEF *def = &ctx->ref_defs[i];
+		/* A codepoint folds to three at most. */
+		int max_fold_size = 3 * def->label_size;
+		unsigned *def_fold;
+
+		if (ctx->n_ref_def_folds + max_fold_size >
+		    ctx->alloc_ref_def_folds) {
+			unsigned *new_folds;
+			int alloc_ref_def_folds =
+				ctx->alloc_ref_def_folds +
+				ctx->alloc_ref_def_folds / 2 + max_fold_size +
+				256;
+
+			new_folds = (unsigned *)md_resize(
+				ctx, ctx->ref_def_folds,
+				ctx->alloc_ref_def_folds * sizeof(unsigned),
+				alloc_ref_def_folds * sizeof(unsigned));
+			if (new_folds == NULL) {
+				MD_LOG("realloc() failed.");
+				return -1;
+			}
 
-		list = (MD_REF_DEF_LIST *)bucket;
-		qsort(list->ref_defs, list->n_ref_defs, sizeof(MD_REF_DEF *),
-		      md_ref_def_cmp_for_sort);
+			ctx->ref_def_folds = new_folds;
+			ctx->alloc_ref_def_folds = alloc_ref_def_folds;
+		}
 
-		/* Disable all duplicates in the complex bucket by forcing all such
-         * records to point to the 1st such ref. def. I.e. no matter which
-         * record is found during the lookup, it will always point to the right
-         * ref. def. in ctx->ref_defs[]. */
-		for (j = 1; j < list->n_ref_defs; j++) {
-			if (md_ref_def_cmp(&list->ref_defs[j - 1],
-					   &list->ref_defs[j]) == 0)
-				list->ref_defs[j] = list->ref_defs[j - 1];
+		/* Remember the folded label and its hash. */
+		def->fold_beg = ctx->n_ref_def_folds;
+		def->hash = md_link_label_fold(
+			def->label, def->label_size,
+			ctx->ref_def_folds + def->fold_beg, max_fold_size,
+			&def->fold_size);
+		ctx->n_ref_def_folds += def->fold_size;
+		def_fold = ctx->ref_def_folds + def->fold_beg;
+
+		/* Insert it unless there is an earlier definition of the same
+		 * label, which takes precedence. */
+		for (j = def->hash & (size - 1);
+		     ctx->ref_def_hashtable[j].def_index >= 0;
+		     j = (j + 1) & (size - 1)) {
+			const MD_REF_DEF *old_def =
+				&ctx->ref_defs[ctx->ref_def_hashtable[j].def_index];
+
+			if (ctx->ref_def_hashtable[j].hash == def->hash &&
+			    old_def->fold_size == def->fold_size &&
+			    memcmp(ctx->ref_def_folds + old_def->fold_beg,
+				   def_fold,
+				   def->fold_size * sizeof(unsigned)) == 0)
+				break;
+		}
+		if (ctx->ref_def_hashtable[j].def_index < 0) {
+			ctx->ref_def_hashtable[j].hash = def->hash;
+			ctx->ref_def_hashtable[j].def_index = i;
 		}
 	}
 
+	ctx->ref_def_hashtable_size = size;
 	return 0;
-
-abort:
-	return -1;
 }
 
+/* The table and the folded labels are working buffers, i.e. they are kept
+ * for the next document. */
 static void md_free_ref_def_hashtable(MD_CTX *ctx)
 {
-	if (ctx->ref_def_hashtable != NULL) {
-		int i;
-
-		for (i = 0; i < ctx->ref_def_hashtable_size; i++) {
-			void *bucket = ctx->ref_def_hashtable[i];
-			if (bucket == NULL)
-				continue;
-			if (ctx->ref_defs <= (MD_REF_DEF *)bucket &&
-			    (MD_REF_DEF *)bucket <
-				    ctx->ref_defs + ctx->n_ref_defs)
-				continue;
-			free(bucket);
-		}
-
-		free(ctx->ref_def_hashtable);
-	}
+	ctx->ref_def_hashtable_size = 0;
+	ctx->n_ref_def_folds = 0;
 }
 
+/* Labels folded to this many codepoints at most are compared with memcmp(),
+ * longer ones are folded once more. */
+#define MD_LOOKUP_FOLD_SIZE 64
+
 static const MD_REF_DEF *md_lookup_ref_def(MD_CTX *ctx, const CHAR *label,
 					   SZ label_size)
 {
+	int mask = ctx->ref_def_hashtable_size - 1;
+	unsigned folded[MD_LOOKUP_FOLD_SIZE];
+	SZ folded_size;
 	unsigned hash;
-	void *bucket;
+	int i;
 
 	if (ctx->ref_def_hashtable_size == 0)
 		return NULL;
 
-	hash = md_link_label_hash(label, label_size);
-	bucket = ctx->ref_def_hashtable[hash % ctx->ref_def_hashtable_size];
+	hash = md_link_label_fold(label, label_size, folded,
+				  MD_LOOKUP_FOLD_SIZE, &folded_size);
 
-	if (bucket == NULL) {
-		return NULL;
-	} else if (ctx->ref_defs <= (MD_REF_DEF *)bucket &&
-		   (MD_REF_DEF *)bucket < ctx->ref_defs + ctx->n_ref_defs) {
-		const MD_REF_DEF *def = (MD_REF_DEF *)bucket;
+	for (i = hash & mask; ctx->ref_def_hashtable[i].def_index >= 0;
+	     i = (i + 1) & mask) {
+		const MD_REF_DEF *def =
+			&ctx->ref_defs[ctx->ref_def_hashtable[i].def_index];
+		const unsigned *def_fold = ctx->ref_def_folds + def->fold_beg;
+
+		if (ctx->ref_def_hashtable[i].hash != hash ||
+		    def->fold_size != folded_size)
+			continue;
 
-		if (md_link_label_cmp(def->label, def->label_size, label,
-				      label_size) == 0)
+		if (folded_size <= MD_LOOKUP_FOLD_SIZE
+			    ? memcmp(def_fold, folded,
+				     folded_size * sizeof(unsigned)) == 0
+			    : md_link_label_eq_fold(label, label_size, def_fold,
+						    folded_size))
 			return def;
-		else
-			return NULL;
-	} else {
-		MD_REF_DEF_LIST *list = (MD_REF_DEF_LIST *)bucket;
-		MD_REF_DEF key_buf;
-		const MD_REF_DEF *key = &key_buf;
-		const MD_REF_DEF **ret;
-
-		key_buf.label = (CHAR *)label;
-		key_buf.label_size = label_size;
-		key_buf.hash =
-			md_link_label_hash(key_buf.label, key_buf.label_size);
-
-		ret = (const MD_REF_DEF **)bsearch(&key, list->ref_defs,
-						   list->n_ref_defs,
-						   sizeof(MD_REF_DEF *),
-						   md_ref_def_cmp);
-		if (ret != NULL)
-			return *ret;
-		else
-			return NULL;
 	}
+
+	return NULL;
 }
 
 /***************************
@@ -2383,20 +2750,22 @@ static int md_is_link_reference_definition(MD_CTX *ctx, const MD_LINE *lines,
 	/* So, it _is_ a reference definition. Remember it. */
 	if (ctx->n_ref_defs >= ctx->alloc_ref_defs) {
 		MD_REF_DEF *new_defs;
-
-		ctx->alloc_ref_defs =
+		int alloc_ref_defs =
 			(ctx->alloc_ref_defs > 0
 				 ? ctx->alloc_ref_defs + ctx->alloc_ref_defs / 2
 				 : 16);
-		new_defs = (MD_REF_DEF *)realloc(ctx->ref_defs,
-						 ctx->alloc_ref_defs *
-							 sizeof(MD_REF_DEF));
+
+		new_defs = (MD_REF_DEF *)md_resize(
+			ctx, ctx->ref_defs,
+			ctx->alloc_ref_defs * sizeof(MD_REF_DEF),
+			alloc_ref_defs * sizeof(MD_REF_DEF));
 		if (new_defs == NULL) {
 			MD_LOG("realloc() failed.");
 			goto abort;
 		}
 
 		ctx->ref_defs = new_defs;
+		ctx->alloc_ref_defs = alloc_ref_defs;
 	}
 	def = &ctx->ref_defs[ctx->n_ref_defs];
 	memset(def, 0, sizeof(MD_REF_DEF));
@@ -2435,9 +2804,9 @@ static int md_is_link_reference_definition(MD_CTX *ctx, const MD_LINE *lines,
 abort:
 	/* Failure. */
 	if (def != NULL && def->label_needs_free)
-		free(def->label);
+		md_release(ctx, def->label);
 	if (def != NULL && def->title_needs_free)
-		free(def->title);
+		md_release(ctx, def->title);
 	return ret;
 }
 
@@ -2481,7 +2850,7 @@ static int md_is_link_reference(MD_CTX *ctx, const MD_LINE *lines, int n_lines,
 	}
 
 	if (is_multiline)
-		free(label);
+		md_release(ctx, label);
 
 	ret = (def != NULL);
 
@@ -2598,12 +2967,13 @@ static void md_free_ref_defs(MD_CTX *ctx)
 		MD_REF_DEF *def = &ctx->ref_defs[i];
 
 		if (def->label_needs_free)
-			free(def->label);
+			md_release(ctx, def->label);
 		if (def->title_needs_free)
-			free(def->title);
+			md_release(ctx, def->title);
 	}
 
-	free(ctx->ref_defs);
+	/* The array itself is a working buffer like the others. */
+	ctx->n_ref_defs = 0;
 }
 
 /******************************************
@@ -2753,19 +3123,20 @@ static MD_MARK *md_push_mark(MD_CTX *ctx)
 {
 	if (ctx->n_marks >= ctx->alloc_marks) {
 		MD_MARK *new_marks;
+		int alloc_marks = (ctx->alloc_marks > 0
+					   ? ctx->alloc_marks + ctx->alloc_marks / 2
+					   : 64);
 
-		ctx->alloc_marks =
-			(ctx->alloc_marks > 0
-				 ? ctx->alloc_marks + ctx->alloc_marks / 2
-				 : 64);
-		new_marks =
-			realloc(ctx->marks, ctx->alloc_marks * sizeof(MD_MARK));
+		new_marks = md_resize(ctx, ctx->marks,
+				      ctx->alloc_marks * sizeof(MD_MARK),
+				      alloc_marks * sizeof(MD_MARK));
 		if (new_marks == NULL) {
 			MD_LOG("realloc() failed.");
 			return NULL;
 		}
 
 		ctx->marks = new_marks;
+		ctx->alloc_marks = alloc_marks;
 	}
 
 	return &ctx->marks[ctx->n_marks++];
@@ -3245,6 +3616,12 @@ static int md_collect_marks(MD_CTX *ctx, const MD_LINE *lines, int n_lines,
 	OFF codespan_last_potential_closers[CODESPAN_MARK_MAXLEN] = {0};
 	int codespan_scanned_till_paragraph_end = FALSE;
 
+	if (n_lines > 0) {
+		ctx->text_class = MD_TEXT_UNCLASSIFIED;
+		ctx->text_class_beg = lines[0].beg;
+		ctx->text_class_end = lines[n_lines - 1].end;
+	}
+
 	for (line = lines; line < line_term; line++) {
 		OFF off = line->beg;
 		OFF line_end = line->end;
@@ -3257,10 +3634,6 @@ static int md_collect_marks(MD_CTX *ctx, const MD_LINE *lines, int n_lines,
 #define IS_MARK_CHAR(off)                                \
 	((CH(off) < SIZEOF_ARRAY(ctx->mark_char_map)) && \
 	 (ctx->mark_char_map[(unsigned char)CH(off)]))
-#else
-/* For 8-bit encodings, mark_char_map[] covers all 256 elements. */
-#define IS_MARK_CHAR(off) (ctx->mark_char_map[(unsigned char)CH(off)])
-#endif
 
 			/* Optimization: Use some loop unrolling. */
 			while (off + 3 < line_end && !IS_MARK_CHAR(off + 0) &&
@@ -3269,6 +3642,14 @@ static int md_collect_marks(MD_CTX *ctx, const MD_LINE *lines, int n_lines,
 				off += 4;
 			while (off < line_end && !IS_MARK_CHAR(off + 0))
 				off++;
+#else
+			/* For 8-bit encodings, skip to the next mark character
+			 * with the vectorized scanner. */
+			if (off < line_end)
+				off += (OFF)md_simd_find_mark(&ctx->simd_marks,
+							      ctx->text + off,
+							      line_end - off);
+#endif
 
 			if (off >= line_end)
 				break;
@@ -3959,7 +4340,9 @@ static int md_resolve_links(MD_CTX *ctx, const MD_LINE *lines, int n_lines)
 							    inline_link_end) {
 								/* Cancel the link status. */
 								if (attr.title_needs_free)
-									free(attr.title);
+									md_release(
+										ctx,
+										attr.title);
 								is_link = FALSE;
 								break;
 							}
@@ -4094,7 +4477,6 @@ static void md_analyze_table_cell_boundary(MD_CTX *ctx, int mark_index)
 	mark->flags |= MD_MARK_RESOLVED;
 
 	md_mark_chain_append(ctx, &TABLECELLBOUNDARIES, mark_index);
-	ctx->n_table_cell_boundaries++;
 }
 
 /* Split a longer mark into two. The new mark takes the given count of
@@ -4257,13 +4639,24 @@ static void md_analyze_dollar(MD_CTX *ctx, int mark_index)
 	md_mark_chain_append(ctx, &DOLLAR_OPENERS, mark_index);
 }
 
-static void md_analyze_permissive_url_autolink(MD_CTX *ctx, int mark_index)
+/* Forward declaration. */
+static inline void md_analyze_marks(MD_CTX *ctx, const MD_LINE *lines,
+				    int n_lines, int mark_beg, int mark_end,
+				    const CHAR *mark_chars);
+
+static void md_analyze_permissive_url_autolink(MD_CTX *ctx,
+					       const MD_LINE *lines,
+					       int n_lines, int mark_index)
 {
 	MD_MARK *opener = &ctx->marks[mark_index];
 	int closer_index = mark_index + 1;
 	MD_MARK *closer = &ctx->marks[closer_index];
 	MD_MARK *next_resolved_mark;
+	MD_MARKCHAIN openers[OPENERS_CHAIN_LAST - OPENERS_CHAIN_FIRST + 1];
+	OFF end = lines[n_lines - 1].end;
 	OFF off = opener->end;
+	int path_end;
+	int i;
 	int n_dots = FALSE;
 	int has_underscore_in_last_seg = FALSE;
 	int has_underscore_in_next_to_last_seg = FALSE;
@@ -4271,7 +4664,7 @@ static void md_analyze_permissive_url_autolink(MD_CTX *ctx, int mark_index)
 	int n_excess_parenthesis = 0;
 
 	/* Check for domain. */
-	while (off < ctx->size) {
+	while (off < end) {
 		if (ISALNUM(off) || CH(off) == _T('-')) {
 			off++;
 		} else if (CH(off) == _T('.')) {
@@ -4297,13 +4690,15 @@ static void md_analyze_permissive_url_autolink(MD_CTX *ctx, int mark_index)
 	    has_underscore_in_next_to_last_seg || has_underscore_in_last_seg)
 		return;
 
-	/* Check for path. */
+	/* Check for path. It also ends before a '$', the math span may contain
+     * the link but not the other way around. */
 	next_resolved_mark = closer + 1;
-	while (next_resolved_mark->ch == 'D' ||
-	       !(next_resolved_mark->flags & MD_MARK_RESOLVED))
+	while ((next_resolved_mark->ch == 'D' ||
+		!(next_resolved_mark->flags & MD_MARK_RESOLVED)) &&
+	       next_resolved_mark->ch != '$')
 		next_resolved_mark++;
-	while (off < next_resolved_mark->beg && CH(off) != _T('<') &&
-	       !ISWHITESPACE(off) && !ISNEWLINE(off)) {
+	while (off < next_resolved_mark->beg && off < end &&
+	       CH(off) != _T('<') && !ISWHITESPACE(off) && !ISNEWLINE(off)) {
 		/* Parenthesis must be balanced. */
 		if (CH(off) == _T('(')) {
 			n_opened_parenthesis++;
@@ -4343,6 +4738,32 @@ static void md_analyze_permissive_url_autolink(MD_CTX *ctx, int mark_index)
 	closer->beg = off;
 	closer->end = off;
 	md_resolve_range(ctx, NULL, mark_index, closer_index);
+
+	/* The closer now lies behind the marks of the path, which have not been
+     * analyzed yet. Pair them among themselves like the contents of a link,
+     * and retire the ones left over. Otherwise e.g. an '_' in the path could
+     * be paired with another one behind the link, crossing its end. */
+	path_end = closer_index + 1;
+	while (ctx->marks[path_end].beg < off)
+		path_end++;
+	if (path_end == closer_index + 1)
+		return;
+
+	memcpy(openers, &ctx->mark_chains[OPENERS_CHAIN_FIRST], sizeof(openers));
+	for (i = OPENERS_CHAIN_FIRST; i <= OPENERS_CHAIN_LAST; i++) {
+		ctx->mark_chains[i].head = -1;
+		ctx->mark_chains[i].tail = -1;
+	}
+	md_analyze_marks(ctx, lines, n_lines, closer_index + 1, path_end,
+			 _T("*_~"));
+	memcpy(&ctx->mark_chains[OPENERS_CHAIN_FIRST], openers, sizeof(openers));
+
+	for (i = closer_index + 1; i < path_end; i++) {
+		if (!(ctx->marks[i].flags & MD_MARK_RESOLVED)) {
+			ctx->marks[i].ch = 'D';
+			ctx->marks[i].flags = 0;
+		}
+	}
 }
 
 /* The permissive autolinks do not have to be enclosed in '<' '>' but we
@@ -4399,8 +4820,6 @@ static inline void md_analyze_marks(MD_CTX *ctx, const MD_LINE *lines,
 				    const CHAR *mark_chars)
 {
 	int i = mark_beg;
-	MD_UNUSED(lines);
-	MD_UNUSED(n_lines);
 
 	while (i < mark_end) {
 		MD_MARK *mark = &ctx->marks[i];
@@ -4447,7 +4866,8 @@ static inline void md_analyze_marks(MD_CTX *ctx, const MD_LINE *lines,
 			break;
 		case '.': /* Pass through. */
 		case ':':
-			md_analyze_permissive_url_autolink(ctx, i);
+			md_analyze_permissive_url_autolink(ctx, lines, n_lines,
+							   i);
 			break;
 		case '@':
 			md_analyze_permissive_email_autolink(ctx, i);
@@ -4485,7 +4905,6 @@ static int md_analyze_inlines(MD_CTX *ctx, const MD_LINE *lines, int n_lines,
 		MD_ASSERT(n_lines == 1);
 		TABLECELLBOUNDARIES.head = -1;
 		TABLECELLBOUNDARIES.tail = -1;
-		ctx->n_table_cell_boundaries = 0;
 		md_analyze_marks(ctx, lines, n_lines, 0, ctx->n_marks, _T("|"));
 		return ret;
 	}
@@ -4951,46 +5370,99 @@ abort:
 	return ret;
 }
 
-static int md_process_table_row(MD_CTX *ctx, MD_BLOCKTYPE cell_type, OFF beg,
-				OFF end, const MD_ALIGN *align, int col_count)
+static int md_push_table_boundary(MD_CTX *ctx, OFF off)
+{
+	if (ctx->n_table_boundaries >= ctx->alloc_table_boundaries) {
+		OFF *new_boundaries;
+		int alloc_table_boundaries =
+			(ctx->alloc_table_boundaries > 0
+				 ? ctx->alloc_table_boundaries +
+					   ctx->alloc_table_boundaries / 2
+				 : 64);
+
+		new_boundaries = md_resize(
+			ctx, ctx->table_boundaries,
+			ctx->alloc_table_boundaries * sizeof(OFF),
+			alloc_table_boundaries * sizeof(OFF));
+		if (new_boundaries == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
+		}
+
+		ctx->table_boundaries = new_boundaries;
+		ctx->alloc_table_boundaries = alloc_table_boundaries;
+	}
+
+	ctx->table_boundaries[ctx->n_table_boundaries++] = off;
+	return 0;
+}
+
+/* Fills ctx->table_boundaries with the start of the row, the ends of the
+ * pipes delimiting its cells and end + 1. */
+static int md_analyze_table_row(MD_CTX *ctx, OFF beg, OFF end)
 {
 	MD_LINE line;
-	OFF *pipe_offs = NULL;
-	int i, j, k, n;
+	OFF off;
+	int i;
 	int ret = 0;
 
-	line.beg = beg;
-	line.end = end;
+	ctx->n_table_boundaries = 0;
+	MD_CHECK(md_push_table_boundary(ctx, beg));
 
-	/* Break the line into table cells by identifying pipe characters who
-     * form the cell boundary. */
-	MD_CHECK(md_analyze_inlines(ctx, &line, 1, TRUE));
+	/* Optimization: A pipe can only be hidden in a backslash escape, a code
+	 * span, raw HTML, an autolink or a link. Without any of them, every pipe
+	 * is a cell boundary and the cells can be analyzed right away, with no
+	 * inline analysis of the whole row before. */
+	for (off = beg; off < end; off++) {
+		CHAR ch = CH(off);
 
-	/* We have to remember the cell boundaries in local buffer because
-     * ctx->marks[] shall be reused during cell contents processing. */
-	n = ctx->n_table_cell_boundaries + 2;
-	pipe_offs = (OFF *)malloc(n * sizeof(OFF));
-	if (pipe_offs == NULL) {
-		MD_LOG("malloc() failed.");
-		ret = -1;
-		goto abort;
+		if (ch == _T('|'))
+			MD_CHECK(md_push_table_boundary(ctx, off + 1));
+		else if (ISANYOF2_(ch, _T('\\'), _T('`')) ||
+			 ISANYOF2_(ch, _T('<'), _T('[')))
+			break;
 	}
-	j = 0;
-	pipe_offs[j++] = beg;
-	for (i = TABLECELLBOUNDARIES.head; i >= 0; i = ctx->marks[i].next) {
-		MD_MARK *mark = &ctx->marks[i];
-		pipe_offs[j++] = mark->end;
+
+	if (off < end) {
+		/* Break the line into table cells by identifying pipe characters
+		 * who form the cell boundary. */
+		line.beg = beg;
+		line.end = end;
+		MD_CHECK(md_analyze_inlines(ctx, &line, 1, TRUE));
+
+		ctx->n_table_boundaries = 1;
+		for (i = TABLECELLBOUNDARIES.head; i >= 0;
+		     i = ctx->marks[i].next)
+			MD_CHECK(md_push_table_boundary(ctx,
+							ctx->marks[i].end));
 	}
-	pipe_offs[j++] = end + 1;
+	MD_CHECK(md_push_table_boundary(ctx, end + 1));
 
-	/* Process cells. */
+abort:
+	return ret;
+}
+
+static int md_process_table_row(MD_CTX *ctx, MD_BLOCKTYPE cell_type, OFF beg,
+				OFF end, const MD_ALIGN *align, int col_count)
+{
+	int i, k;
+	int ret = 0;
+
+	/* The boundaries are kept in ctx->table_boundaries because ctx->marks[]
+	 * shall be reused during cell contents processing. */
+	MD_CHECK(md_analyze_table_row(ctx, beg, end));
+
+	/* Process cells. */
 	MD_ENTER_BLOCK(MD_BLOCK_TR, NULL);
 	k = 0;
-	for (i = 0; i < j - 1 && k < col_count; i++) {
-		if (pipe_offs[i] < pipe_offs[i + 1] - 1)
+	for (i = 0; i < ctx->n_table_boundaries - 1 && k < col_count; i++) {
+		OFF cell_beg = ctx->table_boundaries[i];
+		OFF cell_end = ctx->table_boundaries[i + 1] - 1;
+
+		if (cell_beg < cell_end)
 			MD_CHECK(md_process_table_cell(ctx, cell_type,
-						       align[k++], pipe_offs[i],
-						       pipe_offs[i + 1] - 1));
+						       align[k++], cell_beg,
+						       cell_end));
 	}
 	/* Make sure we call enough table cells even if the current table contains
      * too few of them. */
@@ -5000,11 +5472,9 @@ static int md_process_table_row(MD_CTX *ctx, MD_BLOCKTYPE cell_type, OFF beg,
 	MD_LEAVE_BLOCK(MD_BLOCK_TR, NULL);
 
 abort:
-	free(pipe_offs);
-
 	/* Free any temporary memory blocks stored within some dummy marks. */
 	for (i = PTR_CHAIN.head; i >= 0; i = ctx->marks[i].next)
-		free(md_mark_get_ptr(ctx, i));
+		md_release(ctx, md_mark_get_ptr(ctx, i));
 	PTR_CHAIN.head = -1;
 	PTR_CHAIN.tail = -1;
 
@@ -5022,12 +5492,19 @@ static int md_process_table_block_contents(MD_CTX *ctx, int col_count,
      * with the underlines. */
 	MD_ASSERT(n_lines >= 2);
 
-	align = malloc(col_count * sizeof(MD_ALIGN));
-	if (align == NULL) {
-		MD_LOG("malloc() failed.");
-		ret = -1;
-		goto abort;
+	if (col_count > ctx->alloc_table_align) {
+		align = md_resize(ctx, ctx->table_align,
+				  ctx->alloc_table_align * sizeof(MD_ALIGN),
+				  col_count * sizeof(MD_ALIGN));
+		if (align == NULL) {
+			MD_LOG("realloc() failed.");
+			ret = -1;
+			goto abort;
+		}
+		ctx->table_align = align;
+		ctx->alloc_table_align = col_count;
 	}
+	align = ctx->table_align;
 
 	md_analyze_table_alignment(ctx, lines[1].beg, lines[1].end, align,
 				   col_count);
@@ -5048,7 +5525,6 @@ static int md_process_table_block_contents(MD_CTX *ctx, int col_count,
 	}
 
 abort:
-	free(align);
 	return ret;
 }
 
@@ -5104,7 +5580,7 @@ static int md_process_normal_block_contents(MD_CTX *ctx, const MD_LINE *lines,
 abort:
 	/* Free any temporary memory blocks stored within some dummy marks. */
 	for (i = PTR_CHAIN.head; i >= 0; i = ctx->marks[i].next)
-		free(md_mark_get_ptr(ctx, i));
+		md_release(ctx, md_mark_get_ptr(ctx, i));
 	PTR_CHAIN.head = -1;
 	PTR_CHAIN.tail = -1;
 
@@ -5217,6 +5693,474 @@ abort:
 	return ret;
 }
 
+/*******************************************
+ ***  Parallel Analysis of Leaf Blocks  ***
+ *******************************************/
+
+/* With MD_PARSER::worker_pool, the inlines of paragraphs and headings are
+ * analyzed on the pool before md_process_all_blocks() gets to them. The
+ * blocks are taken in windows of roughly MD_PARALLEL_JOB_SIZE bytes of text
+ * per worker; each job analyzes a run of consecutive blocks of the window
+ * with a private clone of MD_CTX and keeps the resulting marks. While the
+ * calling thread processes the blocks of one window with those marks, the
+ * pool analyzes the next one. */
+
+#ifndef MD_PARALLEL_MIN_SIZE
+#define MD_PARALLEL_MIN_SIZE (256 * 1024) /* Less text is analyzed serially. */
+#endif
+#ifndef MD_PARALLEL_JOB_SIZE
+#define MD_PARALLEL_JOB_SIZE (32 * 1024)
+#endif
+
+typedef struct MD_PREPARED_tag MD_PREPARED;
+struct MD_PREPARED_tag {
+	const MD_LINE *lines;
+	int n_lines;
+	int worker;
+	int mark_beg; /* Index into the MD_WORKER::kept[] of the window. */
+	int n_marks;
+	MD_MARKCHAIN ptr_chain;
+	int ret; /* Non-zero if the analysis failed; the pointers are freed. */
+};
+
+typedef struct MD_WORKER_tag MD_WORKER;
+struct MD_WORKER_tag {
+	MD_CTX ctx;
+
+	/* Marks of the analyzed blocks, for each of the two windows. */
+	MD_MARK *kept[2];
+	int n_kept[2];
+	int alloc_kept[2];
+
+	/* Range of MD_WINDOW::prepared[] of the job, for each of the windows. */
+	int beg[2];
+	int end[2];
+};
+
+typedef struct MD_WINDOW_tag MD_WINDOW;
+struct MD_WINDOW_tag {
+	MD_PARALLEL *parallel;
+	int index;
+	MD_PREPARED *prepared;
+	int n_prepared;
+	int alloc_prepared;
+	int next; /* First entry not consumed yet. */
+	void *handle;
+	int pending; /* Started and not waited for yet. */
+};
+
+struct MD_PARALLEL_tag {
+	const MD_WORKER_POOL *pool;
+	MD_WORKER *workers;
+	int n_workers;
+	MD_WINDOW windows[2];
+	int current;  /* Window the blocks are consumed from. */
+	int scan_off; /* Where the next window starts in ctx->block_bytes. */
+};
+
+static int md_block_size(const MD_BLOCK *block)
+{
+	if (block->flags & MD_BLOCK_CONTAINER)
+		return sizeof(MD_BLOCK);
+	if (block->type == MD_BLOCK_CODE || block->type == MD_BLOCK_HTML)
+		return sizeof(MD_BLOCK) +
+		       block->n_lines * sizeof(MD_VERBATIMLINE);
+	return sizeof(MD_BLOCK) + block->n_lines * sizeof(MD_LINE);
+}
+
+/* Returns the size of the text of a block md_process_leaf_block() passes
+ * to md_process_normal_block_contents(), or zero for any other block. */
+static OFF md_prepared_block_text_size(const MD_BLOCK *block)
+{
+	const MD_LINE *lines = (const MD_LINE *)(block + 1);
+
+	if ((block->flags & MD_BLOCK_CONTAINER) || block->n_lines == 0)
+		return 0;
+
+	switch (block->type) {
+	case MD_BLOCK_HR:
+	case MD_BLOCK_CODE:
+	case MD_BLOCK_HTML:
+	case MD_BLOCK_TABLE:
+		return 0;
+	default:
+		return lines[block->n_lines - 1].end - lines[0].beg;
+	}
+}
+
+static void md_analyze_prepared_job(unsigned index, void *arg)
+{
+	MD_WINDOW *window = (MD_WINDOW *)arg;
+	MD_WORKER *worker = &window->parallel->workers[index];
+	MD_CTX *ctx = &worker->ctx;
+	int slot = window->index;
+	int ret = 0;
+	int i, j;
+
+	worker->n_kept[slot] = 0;
+
+	for (i = worker->beg[slot]; i < worker->end[slot]; i++) {
+		MD_PREPARED *prep = &window->prepared[i];
+
+		prep->worker = (int)index;
+
+		/* After a failure, md_process_all_blocks() stops at this block
+		 * anyway. */
+		if (ret == 0)
+			ret = md_analyze_inlines(ctx, prep->lines,
+						 prep->n_lines, FALSE);
+
+		if (ret == 0 && worker->n_kept[slot] + ctx->n_marks >
+					worker->alloc_kept[slot]) {
+			int alloc_kept = worker->n_kept[slot] + ctx->n_marks;
+			MD_MARK *kept;
+
+			alloc_kept += alloc_kept / 2 + 64;
+			kept = md_resize(ctx, worker->kept[slot],
+					 worker->alloc_kept[slot] *
+						 sizeof(MD_MARK),
+					 alloc_kept * sizeof(MD_MARK));
+			if (kept == NULL) {
+				MD_LOG("realloc() failed.");
+				ret = -1;
+			} else {
+				worker->kept[slot] = kept;
+				worker->alloc_kept[slot] = alloc_kept;
+			}
+		}
+
+		if (ret == 0) {
+			memcpy(worker->kept[slot] + worker->n_kept[slot],
+			       ctx->marks, ctx->n_marks * sizeof(MD_MARK));
+			prep->mark_beg = worker->n_kept[slot];
+			prep->n_marks = ctx->n_marks;
+			prep->ptr_chain = PTR_CHAIN;
+			worker->n_kept[slot] += ctx->n_marks;
+		} else {
+			for (j = PTR_CHAIN.head; j >= 0; j = ctx->marks[j].next)
+				md_release(ctx, md_mark_get_ptr(ctx, j));
+		}
+
+		prep->ret = ret;
+		PTR_CHAIN.head = -1;
+		PTR_CHAIN.tail = -1;
+	}
+}
+
+/* Fills the window with the next blocks and starts their analysis. */
+static int md_start_window(MD_CTX *ctx, MD_WINDOW *window)
+{
+	MD_PARALLEL *par = ctx->parallel;
+	size_t budget = (size_t)par->n_workers * MD_PARALLEL_JOB_SIZE;
+	size_t size = 0;
+	size_t job_size;
+	size_t acc = 0;
+	int n_jobs = 0;
+	int i;
+
+	window->n_prepared = 0;
+	window->next = 0;
+
+	while (par->scan_off < ctx->n_block_bytes && size < budget) {
+		const MD_BLOCK *block =
+			(const MD_BLOCK *)((char *)ctx->block_bytes +
+					   par->scan_off);
+		OFF text_size = md_prepared_block_text_size(block);
+		MD_PREPARED *prep;
+
+		par->scan_off += md_block_size(block);
+		if (text_size == 0)
+			continue;
+
+		if (window->n_prepared >= window->alloc_prepared) {
+			MD_PREPARED *new_prepared;
+			int alloc_prepared =
+				(window->alloc_prepared > 0
+					 ? window->alloc_prepared +
+						   window->alloc_prepared / 2
+					 : 64);
+
+			new_prepared = md_resize(
+				ctx, window->prepared,
+				window->alloc_prepared * sizeof(MD_PREPARED),
+				alloc_prepared * sizeof(MD_PREPARED));
+			if (new_prepared == NULL) {
+				MD_LOG("realloc() failed.");
+				return -1;
+			}
+
+			window->prepared = new_prepared;
+			window->alloc_prepared = alloc_prepared;
+		}
+
+		prep = &window->prepared[window->n_prepared++];
+		prep->lines = (const MD_LINE *)(block + 1);
+		prep->n_lines = block->n_lines;
+		size += text_size;
+	}
+
+	if (window->n_prepared == 0)
+		return 0;
+
+	/* Split the window into consecutive runs of blocks with about the same
+	 * amount of text, at most one for each worker. */
+	job_size = size / par->n_workers + 1;
+	for (i = 0; i < window->n_prepared; i++) {
+		const MD_PREPARED *prep = &window->prepared[i];
+
+		acc += prep->lines[prep->n_lines - 1].end - prep->lines[0].beg;
+		if (acc >= job_size * (n_jobs + 1) ||
+		    i == window->n_prepared - 1) {
+			MD_WORKER *worker = &par->workers[n_jobs++];
+
+			worker->end[window->index] = i + 1;
+			worker->beg[window->index] =
+				(n_jobs > 1 ? par->workers[n_jobs - 2]
+						      .end[window->index]
+					    : 0);
+		}
+	}
+
+	window->handle = par->pool->start(md_analyze_prepared_job, window,
+					  (unsigned)n_jobs,
+					  par->pool->userdata);
+	if (window->handle == NULL) {
+		for (i = 0; i < n_jobs; i++)
+			md_analyze_prepared_job((unsigned)i, window);
+	}
+	window->pending = TRUE;
+	return 0;
+}
+
+static void md_wait_window(MD_PARALLEL *par, MD_WINDOW *window)
+{
+	if (window->handle != NULL)
+		par->pool->wait(window->handle, par->pool->userdata);
+	window->handle = NULL;
+	window->pending = FALSE;
+}
+
+static MD_MARK *md_prepared_marks(MD_CTX *ctx, const MD_WINDOW *window,
+				  const MD_PREPARED *prep)
+{
+	return ctx->parallel->workers[prep->worker].kept[window->index] +
+	       prep->mark_beg;
+}
+
+/* Frees the pointers kept in the marks of a block which is not processed. */
+static void md_drop_prepared(MD_CTX *ctx, const MD_WINDOW *window,
+			     const MD_PREPARED *prep)
+{
+	MD_MARK *marks = ctx->marks;
+	int i;
+
+	if (prep->ret != 0)
+		return;
+
+	ctx->marks = md_prepared_marks(ctx, window, prep);
+	for (i = prep->ptr_chain.head; i >= 0; i = ctx->marks[i].next)
+		md_release(ctx, md_mark_get_ptr(ctx, i));
+	ctx->marks = marks;
+}
+
+/* Finds the analysis of the block with the given lines, if any. Blocks
+ * skipped since the last call are dropped. */
+static int md_take_prepared(MD_CTX *ctx, const MD_LINE *lines,
+			    MD_WINDOW **p_window, MD_PREPARED **p_prep)
+{
+	MD_PARALLEL *par = ctx->parallel;
+	MD_WINDOW *window = &par->windows[par->current];
+	int ret = 0;
+
+	*p_prep = NULL;
+
+	while (TRUE) {
+		if (window->pending) {
+			md_wait_window(par, window);
+
+			/* Let the pool analyze the next window meanwhile. The other
+			 * window is used up at this point. */
+			MD_CHECK(md_start_window(
+				ctx, &par->windows[par->current ^ 1]));
+		}
+
+		while (window->next < window->n_prepared &&
+		       window->prepared[window->next].lines < lines) {
+			md_drop_prepared(ctx, window,
+					 &window->prepared[window->next]);
+			window->next++;
+		}
+
+		if (window->next < window->n_prepared)
+			break;
+
+		/* The window is used up; continue with the other one. */
+		par->current ^= 1;
+		window = &par->windows[par->current];
+		if (window->n_prepared == 0)
+			return 0;
+	}
+
+	if (window->prepared[window->next].lines == lines) {
+		*p_window = window;
+		*p_prep = &window->prepared[window->next++];
+	}
+
+abort:
+	return ret;
+}
+
+static int md_process_prepared_block_contents(MD_CTX *ctx,
+					      const MD_LINE *lines,
+					      int n_lines)
+{
+	MD_MARK *marks = ctx->marks;
+	int n_marks = ctx->n_marks;
+	MD_WINDOW *window;
+	MD_PREPARED *prep;
+	int i;
+	int ret;
+
+	MD_CHECK(md_take_prepared(ctx, lines, &window, &prep));
+	if (prep == NULL)
+		return md_process_normal_block_contents(ctx, lines, n_lines);
+	if (prep->ret != 0)
+		return prep->ret;
+
+	ctx->marks = md_prepared_marks(ctx, window, prep);
+	ctx->n_marks = prep->n_marks;
+	PTR_CHAIN = prep->ptr_chain;
+	MD_CHECK(md_process_inlines(ctx, lines, n_lines));
+
+abort:
+	/* Free any temporary memory blocks stored within some dummy marks. */
+	for (i = PTR_CHAIN.head; i >= 0; i = ctx->marks[i].next)
+		md_release(ctx, md_mark_get_ptr(ctx, i));
+	PTR_CHAIN.head = -1;
+	PTR_CHAIN.tail = -1;
+
+	ctx->marks = marks;
+	ctx->n_marks = n_marks;
+	return ret;
+}
+
+static void md_free_parallel(MD_CTX *ctx)
+{
+	MD_PARALLEL *par = ctx->parallel;
+	int i;
+
+	if (par == NULL)
+		return;
+
+	for (i = 0; i < 2; i++) {
+		MD_WINDOW *window = &par->windows[i];
+
+		if (window->pending)
+			md_wait_window(par, window);
+		while (window->next < window->n_prepared) {
+			md_drop_prepared(ctx, window,
+					 &window->prepared[window->next]);
+			window->next++;
+		}
+		md_release(ctx, window->prepared);
+	}
+
+	for (i = 0; i < par->n_workers; i++) {
+		MD_WORKER *worker = &par->workers[i];
+
+		md_release(ctx, worker->ctx.buffer);
+		md_release(ctx, worker->ctx.marks);
+		md_release(ctx, worker->kept[0]);
+		md_release(ctx, worker->kept[1]);
+	}
+
+	md_release(ctx, par->workers);
+	md_release(ctx, par);
+	ctx->parallel = NULL;
+}
+
+/* Sets ctx->parallel up if the document has enough of text for it and starts
+ * the analysis of the first window. */
+static int md_setup_parallel(MD_CTX *ctx)
+{
+	const MD_WORKER_POOL *pool = ctx->parser.worker_pool;
+	MD_PARALLEL *par;
+	size_t size = 0;
+	int byte_off;
+	int i, j;
+
+	if (pool == NULL || pool->n_workers == 0)
+		return 0;
+
+	for (byte_off = 0;
+	     byte_off < ctx->n_block_bytes && size < MD_PARALLEL_MIN_SIZE;) {
+		const MD_BLOCK *block =
+			(const MD_BLOCK *)((char *)ctx->block_bytes + byte_off);
+
+		size += md_prepared_block_text_size(block);
+		byte_off += md_block_size(block);
+	}
+	if (size < MD_PARALLEL_MIN_SIZE)
+		return 0;
+
+	par = md_alloc(ctx, sizeof(MD_PARALLEL));
+	if (par == NULL) {
+		MD_LOG("malloc() failed.");
+		return -1;
+	}
+	memset(par, 0, sizeof(MD_PARALLEL));
+
+	par->workers = md_alloc(ctx, pool->n_workers * sizeof(MD_WORKER));
+	if (par->workers == NULL) {
+		MD_LOG("malloc() failed.");
+		md_release(ctx, par);
+		return -1;
+	}
+	par->pool = pool;
+	par->n_workers = (int)pool->n_workers;
+
+	/* The workers share the (read-only) reference definitions with ctx but
+	 * have their own marks and buffer. */
+	for (i = 0; i < par->n_workers; i++) {
+		MD_WORKER *worker = &par->workers[i];
+		MD_CTX *worker_ctx = &worker->ctx;
+
+		memset(worker, 0, sizeof(MD_WORKER));
+		memcpy(worker_ctx, ctx, sizeof(MD_CTX));
+		worker_ctx->buffer = NULL;
+		worker_ctx->alloc_buffer = 0;
+		worker_ctx->marks = NULL;
+		worker_ctx->n_marks = 0;
+		worker_ctx->alloc_marks = 0;
+		worker_ctx->table_boundaries = NULL;
+		worker_ctx->alloc_table_boundaries = 0;
+		worker_ctx->table_align = NULL;
+		worker_ctx->alloc_table_align = 0;
+#ifndef MD4C_USE_UTF16
+		worker_ctx->simd_marks.map = worker_ctx->mark_char_map;
+#endif
+		for (j = 0; j < (int)SIZEOF_ARRAY(worker_ctx->mark_chains);
+		     j++) {
+			worker_ctx->mark_chains[j].head = -1;
+			worker_ctx->mark_chains[j].tail = -1;
+		}
+		worker_ctx->unresolved_link_head = -1;
+		worker_ctx->unresolved_link_tail = -1;
+		worker_ctx->html_comment_horizon = 0;
+		worker_ctx->html_proc_instr_horizon = 0;
+		worker_ctx->html_decl_horizon = 0;
+		worker_ctx->html_cdata_horizon = 0;
+	}
+
+	for (i = 0; i < 2; i++) {
+		par->windows[i].parallel = par;
+		par->windows[i].index = i;
+	}
+
+	ctx->parallel = par;
+	return md_start_window(ctx, &par->windows[0]);
+}
+
 static int md_process_leaf_block(MD_CTX *ctx, const MD_BLOCK *block)
 {
 	union {
@@ -5293,8 +6237,14 @@ static int md_process_leaf_block(MD_CTX *ctx, const MD_BLOCK *block)
 		break;
 
 	default:
-		MD_CHECK(md_process_normal_block_contents(
-			ctx, (const MD_LINE *)(block + 1), block->n_lines));
+		if (ctx->parallel != NULL)
+			MD_CHECK(md_process_prepared_block_contents(
+				ctx, (const MD_LINE *)(block + 1),
+				block->n_lines));
+		else
+			MD_CHECK(md_process_normal_block_contents(
+				ctx, (const MD_LINE *)(block + 1),
+				block->n_lines));
 		break;
 	}
 
@@ -5309,72 +6259,348 @@ abort:
 	return ret;
 }
 
-static int md_process_all_blocks(MD_CTX *ctx)
+/* Fills the MD_TOP_LEVEL_BLOCK_DETAIL of the top-level block starting at
+ * byte_off in ctx->block_bytes, except the end of the range. Returns the
+ * offset behind the block. If the block has no lines, *p_has_lines is set to
+ * FALSE and det->beg is left alone. */
+static int md_scan_top_level_block(MD_CTX *ctx, int byte_off,
+				   MD_TOP_LEVEL_BLOCK_DETAIL *det,
+				   int *p_has_lines)
 {
-	int byte_off = 0;
-	int ret = 0;
+	unsigned hash = MD_FNV1A_BASE;
+	int depth = 0;
 
-	/* ctx->containers now is not needed for detection of lists and list items
-     * so we reuse it for tracking what lists are loose or tight. We rely
-     * on the fact the vector is large enough to hold the deepest nesting
-     * level of lists. */
-	ctx->n_containers = 0;
+	det->type = ((MD_BLOCK *)((char *)ctx->block_bytes + byte_off))->type;
+	*p_has_lines = FALSE;
 
-	while (byte_off < ctx->n_block_bytes) {
+	do {
 		MD_BLOCK *block =
 			(MD_BLOCK *)((char *)ctx->block_bytes + byte_off);
-		union {
-			MD_BLOCK_UL_DETAIL ul;
-			MD_BLOCK_OL_DETAIL ol;
-			MD_BLOCK_LI_DETAIL li;
-		} det;
+		unsigned info[4];
+		int i;
 
-		switch (block->type) {
-		case MD_BLOCK_UL:
-			det.ul.is_tight = (block->flags & MD_BLOCK_LOOSE_LIST)
-						  ? FALSE
-						  : TRUE;
-			det.ul.mark = (CHAR)block->data;
-			break;
+		info[0] = block->type;
+		info[1] = block->flags;
+		info[2] = block->data;
+		/* MD_BLOCK_LI stores an absolute offset there. */
+		info[3] = (block->type == MD_BLOCK_LI) ? 0 : block->n_lines;
+		hash = md_fnv1a(hash, info, sizeof(info));
+		byte_off += sizeof(MD_BLOCK);
 
-		case MD_BLOCK_OL:
-			det.ol.start = block->n_lines;
-			det.ol.is_tight = (block->flags & MD_BLOCK_LOOSE_LIST)
-						  ? FALSE
-						  : TRUE;
-			det.ol.mark_delimiter = (CHAR)block->data;
-			break;
+		if (block->flags & MD_BLOCK_CONTAINER) {
+			if (block->flags & MD_BLOCK_CONTAINER_CLOSER)
+				depth--;
+			if (block->flags & MD_BLOCK_CONTAINER_OPENER)
+				depth++;
+			continue;
+		}
 
-		case MD_BLOCK_LI:
-			det.li.is_task = (block->data != 0);
-			det.li.task_mark = (CHAR)block->data;
-			det.li.task_mark_offset = (OFF)block->n_lines;
-			break;
+		for (i = 0; i < (int)block->n_lines; i++) {
+			OFF line[3];
 
-		default:
-			/* noop */
-			break;
+			if (block->type == MD_BLOCK_CODE ||
+			    block->type == MD_BLOCK_HTML) {
+				MD_VERBATIMLINE *vline =
+					(MD_VERBATIMLINE *)((char *)ctx->block_bytes +
+							    byte_off);
+				line[0] = vline->beg;
+				line[1] = vline->end;
+				line[2] = vline->indent;
+				byte_off += sizeof(MD_VERBATIMLINE);
+			} else {
+				MD_LINE *mline =
+					(MD_LINE *)((char *)ctx->block_bytes +
+						    byte_off);
+				line[0] = mline->beg;
+				line[1] = mline->end;
+				line[2] = 0;
+				byte_off += sizeof(MD_LINE);
+			}
+
+			if (!*p_has_lines) {
+				det->beg = line[0];
+				while (det->beg > 0 && !ISNEWLINE(det->beg - 1))
+					det->beg--;
+				*p_has_lines = TRUE;
+			}
+
+			line[0] -= det->beg;
+			line[1] -= det->beg;
+			hash = md_fnv1a(hash, line, sizeof(line));
 		}
+	} while (depth > 0 && byte_off < ctx->n_block_bytes);
 
-		if (block->flags & MD_BLOCK_CONTAINER) {
-			if (block->flags & MD_BLOCK_CONTAINER_CLOSER) {
-				MD_LEAVE_BLOCK(block->type, &det);
+	det->layout_hash = hash;
+	return byte_off;
+}
 
-				if (block->type == MD_BLOCK_UL ||
-				    block->type == MD_BLOCK_OL ||
-				    block->type == MD_BLOCK_QUOTE)
-					ctx->n_containers--;
-			}
+/* Finds the first top-level block with some lines at or after byte_off. */
+static void md_find_top_level_block_lines(MD_CTX *ctx, int byte_off,
+					  int *p_byte_off, OFF *p_beg)
+{
+	MD_TOP_LEVEL_BLOCK_DETAIL det;
+	int has_lines;
 
-			if (block->flags & MD_BLOCK_CONTAINER_OPENER) {
-				MD_ENTER_BLOCK(block->type, &det);
+	while (byte_off < ctx->n_block_bytes) {
+		int end = md_scan_top_level_block(ctx, byte_off, &det,
+						  &has_lines);
+		if (has_lines) {
+			*p_byte_off = byte_off;
+			*p_beg = det.beg;
+			return;
+		}
+		byte_off = end;
+	}
 
-				if (block->type == MD_BLOCK_UL ||
-				    block->type == MD_BLOCK_OL) {
-					ctx->containers[ctx->n_containers]
-						.is_loose =
-						(block->flags &
-						 MD_BLOCK_LOOSE_LIST);
+	*p_byte_off = ctx->n_block_bytes;
+	*p_beg = ctx->size;
+}
+
+static unsigned md_ref_defs_hash(MD_CTX *ctx)
+{
+	unsigned hash = MD_FNV1A_BASE;
+	int i;
+
+	for (i = 0; i < ctx->n_ref_defs; i++) {
+		MD_REF_DEF *def = &ctx->ref_defs[i];
+
+		hash = md_fnv1a(hash, &def->label_size, sizeof(SZ));
+		hash = md_fnv1a(hash, def->label,
+				def->label_size * sizeof(CHAR));
+		hash = md_fnv1a(hash, &def->title_size, sizeof(SZ));
+		hash = md_fnv1a(hash, def->title,
+				def->title_size * sizeof(CHAR));
+		hash = md_fnv1a(hash, ctx->text + def->dest_beg,
+				(def->dest_end - def->dest_beg) * sizeof(CHAR));
+	}
+
+	return hash;
+}
+
+/* Records a fresh point at off, see md_analyze_lines(). Only the last one
+ * before a block is of any interest. */
+static int md_push_fresh_point(MD_CTX *ctx, OFF off)
+{
+	MD_FRESH_POINT *point;
+
+	if (ctx->n_fresh_points > 0) {
+		point = &ctx->fresh_points[ctx->n_fresh_points - 1];
+		if (point->byte_off == ctx->n_block_bytes) {
+			point->off = off;
+			return 0;
+		}
+	}
+
+	if (ctx->n_fresh_points >= ctx->alloc_fresh_points) {
+		MD_FRESH_POINT *new_fresh_points;
+		int alloc_fresh_points =
+			(ctx->alloc_fresh_points > 0
+				 ? ctx->alloc_fresh_points +
+					   ctx->alloc_fresh_points / 2
+				 : 64);
+
+		new_fresh_points = (MD_FRESH_POINT *)md_resize(
+			ctx, ctx->fresh_points,
+			ctx->alloc_fresh_points * sizeof(MD_FRESH_POINT),
+			alloc_fresh_points * sizeof(MD_FRESH_POINT));
+		if (new_fresh_points == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
+		}
+
+		ctx->fresh_points = new_fresh_points;
+		ctx->alloc_fresh_points = alloc_fresh_points;
+	}
+
+	point = &ctx->fresh_points[ctx->n_fresh_points++];
+	point->off = off;
+	point->byte_off = ctx->n_block_bytes;
+	return 0;
+}
+
+/* Records the top-level block at byte_off. If its bytes begin at a fresh
+ * point, it starts a new run there. Otherwise it belongs to the run of the
+ * block before it. */
+static int md_push_top_block(MD_CTX *ctx, int byte_off)
+{
+	MD_TOP_BLOCK *top_block;
+
+	if (ctx->n_top_blocks >= ctx->alloc_top_blocks) {
+		MD_TOP_BLOCK *new_top_blocks;
+		int alloc_top_blocks =
+			(ctx->alloc_top_blocks > 0
+				 ? ctx->alloc_top_blocks +
+					   ctx->alloc_top_blocks / 2
+				 : 64);
+
+		new_top_blocks = (MD_TOP_BLOCK *)md_resize(
+			ctx, ctx->top_blocks,
+			ctx->alloc_top_blocks * sizeof(MD_TOP_BLOCK),
+			alloc_top_blocks * sizeof(MD_TOP_BLOCK));
+		if (new_top_blocks == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
+		}
+
+		ctx->top_blocks = new_top_blocks;
+		ctx->alloc_top_blocks = alloc_top_blocks;
+	}
+
+	/* Skip points whose blocks went away, e.g. consumed definitions. */
+	while (ctx->fresh_point_index < ctx->n_fresh_points &&
+	       ctx->fresh_points[ctx->fresh_point_index].byte_off < byte_off)
+		ctx->fresh_point_index++;
+
+	top_block = &ctx->top_blocks[ctx->n_top_blocks];
+	if (ctx->fresh_point_index < ctx->n_fresh_points &&
+	    ctx->fresh_points[ctx->fresh_point_index].byte_off == byte_off) {
+		top_block->beg = ctx->fresh_points[ctx->fresh_point_index].off;
+		top_block->flags = MD_TOP_BLOCK_RUN_START;
+		ctx->fresh_point_index++;
+	} else {
+		top_block->beg = (ctx->n_top_blocks > 0
+					  ? ctx->top_blocks[ctx->n_top_blocks - 1].beg
+					  : 0);
+		top_block->flags = 0;
+	}
+	ctx->n_top_blocks++;
+	return 0;
+}
+
+/* Calls MD_PARSER::top_level_block() for the top-level block at byte_off
+ * and/or records it for md_reparse_in_context(). Returns the offset behind
+ * the block in *p_end. */
+static int md_enter_top_level_block(MD_CTX *ctx, int byte_off, int *p_end,
+				    int *p_next_byte_off, OFF *p_next_beg,
+				    unsigned ref_defs_hash, int *p_skip)
+{
+	MD_TOP_LEVEL_BLOCK_DETAIL det;
+	int has_lines;
+	int ret;
+
+	*p_end = md_scan_top_level_block(ctx, byte_off, &det, &has_lines);
+
+	/* The range ends where the next block with some lines begins. */
+	if (has_lines || *p_next_byte_off <= byte_off)
+		md_find_top_level_block_lines(ctx, *p_end, p_next_byte_off,
+					      p_next_beg);
+	if (!has_lines)
+		det.beg = *p_next_beg;
+	det.end = *p_next_beg;
+	det.ref_defs_hash = ref_defs_hash;
+	det.skip = FALSE;
+
+	if (ctx->record_top_blocks) {
+		ret = md_push_top_block(ctx, byte_off);
+		if (ret != 0)
+			return ret;
+	}
+
+	if (ctx->parser.top_level_block != NULL) {
+		ret = ctx->parser.top_level_block(&det, ctx->userdata);
+		if (ret != 0) {
+			MD_LOG("Aborted from top_level_block() callback.");
+			return ret;
+		}
+	}
+
+	*p_skip = det.skip;
+	return 0;
+}
+
+static int md_process_all_blocks(MD_CTX *ctx)
+{
+	int byte_off = 0;
+	int top_level_end = 0;
+	int next_byte_off = 0;
+	OFF next_beg = 0;
+	unsigned ref_defs_hash = 0;
+	int ret = 0;
+
+	/* ctx->containers now is not needed for detection of lists and list items
+     * so we reuse it for tracking what lists are loose or tight. We rely
+     * on the fact the vector is large enough to hold the deepest nesting
+     * level of lists. */
+	ctx->n_containers = 0;
+
+	if (ctx->parser.top_level_block != NULL || ctx->record_top_blocks)
+		ref_defs_hash = md_ref_defs_hash(ctx);
+
+	MD_CHECK(md_setup_parallel(ctx));
+
+	while (byte_off < ctx->n_block_bytes) {
+		MD_BLOCK *block =
+			(MD_BLOCK *)((char *)ctx->block_bytes + byte_off);
+		union {
+			MD_BLOCK_UL_DETAIL ul;
+			MD_BLOCK_OL_DETAIL ol;
+			MD_BLOCK_LI_DETAIL li;
+		} det;
+
+		switch (block->type) {
+		case MD_BLOCK_UL:
+			det.ul.is_tight = (block->flags & MD_BLOCK_LOOSE_LIST)
+						  ? FALSE
+						  : TRUE;
+			det.ul.mark = (CHAR)block->data;
+			break;
+
+		case MD_BLOCK_OL:
+			det.ol.start = block->n_lines;
+			det.ol.is_tight = (block->flags & MD_BLOCK_LOOSE_LIST)
+						  ? FALSE
+						  : TRUE;
+			det.ol.mark_delimiter = (CHAR)block->data;
+			break;
+
+		case MD_BLOCK_LI:
+			det.li.is_task = (block->data != 0);
+			det.li.task_mark = (CHAR)block->data;
+			det.li.task_mark_offset = (OFF)block->n_lines;
+			break;
+
+		default:
+			/* noop */
+			break;
+		}
+
+		if ((ctx->parser.top_level_block != NULL ||
+		     ctx->record_top_blocks) &&
+		    byte_off >= top_level_end) {
+			int skip;
+
+			ret = md_enter_top_level_block(ctx, byte_off,
+						       &top_level_end,
+						       &next_byte_off,
+						       &next_beg,
+						       ref_defs_hash, &skip);
+			if (ret != 0)
+				goto abort;
+			if (skip) {
+				byte_off = top_level_end;
+				continue;
+			}
+		}
+
+		if (block->flags & MD_BLOCK_CONTAINER) {
+			if (block->flags & MD_BLOCK_CONTAINER_CLOSER) {
+				MD_LEAVE_BLOCK(block->type, &det);
+
+				if (block->type == MD_BLOCK_UL ||
+				    block->type == MD_BLOCK_OL ||
+				    block->type == MD_BLOCK_QUOTE)
+					ctx->n_containers--;
+			}
+
+			if (block->flags & MD_BLOCK_CONTAINER_OPENER) {
+				MD_ENTER_BLOCK(block->type, &det);
+
+				if (block->type == MD_BLOCK_UL ||
+				    block->type == MD_BLOCK_OL) {
+					ctx->containers[ctx->n_containers]
+						.is_loose =
+						(block->flags &
+						 MD_BLOCK_LOOSE_LIST);
 					ctx->n_containers++;
 				} else if (block->type == MD_BLOCK_QUOTE) {
 					/* This causes that any text in a block quote, even if
@@ -5402,6 +6628,7 @@ static int md_process_all_blocks(MD_CTX *ctx)
 	ctx->n_block_bytes = 0;
 
 abort:
+	md_free_parallel(ctx);
 	return ret;
 }
 
@@ -5415,18 +6642,19 @@ static void *md_push_block_bytes(MD_CTX *ctx, int n_bytes)
 
 	if (ctx->n_block_bytes + n_bytes > ctx->alloc_block_bytes) {
 		void *new_block_bytes;
-
-		ctx->alloc_block_bytes =
-			(ctx->alloc_block_bytes > 0
-				 ? ctx->alloc_block_bytes +
-					   ctx->alloc_block_bytes / 2
-				 : 512);
-		new_block_bytes =
-			realloc(ctx->block_bytes, ctx->alloc_block_bytes);
+		int alloc_block_bytes = (ctx->alloc_block_bytes > 0
+						 ? ctx->alloc_block_bytes +
+							   ctx->alloc_block_bytes / 2
+						 : 512);
+
+		new_block_bytes = md_resize(ctx, ctx->block_bytes,
+					    ctx->alloc_block_bytes,
+					    alloc_block_bytes);
 		if (new_block_bytes == NULL) {
 			MD_LOG("realloc() failed.");
 			return NULL;
 		}
+		ctx->alloc_block_bytes = alloc_block_bytes;
 
 		/* Fix the ->current_block after the reallocation. */
 		if (ctx->current_block != NULL) {
@@ -5639,6 +6867,8 @@ static int md_push_container_bytes(MD_CTX *ctx, MD_BLOCKTYPE type,
 	block->flags = flags;
 	block->data = data;
 	block->n_lines = start;
+	if (type == MD_BLOCK_LI)
+		ctx->li_block_end = ctx->n_block_bytes;
 
 abort:
 	return ret;
@@ -6074,21 +7304,22 @@ static int md_push_container(MD_CTX *ctx, const MD_CONTAINER *container)
 {
 	if (ctx->n_containers >= ctx->alloc_containers) {
 		MD_CONTAINER *new_containers;
-
-		ctx->alloc_containers =
-			(ctx->alloc_containers > 0
-				 ? ctx->alloc_containers +
-					   ctx->alloc_containers / 2
-				 : 16);
-		new_containers =
-			realloc(ctx->containers,
-				ctx->alloc_containers * sizeof(MD_CONTAINER));
+		int alloc_containers = (ctx->alloc_containers > 0
+						? ctx->alloc_containers +
+							  ctx->alloc_containers / 2
+						: 16);
+
+		new_containers = md_resize(
+			ctx, ctx->containers,
+			ctx->alloc_containers * sizeof(MD_CONTAINER),
+			alloc_containers * sizeof(MD_CONTAINER));
 		if (new_containers == NULL) {
 			MD_LOG("realloc() failed.");
 			return -1;
 		}
 
 		ctx->containers = new_containers;
+		ctx->alloc_containers = alloc_containers;
 	}
 
 	memcpy(&ctx->containers[ctx->n_containers++], container,
@@ -6426,6 +7657,11 @@ static int md_analyze_line(MD_CTX *ctx, OFF beg, OFF *p_end,
                  * line which would be part of the list item actually has to
                  * end the list because according to the specification, "a list
                  * item can begin with at most one blank line."
+                 *
+                 * The item is empty if its opener is the last thing in
+                 * ctx->block_bytes. (Reading the last bytes as MD_BLOCK would
+                 * also take the last line of any block for one, depending on
+                 * its offset in the document.)
                  */
 				if (n_parents > 0 &&
 				    ctx->containers[n_parents - 1].ch !=
@@ -6433,17 +7669,10 @@ static int md_analyze_line(MD_CTX *ctx, OFF beg, OFF *p_end,
 				    n_brothers + n_children == 0 &&
 				    ctx->current_block == NULL &&
 				    ctx->n_block_bytes >
-					    (int)sizeof(MD_BLOCK)) {
-					MD_BLOCK *top_block =
-						(MD_BLOCK
-							 *)((char *)ctx
-								    ->block_bytes +
-							    ctx->n_block_bytes -
-							    sizeof(MD_BLOCK));
-					if (top_block->type == MD_BLOCK_LI)
-						ctx->last_list_item_starts_with_two_blank_lines =
-							TRUE;
-				}
+					    (int)sizeof(MD_BLOCK) &&
+				    ctx->n_block_bytes == ctx->li_block_end)
+					ctx->last_list_item_starts_with_two_blank_lines =
+						TRUE;
 #endif
 			}
 			break;
@@ -6461,16 +7690,9 @@ static int md_analyze_line(MD_CTX *ctx, OFF beg, OFF *p_end,
 				    n_brothers + n_children == 0 &&
 				    ctx->current_block == NULL &&
 				    ctx->n_block_bytes >
-					    (int)sizeof(MD_BLOCK)) {
-					MD_BLOCK *top_block =
-						(MD_BLOCK
-							 *)((char *)ctx
-								    ->block_bytes +
-							    ctx->n_block_bytes -
-							    sizeof(MD_BLOCK));
-					if (top_block->type == MD_BLOCK_LI)
-						n_parents--;
-				}
+					    (int)sizeof(MD_BLOCK) &&
+				    ctx->n_block_bytes == ctx->li_block_end)
+					n_parents--;
 
 				ctx->last_list_item_starts_with_two_blank_lines =
 					FALSE;
@@ -6896,35 +8118,257 @@ abort:
 	return ret;
 }
 
-static int md_process_doc(MD_CTX *ctx)
+/* Where md_analyze_lines() may stop early, see md_reparse_in_context(). */
+typedef struct MD_RESYNC_tag MD_RESYNC;
+struct MD_RESYNC_tag {
+	OFF min_off; /* End of the edit in the new document. */
+	SZ old_size; /* Size of the edit in the old and in the new document. */
+	SZ new_size;
+	const MD_TOP_BLOCK *top_blocks; /* Top-level blocks of the old document. */
+	int n_top_blocks;
+	int index; /* Output: Index of the old block at the stop. */
+};
+
+/* Called at a fresh point off. Analyzing of the new document may stop there
+ * if the old document has a run starting at the same place: The text from
+ * there on is the same in both documents and the analysis starts from
+ * scratch at off in both. */
+static int md_can_resync(MD_CTX *ctx, OFF off, MD_RESYNC *resync)
+{
+	OFF old_off;
+	int lo = 0;
+	int hi = resync->n_top_blocks;
+
+	if (off < resync->min_off || off >= ctx->size)
+		return FALSE;
+
+	old_off = off - resync->new_size + resync->old_size;
+
+	/* Find the first block at or behind old_off. */
+	while (lo < hi) {
+		int mid = lo + (hi - lo) / 2;
+
+		if (resync->top_blocks[mid].beg < old_off)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+
+	/* Other blocks of a run have the beg of the block starting it. */
+	if (lo >= resync->n_top_blocks ||
+	    resync->top_blocks[lo].beg != old_off ||
+	    !(resync->top_blocks[lo].flags & MD_TOP_BLOCK_RUN_START))
+		return FALSE;
+
+	resync->index = lo;
+	return TRUE;
+}
+
+/* Returns the offset behind the last "]:" in the document. As a link
+ * reference definition has one right behind its label, no definition can
+ * end behind it. */
+static OFF md_ref_defs_end(MD_CTX *ctx)
 {
-	const MD_LINE_ANALYSIS *pivot_line = &md_dummy_blank_line;
+	OFF end = 0;
+#ifndef MD4C_USE_UTF16
+	/* Like strcspn() in md_analyze_line(), memchr() is vectorized in the
+	 * common C libraries. */
+	const CHAR *ptr = ctx->text;
+	const CHAR *limit = ctx->text + ctx->size;
+
+	while ((ptr = (const CHAR *)memchr(ptr, _T(':'), limit - ptr)) !=
+	       NULL) {
+		if (ptr > ctx->text && ptr[-1] == _T(']'))
+			end = (OFF)(ptr - ctx->text) + 1;
+		ptr++;
+	}
+#else
+	OFF off;
+
+	for (off = 1; off < ctx->size; off++) {
+		if (CH(off) == _T(':') && CH(off - 1) == _T(']'))
+			end = off + 1;
+	}
+#endif
+	return end;
+}
+
+/* Fewer bytes of pending blocks wait for more. Processing every little run
+ * on its own costs more than it gains. */
+#ifndef MD_PIPELINE_MIN_BYTES
+#define MD_PIPELINE_MIN_BYTES (16 * 1024)
+#endif
+
+/* Sets md_process_doc() up to process the blocks while it analyzes the
+ * lines, so that the application gets the first blocks early and
+ * ctx->block_bytes stays small. The application has to ask for that with
+ * MD_FLAG_PIPELINE, as it may get output before an error. It is not possible
+ * if the application wants to know about the whole document first
+ * (MD_PARSER::top_level_block(), md_reparse_in_context()) or with the worker
+ * pool, which needs many blocks at once. */
+static void md_setup_pipeline(MD_CTX *ctx)
+{
+	if (!(ctx->parser.flags & MD_FLAG_PIPELINE) ||
+	    ctx->parser.top_level_block != NULL || ctx->record_top_blocks ||
+	    ctx->parser.worker_pool != NULL)
+		return;
+
+	ctx->pipeline = TRUE;
+	ctx->ref_defs_end = md_ref_defs_end(ctx);
+}
+
+/* Called at a fresh point off (see md_continue_lines()): All the blocks
+ * before it are complete and nothing after it refers back to them, so they
+ * can be processed and dropped. Unless all link reference definitions are
+ * known by then, i.e. before ctx->ref_defs_end, that is only done if no
+ * link can be among them. */
+static int md_pipeline_blocks(MD_CTX *ctx, OFF off)
+{
+	int ret = 0;
+
+	if (ctx->n_block_bytes < MD_PIPELINE_MIN_BYTES)
+		return 0;
+
+	if (off < ctx->ref_defs_end) {
+		if (!ctx->pending_bracket) {
+			ctx->pending_bracket =
+				(memchr(STR(ctx->bracket_scan_off), _T('['),
+					(off - ctx->bracket_scan_off) *
+						sizeof(CHAR)) != NULL);
+			ctx->bracket_scan_off = off;
+		}
+		if (ctx->pending_bracket)
+			return 0;
+	} else if (!ctx->ref_defs_hashed) {
+		MD_CHECK(md_build_ref_def_hashtable(ctx));
+		ctx->ref_defs_hashed = TRUE;
+	}
+
+	if (!ctx->doc_entered) {
+		MD_ENTER_BLOCK(MD_BLOCK_DOC, NULL);
+		ctx->doc_entered = TRUE;
+	}
+	MD_CHECK(md_process_all_blocks(ctx));
+
+	/* Like at the start of the document. */
+	ctx->li_block_end = 0;
+	ctx->bracket_scan_off = off;
+
+abort:
+	return ret;
+}
+
+/* Where md_continue_lines() is in the document. It lives outside of the
+ * loop so that the lines can be analyzed as the text arrives, see
+ * md_parse_stream_feed(). pivot_line and line may point into line_buf. */
+typedef struct MD_LINE_LOOP_tag MD_LINE_LOOP;
+struct MD_LINE_LOOP_tag {
+	const MD_LINE_ANALYSIS *pivot_line;
 	MD_LINE_ANALYSIS line_buf[2];
-	MD_LINE_ANALYSIS *line = &line_buf[0];
-	OFF off = 0;
+	MD_LINE_ANALYSIS *line;
+	OFF off;
+};
+
+static int md_begin_lines(MD_CTX *ctx, MD_LINE_LOOP *loop, OFF beg)
+{
 	int ret = 0;
 
-	MD_ENTER_BLOCK(MD_BLOCK_DOC, NULL);
+	loop->pivot_line = &md_dummy_blank_line;
+	loop->line = &loop->line_buf[0];
+	loop->off = beg;
+
+	ctx->n_fresh_points = 0;
+	if (ctx->record_top_blocks)
+		MD_CHECK(md_push_fresh_point(ctx, beg));
+
+abort:
+	return ret;
+}
+
+/* Breaks the lines from loop->off up to ctx->size into blocks. Unless resync
+ * is NULL, this may stop at a fresh point before that. */
+static int md_continue_lines(MD_CTX *ctx, MD_LINE_LOOP *loop,
+			     MD_RESYNC *resync)
+{
+	const MD_LINE_ANALYSIS *pivot_line = loop->pivot_line;
+	MD_LINE_ANALYSIS *line = loop->line;
+	OFF off = loop->off;
+	int ret = 0;
 
 	while (off < ctx->size) {
 		if (line == pivot_line)
-			line = (line == &line_buf[0] ? &line_buf[1]
-						     : &line_buf[0]);
+			line = (line == &loop->line_buf[0]
+					? &loop->line_buf[1]
+					: &loop->line_buf[0]);
 
 		MD_CHECK(md_analyze_line(ctx, off, &off, pivot_line, line));
 		MD_CHECK(md_process_line(ctx, &pivot_line, line));
+
+		if (line->type == MD_LINE_BLANK && ctx->current_block == NULL &&
+		    ctx->n_containers == 0) {
+			if (resync != NULL && md_can_resync(ctx, off, resync))
+				break;
+			if (ctx->record_top_blocks)
+				MD_CHECK(md_push_fresh_point(ctx, off));
+			if (ctx->pipeline)
+				MD_CHECK(md_pipeline_blocks(ctx, off));
+		}
 	}
 
+	loop->pivot_line = pivot_line;
+	loop->line = line;
+	loop->off = off;
+
+abort:
+	return ret;
+}
+
+/* Breaks the lines from beg on into blocks. Unless resync is NULL, this may
+ * stop at a fresh point before the end of the document. The offset where it
+ * stopped is stored into *p_end. */
+static int md_analyze_lines(MD_CTX *ctx, OFF beg, MD_RESYNC *resync,
+			    OFF *p_end)
+{
+	MD_LINE_LOOP loop;
+	int ret = 0;
+
+	MD_CHECK(md_begin_lines(ctx, &loop, beg));
+	MD_CHECK(md_continue_lines(ctx, &loop, resync));
+
 	md_end_current_block(ctx);
+	*p_end = loop.off;
+
+abort:
+	return ret;
+}
 
-	MD_CHECK(md_build_ref_def_hashtable(ctx));
+/* Reports all the blocks found by md_analyze_lines() to the application. */
+static int md_process_doc_blocks(MD_CTX *ctx)
+{
+	int ret = 0;
 
-	/* Process all blocks. */
+	if (!ctx->ref_defs_hashed)
+		MD_CHECK(md_build_ref_def_hashtable(ctx));
 	MD_CHECK(md_leave_child_containers(ctx, 0));
-	MD_CHECK(md_process_all_blocks(ctx));
 
+	if (!ctx->doc_entered)
+		MD_ENTER_BLOCK(MD_BLOCK_DOC, NULL);
+	MD_CHECK(md_process_all_blocks(ctx));
 	MD_LEAVE_BLOCK(MD_BLOCK_DOC, NULL);
 
+abort:
+	return ret;
+}
+
+static int md_process_doc(MD_CTX *ctx)
+{
+	OFF end;
+	int ret = 0;
+
+	md_setup_pipeline(ctx);
+	MD_CHECK(md_analyze_lines(ctx, 0, NULL, &end));
+	MD_CHECK(md_process_doc_blocks(ctx));
+
 abort:
 
 #if 0
@@ -6956,49 +8400,854 @@ abort:
  ***  Public API  ***
  ********************/
 
-int md_parse(const MD_CHAR *text, MD_SIZE size, const MD_PARSER *parser,
-	     void *userdata)
-{
-	MD_CTX ctx;
-	int i;
-	int ret;
+typedef struct MD_ARENA_CHUNK_tag MD_ARENA_CHUNK;
+struct MD_ARENA_CHUNK_tag {
+	MD_ARENA_CHUNK *prev;
+	size_t size; /* Usable bytes after the header. */
+};
 
-	if (parser->abi_version != 0) {
-		if (parser->debug_log != NULL)
-			parser->debug_log("Unsupported abi_version.", userdata);
-		return -1;
-	}
+struct MD_ARENA_tag {
+	MD_ALLOCATOR allocator;
+	MD_ARENA_CHUNK *chunk; /* Current chunk, older ones are linked via prev. */
+	size_t used;           /* Bytes used in the current chunk. */
+	size_t first_size;
+	void *last;            /* The most recent allocation. */
+};
 
-	/* Setup context structure. */
-	memset(&ctx, 0, sizeof(MD_CTX));
-	ctx.text = text;
-	ctx.size = size;
-	memcpy(&ctx.parser, parser, sizeof(MD_PARSER));
-	ctx.userdata = userdata;
-	ctx.code_indent_offset =
-		(ctx.parser.flags & MD_FLAG_NOINDENTEDCODEBLOCKS) ? (OFF)(-1)
-								  : 4;
-	md_build_mark_char_map(&ctx);
-	ctx.doc_ends_with_newline = (size > 0 && ISNEWLINE_(text[size - 1]));
+#define MD_ARENA_ALIGN 16
+#define MD_ARENA_ROUND(size) \
+	(((size) + MD_ARENA_ALIGN - 1) & ~(size_t)(MD_ARENA_ALIGN - 1))
+#define MD_ARENA_DATA(chunk) \
+	((char *)(chunk) + MD_ARENA_ROUND(sizeof(MD_ARENA_CHUNK)))
 
-	/* Reset all unresolved opener mark chains. */
-	for (i = 0; i < (int)SIZEOF_ARRAY(ctx.mark_chains); i++) {
-		ctx.mark_chains[i].head = -1;
-		ctx.mark_chains[i].tail = -1;
-	}
-	ctx.unresolved_link_head = -1;
-	ctx.unresolved_link_tail = -1;
+static void *md_arena_alloc(size_t size, void *userdata)
+{
+	MD_ARENA *arena = (MD_ARENA *)userdata;
+	size_t rounded = MD_ARENA_ROUND(size);
+	void *ptr;
+
+	if (rounded < size)
+		return NULL;
+
+	if (arena->chunk == NULL || rounded > arena->chunk->size - arena->used) {
+		MD_ARENA_CHUNK *chunk;
+		size_t chunk_size = (arena->chunk != NULL ? arena->chunk->size * 2
+							  : arena->first_size);
+
+		if (chunk_size < rounded)
+			chunk_size = rounded;
+		chunk = (MD_ARENA_CHUNK *)MD_MALLOC(
+			MD_ARENA_ROUND(sizeof(MD_ARENA_CHUNK)) + chunk_size);
+		if (chunk == NULL)
+			return NULL;
+		chunk->prev = arena->chunk;
+		chunk->size = chunk_size;
+		arena->chunk = chunk;
+		arena->used = 0;
+	}
+
+	ptr = MD_ARENA_DATA(arena->chunk) + arena->used;
+	arena->used += rounded;
+	arena->last = ptr;
+	return ptr;
+}
+
+static void *md_arena_resize(void *ptr, size_t old_size, size_t new_size,
+			     void *userdata)
+{
+	MD_ARENA *arena = (MD_ARENA *)userdata;
+	void *new_ptr;
+
+	if (ptr == NULL)
+		return md_arena_alloc(new_size, userdata);
+
+	/* The most recent allocation can grow in place. */
+	if (ptr == arena->last) {
+		size_t off = (size_t)((char *)ptr - MD_ARENA_DATA(arena->chunk));
+		size_t rounded = MD_ARENA_ROUND(new_size);
+
+		if (rounded >= new_size && rounded <= arena->chunk->size - off) {
+			arena->used = off + rounded;
+			return ptr;
+		}
+	}
+
+	if (new_size <= old_size)
+		return ptr;
+	new_ptr = md_arena_alloc(new_size, userdata);
+	if (new_ptr != NULL)
+		memcpy(new_ptr, ptr, old_size);
+	return new_ptr;
+}
+
+static void md_arena_release(void *ptr, void *userdata)
+{
+	MD_ARENA *arena = (MD_ARENA *)userdata;
+
+	/* Only the most recent allocation can be given back. */
+	if (ptr == arena->last) {
+		arena->used = (size_t)((char *)ptr - MD_ARENA_DATA(arena->chunk));
+		arena->last = NULL;
+	}
+}
+
+MD_ARENA *md_arena_new(size_t chunk_size)
+{
+	MD_ARENA *arena;
+
+	arena = (MD_ARENA *)MD_MALLOC(sizeof(MD_ARENA));
+	if (arena == NULL)
+		return NULL;
+	memset(arena, 0, sizeof(MD_ARENA));
+	arena->allocator.alloc = md_arena_alloc;
+	arena->allocator.resize = md_arena_resize;
+	arena->allocator.release = md_arena_release;
+	arena->allocator.userdata = arena;
+	arena->first_size = (chunk_size > 0 ? chunk_size : 64 * 1024);
+	return arena;
+}
+
+void md_arena_free(MD_ARENA *arena)
+{
+	if (arena == NULL)
+		return;
+	md_arena_reset(arena);
+	MD_FREE(arena->chunk);
+	MD_FREE(arena);
+}
+
+void md_arena_reset(MD_ARENA *arena)
+{
+	/* Keep the current chunk, it is the largest one. */
+	if (arena->chunk != NULL) {
+		MD_ARENA_CHUNK *chunk = arena->chunk->prev;
+
+		while (chunk != NULL) {
+			MD_ARENA_CHUNK *prev = chunk->prev;
+			MD_FREE(chunk);
+			chunk = prev;
+		}
+		arena->chunk->prev = NULL;
+	}
+	arena->used = 0;
+	arena->last = NULL;
+}
+
+const MD_ALLOCATOR *md_arena_allocator(MD_ARENA *arena)
+{
+	return &arena->allocator;
+}
+
+/* The part of MD_CTX which survives between documents parsed in the same
+ * MD_PARSER_CONTEXT. */
+struct MD_PARSER_CONTEXT_tag {
+	MD_CTX ctx;
+	int has_mark_char_map;
+	unsigned mark_char_map_flags;
+
+	/* The last document, for md_reparse_in_context(). The arrays belong to
+	 * ctx.allocator. */
+	int has_doc;
+	unsigned doc_flags;
+	SZ doc_size;
+	unsigned doc_ref_defs_hash;
+	MD_TOP_BLOCK *top_blocks;
+	int n_top_blocks;
+	int alloc_top_blocks;
+	MD_REF_DEF *ref_defs;
+	int n_ref_defs;
+	int alloc_ref_defs;
+};
+
+static void md_free_buffers(MD_CTX *ctx)
+{
+	/* Nothing was allocated before the first md_parse_ctx(). */
+	if (ctx->allocator == NULL)
+		return;
+
+	md_release(ctx, ctx->buffer);
+	ctx->buffer = NULL;
+	ctx->alloc_buffer = 0;
+	md_release(ctx, ctx->ref_defs);
+	ctx->ref_defs = NULL;
+	ctx->alloc_ref_defs = 0;
+	md_release(ctx, ctx->ref_def_hashtable);
+	ctx->ref_def_hashtable = NULL;
+	ctx->alloc_ref_def_hashtable = 0;
+	md_release(ctx, ctx->ref_def_folds);
+	ctx->ref_def_folds = NULL;
+	ctx->alloc_ref_def_folds = 0;
+	md_release(ctx, ctx->marks);
+	ctx->marks = NULL;
+	ctx->alloc_marks = 0;
+	md_release(ctx, ctx->table_boundaries);
+	ctx->table_boundaries = NULL;
+	ctx->alloc_table_boundaries = 0;
+	md_release(ctx, ctx->table_align);
+	ctx->table_align = NULL;
+	ctx->alloc_table_align = 0;
+	md_release(ctx, ctx->block_bytes);
+	ctx->block_bytes = NULL;
+	ctx->alloc_block_bytes = 0;
+	md_release(ctx, ctx->containers);
+	ctx->containers = NULL;
+	ctx->alloc_containers = 0;
+	md_release(ctx, ctx->top_blocks);
+	ctx->top_blocks = NULL;
+	ctx->alloc_top_blocks = 0;
+	md_release(ctx, ctx->fresh_points);
+	ctx->fresh_points = NULL;
+	ctx->alloc_fresh_points = 0;
+}
+
+/* Resets everything but the working buffers (and their allocator) and the
+ * mark character map. */
+static void md_reset_ctx(MD_CTX *ctx)
+{
+	MD_CTX keep;
+	int i;
+
+	memcpy(&keep, ctx, sizeof(MD_CTX));
+	memset(ctx, 0, sizeof(MD_CTX));
+
+	ctx->buffer = keep.buffer;
+	ctx->alloc_buffer = keep.alloc_buffer;
+	ctx->ref_defs = keep.ref_defs;
+	ctx->alloc_ref_defs = keep.alloc_ref_defs;
+	ctx->ref_def_hashtable = keep.ref_def_hashtable;
+	ctx->alloc_ref_def_hashtable = keep.alloc_ref_def_hashtable;
+	ctx->ref_def_folds = keep.ref_def_folds;
+	ctx->alloc_ref_def_folds = keep.alloc_ref_def_folds;
+	ctx->marks = keep.marks;
+	ctx->alloc_marks = keep.alloc_marks;
+	ctx->table_boundaries = keep.table_boundaries;
+	ctx->alloc_table_boundaries = keep.alloc_table_boundaries;
+	ctx->table_align = keep.table_align;
+	ctx->alloc_table_align = keep.alloc_table_align;
+	ctx->block_bytes = keep.block_bytes;
+	ctx->alloc_block_bytes = keep.alloc_block_bytes;
+	ctx->containers = keep.containers;
+	ctx->alloc_containers = keep.alloc_containers;
+	ctx->top_blocks = keep.top_blocks;
+	ctx->alloc_top_blocks = keep.alloc_top_blocks;
+	ctx->fresh_points = keep.fresh_points;
+	ctx->alloc_fresh_points = keep.alloc_fresh_points;
+	ctx->allocator = keep.allocator;
+	memcpy(ctx->mark_char_map, keep.mark_char_map,
+	       sizeof(ctx->mark_char_map));
+#ifndef MD4C_USE_UTF16
+	memcpy(&ctx->simd_marks, &keep.simd_marks, sizeof(MD_SIMD_MARKS));
+	ctx->simd_marks.map = ctx->mark_char_map;
+#endif
+
+	/* Reset all unresolved opener mark chains. */
+	for (i = 0; i < (int)SIZEOF_ARRAY(ctx->mark_chains); i++) {
+		ctx->mark_chains[i].head = -1;
+		ctx->mark_chains[i].tail = -1;
+	}
+	ctx->unresolved_link_head = -1;
+	ctx->unresolved_link_tail = -1;
+}
+
+static const MD_ALLOCATOR *md_parser_allocator(const MD_PARSER *parser)
+{
+	return (parser->allocator != NULL ? parser->allocator
+					  : &md_default_allocator);
+}
+
+/* Sets the context up for parsing text. */
+static int md_setup_ctx(MD_CTX *ctx, const MD_CHAR *text, MD_SIZE size,
+			const MD_PARSER *parser, void *userdata,
+			int build_mark_char_map)
+{
+	const MD_ALLOCATOR *allocator = md_parser_allocator(parser);
+
+	if (parser->abi_version != 0) {
+		if (parser->debug_log != NULL)
+			parser->debug_log("Unsupported abi_version.", userdata);
+		return -1;
+	}
+
+	/* The buffers kept from the previous call belong to its allocator. */
+	if (ctx->allocator != allocator)
+		md_free_buffers(ctx);
+
+	md_reset_ctx(ctx);
+	ctx->allocator = allocator;
+	ctx->text = text;
+	ctx->size = size;
+	memcpy(&ctx->parser, parser, sizeof(MD_PARSER));
+	ctx->userdata = userdata;
+	ctx->code_indent_offset =
+		(ctx->parser.flags & MD_FLAG_NOINDENTEDCODEBLOCKS) ? (OFF)(-1)
+								  : 4;
+	if (build_mark_char_map) {
+		md_build_mark_char_map(ctx);
+#ifndef MD4C_USE_UTF16
+		md_simd_marks_init(&ctx->simd_marks, ctx->mark_char_map, 1);
+#endif
+	}
+	ctx->doc_ends_with_newline = (size > 0 && ISNEWLINE_(text[size - 1]));
+	return 0;
+}
+
+static int md_parse_ctx(MD_CTX *ctx, const MD_CHAR *text, MD_SIZE size,
+			const MD_PARSER *parser, void *userdata,
+			int build_mark_char_map)
+{
+	int ret;
+
+	ret = md_setup_ctx(ctx, text, size, parser, userdata,
+			   build_mark_char_map);
+	if (ret != 0)
+		return ret;
 
 	/* All the work. */
-	ret = md_process_doc(&ctx);
+	ret = md_process_doc(ctx);
 
 	/* Clean-up. */
-	md_free_ref_defs(&ctx);
-	md_free_ref_def_hashtable(&ctx);
-	free(ctx.buffer);
-	free(ctx.marks);
-	free(ctx.block_bytes);
-	free(ctx.containers);
+	md_free_ref_def_hashtable(ctx);
+	md_free_ref_defs(ctx);
+
+	return ret;
+}
+
+int md_parse(const MD_CHAR *text, MD_SIZE size, const MD_PARSER *parser,
+	     void *userdata)
+{
+	MD_CTX ctx;
+	int ret;
+
+	memset(&ctx, 0, sizeof(MD_CTX));
+	ret = md_parse_ctx(&ctx, text, size, parser, userdata, TRUE);
+	md_free_buffers(&ctx);
+	return ret;
+}
+
+/* Forgets the last document. With release_buffers, its arrays are freed as
+ * well, e.g. because the allocator changes. */
+static void md_drop_doc(MD_PARSER_CONTEXT *context, int release_buffers)
+{
+	MD_CTX *ctx = &context->ctx;
+	int i;
+
+	for (i = 0; i < context->n_ref_defs; i++) {
+		MD_REF_DEF *def = &context->ref_defs[i];
+
+		if (def->label_needs_free)
+			md_release(ctx, def->label);
+		if (def->title_needs_free)
+			md_release(ctx, def->title);
+	}
+
+	context->has_doc = FALSE;
+	context->n_ref_defs = 0;
+	context->n_top_blocks = 0;
+
+	if (release_buffers && ctx->allocator != NULL) {
+		md_release(ctx, context->ref_defs);
+		context->ref_defs = NULL;
+		context->alloc_ref_defs = 0;
+		md_release(ctx, context->top_blocks);
+		context->top_blocks = NULL;
+		context->alloc_top_blocks = 0;
+	}
+}
+
+/* Keeps the link reference definitions of the document just parsed for
+ * md_reparse_in_context(). Their strings which point into the document are
+ * turned into offsets. The top-level blocks are up to the caller. */
+static void md_keep_doc(MD_PARSER_CONTEXT *context, SZ size,
+			unsigned ref_defs_hash)
+{
+	MD_CTX *ctx = &context->ctx;
+	MD_REF_DEF *ref_defs = context->ref_defs;
+	int alloc_ref_defs = context->alloc_ref_defs;
+	int i;
+
+	MD_ASSERT(context->n_ref_defs == 0);
+
+	context->ref_defs = ctx->ref_defs;
+	context->n_ref_defs = ctx->n_ref_defs;
+	context->alloc_ref_defs = ctx->alloc_ref_defs;
+	ctx->ref_defs = ref_defs;
+	ctx->n_ref_defs = 0;
+	ctx->alloc_ref_defs = alloc_ref_defs;
+
+	for (i = 0; i < context->n_ref_defs; i++) {
+		MD_REF_DEF *def = &context->ref_defs[i];
+
+		if (!def->label_needs_free) {
+			def->label_off = (OFF)(def->label - ctx->text);
+			def->label = NULL;
+		}
+		if (!def->title_needs_free) {
+			def->title_off = (OFF)(def->title - ctx->text);
+			def->title = NULL;
+		}
+	}
+
+	context->has_doc = TRUE;
+	context->doc_flags = ctx->parser.flags;
+	context->doc_size = size;
+	context->doc_ref_defs_hash = ref_defs_hash;
+}
+
+/* Moves kept link reference definitions back into ctx->ref_defs. Offsets
+ * are moved by new_size - old_size. */
+static int md_restore_ref_defs(MD_CTX *ctx, MD_REF_DEF *defs, int n_defs,
+			       SZ old_size, SZ new_size)
+{
+	int i;
+
+	if (ctx->n_ref_defs + n_defs > ctx->alloc_ref_defs) {
+		MD_REF_DEF *new_defs;
+		/* Grow like md_is_link_reference_definition() would. */
+		int alloc_ref_defs =
+			ctx->alloc_ref_defs + ctx->alloc_ref_defs / 2;
+
+		if (alloc_ref_defs < ctx->n_ref_defs + n_defs)
+			alloc_ref_defs = ctx->n_ref_defs + n_defs;
+		if (alloc_ref_defs < 16)
+			alloc_ref_defs = 16;
+
+		new_defs = (MD_REF_DEF *)md_resize(
+			ctx, ctx->ref_defs,
+			ctx->alloc_ref_defs * sizeof(MD_REF_DEF),
+			alloc_ref_defs * sizeof(MD_REF_DEF));
+		if (new_defs == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
+		}
+
+		ctx->ref_defs = new_defs;
+		ctx->alloc_ref_defs = alloc_ref_defs;
+	}
+
+	for (i = 0; i < n_defs; i++) {
+		MD_REF_DEF *def = &ctx->ref_defs[ctx->n_ref_defs++];
+
+		memcpy(def, &defs[i], sizeof(MD_REF_DEF));
+		if (!def->label_needs_free)
+			def->label = (CHAR *)STR(def->label_off - old_size +
+						 new_size);
+		if (!def->title_needs_free)
+			def->title = (CHAR *)STR(def->title_off - old_size +
+						 new_size);
+		def->dest_beg = def->dest_beg - old_size + new_size;
+		def->dest_end = def->dest_end - old_size + new_size;
+	}
 
+	return 0;
+}
+
+MD_PARSER_CONTEXT *md_parser_context_new(void)
+{
+	MD_PARSER_CONTEXT *context;
+
+	context = (MD_PARSER_CONTEXT *)MD_MALLOC(sizeof(MD_PARSER_CONTEXT));
+	if (context == NULL)
+		return NULL;
+	memset(context, 0, sizeof(MD_PARSER_CONTEXT));
+	return context;
+}
+
+void md_parser_context_free(MD_PARSER_CONTEXT *context)
+{
+	if (context == NULL)
+		return;
+	md_drop_doc(context, TRUE);
+	md_free_buffers(&context->ctx);
+	MD_FREE(context);
+}
+
+void md_parser_context_trim(MD_PARSER_CONTEXT *context)
+{
+	md_drop_doc(context, TRUE);
+	md_free_buffers(&context->ctx);
+}
+
+/* Sets the context up like md_setup_ctx() and takes care of the things
+ * tied to the last document. */
+static int md_setup_context(MD_PARSER_CONTEXT *context, const MD_CHAR *text,
+			    MD_SIZE size, const MD_PARSER *parser,
+			    void *userdata)
+{
+	int build_mark_char_map = !context->has_mark_char_map ||
+				  context->mark_char_map_flags != parser->flags;
+	int ret;
+
+	ret = md_setup_ctx(&context->ctx, text, size, parser, userdata,
+			   build_mark_char_map);
+	if (ret != 0)
+		return ret;
+
+	context->has_mark_char_map = TRUE;
+	context->mark_char_map_flags = parser->flags;
+	context->ctx.record_top_blocks = TRUE;
+	return 0;
+}
+
+int md_parse_in_context(MD_PARSER_CONTEXT *context, const MD_CHAR *text,
+			MD_SIZE size, const MD_PARSER *parser, void *userdata)
+{
+	MD_CTX *ctx = &context->ctx;
+	MD_TOP_BLOCK *top_blocks;
+	int alloc_top_blocks;
+	int ret;
+
+	md_drop_doc(context, ctx->allocator != md_parser_allocator(parser));
+
+	ret = md_setup_context(context, text, size, parser, userdata);
+	if (ret != 0)
+		return ret;
+
+	ret = md_process_doc(ctx);
+	md_free_ref_def_hashtable(ctx);
+	if (ret != 0) {
+		md_free_ref_defs(ctx);
+		return ret;
+	}
+
+	/* Keep the document for md_reparse_in_context(). */
+	top_blocks = context->top_blocks;
+	alloc_top_blocks = context->alloc_top_blocks;
+	context->top_blocks = ctx->top_blocks;
+	context->n_top_blocks = ctx->n_top_blocks;
+	context->alloc_top_blocks = ctx->alloc_top_blocks;
+	ctx->top_blocks = top_blocks;
+	ctx->n_top_blocks = 0;
+	ctx->alloc_top_blocks = alloc_top_blocks;
+	md_keep_doc(context, size, md_ref_defs_hash(ctx));
+	return 0;
+}
+
+/* Puts the top-level blocks of the re-parsed run in place of the old blocks
+ * first to last - 1. */
+static int md_splice_top_blocks(MD_PARSER_CONTEXT *context, int first,
+				int last, SZ old_size, SZ new_size)
+{
+	MD_CTX *ctx = &context->ctx;
+	int n_after = context->n_top_blocks - last;
+	int n_top_blocks = first + ctx->n_top_blocks + n_after;
+	int i;
+
+	if (n_top_blocks > context->alloc_top_blocks) {
+		MD_TOP_BLOCK *new_top_blocks;
+
+		new_top_blocks = (MD_TOP_BLOCK *)md_resize(
+			ctx, context->top_blocks,
+			context->alloc_top_blocks * sizeof(MD_TOP_BLOCK),
+			n_top_blocks * sizeof(MD_TOP_BLOCK));
+		if (new_top_blocks == NULL) {
+			MD_LOG("realloc() failed.");
+			return -1;
+		}
+
+		context->top_blocks = new_top_blocks;
+		context->alloc_top_blocks = n_top_blocks;
+	}
+
+	if (n_after > 0)
+		memmove(context->top_blocks + first + ctx->n_top_blocks,
+			context->top_blocks + last,
+			n_after * sizeof(MD_TOP_BLOCK));
+	if (ctx->n_top_blocks > 0)
+		memcpy(context->top_blocks + first, ctx->top_blocks,
+		       ctx->n_top_blocks * sizeof(MD_TOP_BLOCK));
+	for (i = n_top_blocks - n_after; i < n_top_blocks; i++)
+		context->top_blocks[i].beg =
+			context->top_blocks[i].beg - old_size + new_size;
+
+	context->n_top_blocks = n_top_blocks;
+	return 0;
+}
+
+int md_reparse_in_context(MD_PARSER_CONTEXT *context, const MD_CHAR *text,
+			  MD_SIZE size, const MD_EDIT *edit,
+			  const MD_PARSER *parser, void *userdata,
+			  MD_REPARSE_INFO *info)
+{
+	MD_CTX *ctx = &context->ctx;
+	unsigned old_block_count =
+		(context->has_doc ? (unsigned)context->n_top_blocks : 0);
+	MD_RESYNC resync;
+	unsigned ref_defs_hash;
+	OFF beg;
+	OFF end;
+	OFF old_end;
+	int first;
+	int n_before;
+	int n_moved = 0; /* Kept definitions no longer owned by the context. */
+	int i;
+	int ret;
+
+	if (!context->has_doc || edit == NULL ||
+	    context->doc_flags != parser->flags ||
+	    ctx->allocator != md_parser_allocator(parser) ||
+	    edit->beg > context->doc_size ||
+	    edit->old_size > context->doc_size - edit->beg ||
+	    size != context->doc_size - edit->old_size + edit->new_size)
+		goto full;
+
+	/* Re-parse from the start of the last run at or before the edit. */
+	first = 0;
+	beg = 0;
+	for (i = 0; i < context->n_top_blocks &&
+		    context->top_blocks[i].beg <= edit->beg;
+	     i++) {
+		if (context->top_blocks[i].flags & MD_TOP_BLOCK_RUN_START) {
+			first = i;
+			beg = context->top_blocks[i].beg;
+		}
+	}
+
+	ret = md_setup_context(context, text, size, parser, userdata);
+	if (ret != 0)
+		goto abort;
+
+	/* The definitions before the run remain as they are. */
+	n_before = 0;
+	while (n_before < context->n_ref_defs &&
+	       context->ref_defs[n_before].dest_beg < beg)
+		n_before++;
+	MD_CHECK(md_restore_ref_defs(ctx, context->ref_defs, n_before, 0, 0));
+	n_moved = n_before;
+
+	resync.min_off = edit->beg + edit->new_size;
+	resync.old_size = edit->old_size;
+	resync.new_size = edit->new_size;
+	resync.top_blocks = context->top_blocks;
+	resync.n_top_blocks = context->n_top_blocks;
+	resync.index = context->n_top_blocks;
+	MD_CHECK(md_analyze_lines(ctx, beg, &resync, &end));
+
+	/* Those behind the run are moved by the edit, those in it are gone. */
+	old_end = (end < size ? end - edit->new_size + edit->old_size
+			      : context->doc_size);
+	for (i = n_before; i < context->n_ref_defs; i++) {
+		MD_REF_DEF *def = &context->ref_defs[i];
+
+		if (def->dest_beg >= old_end)
+			break;
+		if (def->label_needs_free)
+			md_release(ctx, def->label);
+		if (def->title_needs_free)
+			md_release(ctx, def->title);
+		n_moved++;
+	}
+	MD_CHECK(md_restore_ref_defs(ctx, context->ref_defs + i,
+				     context->n_ref_defs - i, edit->old_size,
+				     edit->new_size));
+	context->n_ref_defs = 0;
+	n_moved = 0;
+
+	/* Any block outside of the run may use the definitions. */
+	ref_defs_hash = md_ref_defs_hash(ctx);
+	if (ref_defs_hash != context->doc_ref_defs_hash &&
+	    (first > 0 || resync.index < context->n_top_blocks)) {
+		md_free_ref_defs(ctx);
+		goto full;
+	}
+
+	ctx->size = end;
+	ctx->doc_ends_with_newline = (end > 0 && ISNEWLINE(end - 1));
+	ret = md_process_doc_blocks(ctx);
+	md_free_ref_def_hashtable(ctx);
+	if (ret != 0)
+		goto abort;
+
+	if (info != NULL) {
+		info->full = FALSE;
+		info->first_block = (unsigned)first;
+		info->old_block_count = (unsigned)(resync.index - first);
+		info->new_block_count = (unsigned)ctx->n_top_blocks;
+		info->beg = beg;
+		info->end = end;
+	}
+
+	/* Without the blocks, the next call just parses everything. */
+	if (md_splice_top_blocks(context, first, resync.index,
+				 edit->old_size, edit->new_size) != 0) {
+		md_free_ref_defs(ctx);
+		md_drop_doc(context, FALSE);
+		return 0;
+	}
+	md_keep_doc(context, size, ref_defs_hash);
+	return 0;
+
+full:
+	ret = md_parse_in_context(context, text, size, parser, userdata);
+	if (ret == 0 && info != NULL) {
+		info->full = TRUE;
+		info->first_block = 0;
+		info->old_block_count = old_block_count;
+		info->new_block_count = (unsigned)context->n_top_blocks;
+		info->beg = 0;
+		info->end = size;
+	}
 	return ret;
+
+abort:
+	md_free_ref_defs(ctx);
+	memmove(context->ref_defs, context->ref_defs + n_moved,
+		(context->n_ref_defs - n_moved) * sizeof(MD_REF_DEF));
+	context->n_ref_defs -= n_moved;
+	md_drop_doc(context, FALSE);
+	return ret;
+}
+
+struct MD_PARSER_STREAM_tag {
+	MD_CTX ctx;
+	MD_LINE_LOOP loop;
+	CHAR *text; /* All the text fed so far; ctx.size of it is analyzed. */
+	SZ size;
+	SZ alloc_text;
+	int ret; /* The first error; the stream is dead then. */
+};
+
+/* Grows the text of the stream. The link reference definitions found so far
+ * may point into it, so they are moved along. */
+static int md_stream_grow_text(MD_PARSER_STREAM *stream, SZ min_alloc)
+{
+	MD_CTX *ctx = &stream->ctx;
+	CHAR *new_text;
+	SZ alloc_text = stream->alloc_text + stream->alloc_text / 2;
+	int i;
+
+	if (alloc_text < min_alloc)
+		alloc_text = min_alloc;
+	if (alloc_text < 4096)
+		alloc_text = 4096;
+
+	for (i = 0; i < ctx->n_ref_defs; i++) {
+		MD_REF_DEF *def = &ctx->ref_defs[i];
+
+		if (!def->label_needs_free)
+			def->label_off = (OFF)(def->label - stream->text);
+		if (!def->title_needs_free)
+			def->title_off = (OFF)(def->title - stream->text);
+	}
+
+	new_text = (CHAR *)md_resize(ctx, stream->text,
+				     stream->alloc_text * sizeof(CHAR),
+				     alloc_text * sizeof(CHAR));
+	if (new_text == NULL) {
+		MD_LOG("realloc() failed.");
+		return -1;
+	}
+	stream->text = new_text;
+	stream->alloc_text = alloc_text;
+	ctx->text = new_text;
+
+	for (i = 0; i < ctx->n_ref_defs; i++) {
+		MD_REF_DEF *def = &ctx->ref_defs[i];
+
+		if (!def->label_needs_free)
+			def->label = new_text + def->label_off;
+		if (!def->title_needs_free)
+			def->title = new_text + def->title_off;
+	}
+
+	return 0;
+}
+
+MD_PARSER_STREAM *md_parse_stream_begin(const MD_PARSER *parser,
+					void *userdata)
+{
+	const MD_ALLOCATOR *allocator = md_parser_allocator(parser);
+	MD_PARSER_STREAM *stream;
+
+	stream = (MD_PARSER_STREAM *)allocator->alloc(sizeof(MD_PARSER_STREAM),
+						      allocator->userdata);
+	if (stream == NULL) {
+		if (parser->debug_log != NULL)
+			parser->debug_log("malloc() failed.", userdata);
+		return NULL;
+	}
+	memset(stream, 0, sizeof(MD_PARSER_STREAM));
+
+	if (md_setup_ctx(&stream->ctx, NULL, 0, parser, userdata, TRUE) != 0 ||
+	    md_begin_lines(&stream->ctx, &stream->loop, 0) != 0) {
+		allocator->release(stream, allocator->userdata);
+		return NULL;
+	}
+
+	/* Only complete lines are analyzed before md_parse_stream_end(). */
+	stream->ctx.doc_ends_with_newline = TRUE;
+	return stream;
+}
+
+int md_parse_stream_feed(MD_PARSER_STREAM *stream, const MD_CHAR *text,
+			 MD_SIZE size)
+{
+	MD_CTX *ctx = &stream->ctx;
+	OFF end;
+	OFF scan_beg;
+
+	if (stream->ret != 0 || size == 0)
+		return stream->ret;
+
+	if (size > (SZ)(-1) - stream->size) {
+		MD_LOG("The document is too large.");
+		stream->ret = -1;
+		return -1;
+	}
+	if (stream->size + size > stream->alloc_text) {
+		stream->ret = md_stream_grow_text(stream, stream->size + size);
+		if (stream->ret != 0)
+			return stream->ret;
+	}
+	memcpy(stream->text + stream->size, text, size * sizeof(CHAR));
+	scan_beg = (stream->size > ctx->size ? stream->size - 1 : ctx->size);
+	stream->size += size;
+
+	/* Find the end of the last complete line. Nothing after ctx->size but a
+	 * trailing '\r', which may yet be followed by '\n', can be a new line
+	 * from the previous calls. */
+	end = stream->size;
+	if (stream->text[end - 1] == _T('\r'))
+		end--;
+	while (end > scan_beg && !ISNEWLINE_(stream->text[end - 1]))
+		end--;
+	if (end == scan_beg)
+		return 0;
+
+	/* Line analysis never looks past the newline of the line, so it does
+	 * not tell the lines up to end from the lines of the whole document. */
+	ctx->size = end;
+	stream->ret = md_continue_lines(ctx, &stream->loop, NULL);
+	return stream->ret;
+}
+
+int md_parse_stream_end(MD_PARSER_STREAM *stream)
+{
+	MD_CTX *ctx = &stream->ctx;
+	int ret = stream->ret;
+
+	if (ret != 0)
+		goto abort;
+
+	ctx->size = stream->size;
+	ctx->doc_ends_with_newline =
+		(stream->size > 0 && ISNEWLINE_(stream->text[stream->size - 1]));
+	MD_CHECK(md_continue_lines(ctx, &stream->loop, NULL));
+	MD_CHECK(md_end_current_block(ctx));
+	MD_CHECK(md_process_doc_blocks(ctx));
+
+abort:
+	md_parse_stream_abort(stream);
+	return ret;
+}
+
+void md_parse_stream_abort(MD_PARSER_STREAM *stream)
+{
+	MD_CTX *ctx = &stream->ctx;
+	const MD_ALLOCATOR *allocator = ctx->allocator;
+
+	md_free_ref_def_hashtable(ctx);
+	md_free_ref_defs(ctx);
+	md_free_buffers(ctx);
+	md_release(ctx, stream->text);
+	allocator->release(stream, allocator->userdata);
 }
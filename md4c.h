@@ -26,6 +26,8 @@
 #ifndef MD4C_H
 #define MD4C_H
 
+#include <stddef.h>
+
 #ifdef __cplusplus
     extern "C" {
 #endif
@@ -316,6 +318,7 @@ typedef struct MD_SPAN_WIKILINK {
 #define MD_FLAG_LATEXMATHSPANS              0x1000  /* Enable $ and $$ containing LaTeX equations. */
 #define MD_FLAG_WIKILINKS                   0x2000  /* Enable wiki links extension. */
 #define MD_FLAG_UNDERLINE                   0x4000  /* Enable underline extension (and disables '_' for normal emphasis). */
+#define MD_FLAG_PIPELINE                    0x8000  /* Report blocks while later ones are still being analyzed, see md_parse(). */
 
 #define MD_FLAG_PERMISSIVEAUTOLINKS         (MD_FLAG_PERMISSIVEEMAILAUTOLINKS | MD_FLAG_PERMISSIVEURLAUTOLINKS | MD_FLAG_PERMISSIVEWWWAUTOLINKS)
 #define MD_FLAG_NOHTML                      (MD_FLAG_NOHTMLBLOCKS | MD_FLAG_NOHTMLSPANS)
@@ -332,6 +335,77 @@ typedef struct MD_SPAN_WIKILINK {
 #define MD_DIALECT_COMMONMARK               0
 #define MD_DIALECT_GITHUB                   (MD_FLAG_PERMISSIVEAUTOLINKS | MD_FLAG_TABLES | MD_FLAG_STRIKETHROUGH | MD_FLAG_TASKLISTS)
 
+/* Detail structure for MD_PARSER::top_level_block().
+ *
+ * The source ranges of all top-level blocks partition the document: each
+ * range starts at the beginning of the first line of the block and ends where
+ * the range of the next block starts, so it also includes any trailing blank
+ * lines and link reference definitions. (A top-level block without any
+ * content lines, e.g. an empty list item, gets an empty range.)
+ *
+ * Any output which does not depend on absolute offsets in the document (like
+ * that of md_html()) is fully determined by the text in the range,
+ * layout_hash, ref_defs_hash and the parser flags. This makes it possible for
+ * the application to cache the rendered output of the block.
+ */
+typedef struct MD_TOP_LEVEL_BLOCK_DETAIL {
+    MD_BLOCKTYPE type;      /* Type of the top-level block. */
+    MD_OFFSET beg;          /* Source range of the block. */
+    MD_OFFSET end;
+
+    /* Hash of how the block has been broken into (nested) blocks and lines,
+     * independent on the position of the block in the document. */
+    unsigned layout_hash;
+
+    /* Hash of all link reference definitions in the document. */
+    unsigned ref_defs_hash;
+
+    /* Output: If set to non-zero by the callback, the whole block is skipped,
+     * i.e. no other callback is called for it. */
+    int skip;
+} MD_TOP_LEVEL_BLOCK_DETAIL;
+
+
+/* Memory allocator.
+ *
+ * The functions behave like malloc(), realloc() and free(). resize() also
+ * gets the size of the block being resized (zero if ptr is NULL), so an
+ * allocator does not need to remember the sizes itself.
+ */
+typedef struct MD_ALLOCATOR {
+    void* (*alloc)(size_t /*size*/, void* /*userdata*/);
+    void* (*resize)(void* /*ptr*/, size_t /*old_size*/, size_t /*new_size*/, void* /*userdata*/);
+    void (*release)(void* /*ptr*/, void* /*userdata*/);
+    void* userdata;
+} MD_ALLOCATOR;
+
+
+/* Worker pool for the parallel inline analysis.
+ *
+ * With a pool, md4c analyzes the inline contents of paragraphs and headings
+ * of large documents on the pool's threads, ahead of the block being
+ * processed. The callbacks are still all called in the document order from
+ * the thread which called md_parse().
+ *
+ * start() runs job(index, arg) for each index from 0 to n_jobs - 1 on the
+ * pool, possibly all at once, and returns a handle without waiting for them.
+ * wait() returns when all the jobs of the handle are done. If start() returns
+ * NULL, md4c runs the jobs itself. n_jobs is never larger than n_workers and
+ * md4c always waits for the jobs of one start() before the next one.
+ *
+ * The jobs allocate memory, so MD_PARSER::allocator (if any) must be
+ * thread-safe then. The arena of md_arena_new() is not. MD_PARSER::debug_log
+ * may be called from the pool's threads as well.
+ */
+typedef struct MD_WORKER_POOL {
+    void* (*start)(void (*job)(unsigned /*index*/, void* /*arg*/), void* /*arg*/,
+                   unsigned /*n_jobs*/, void* /*userdata*/);
+    void (*wait)(void* /*handle*/, void* /*userdata*/);
+    unsigned n_workers;
+    void* userdata;
+} MD_WORKER_POOL;
+
+
 /* Parser structure.
  */
 typedef struct MD_PARSER {
@@ -378,6 +452,31 @@ typedef struct MD_PARSER {
     /* Reserved. Set to NULL.
      */
     void (*syntax)(void);
+
+    /* Optional (may be NULL).
+     *
+     * If provided, it is called before each top-level block (i.e. each direct
+     * child of MD_BLOCK_DOC) is processed. At that point the block structure
+     * of the whole document is already known, so the callback may decide to
+     * skip the block, e.g. to reuse a cached output instead.
+     *
+     * Returning non-zero aborts the parsing as with the other callbacks.
+     */
+    int (*top_level_block)(MD_TOP_LEVEL_BLOCK_DETAIL* /*detail*/, void* /*userdata*/);
+
+    /* Optional (may be NULL).
+     *
+     * If provided, all memory needed during the parsing is allocated through
+     * it. Otherwise malloc(), realloc() and free() are used.
+     */
+    const MD_ALLOCATOR* allocator;
+
+    /* Optional (may be NULL).
+     *
+     * If provided, inlines of large documents are analyzed in parallel, see
+     * MD_WORKER_POOL.
+     */
+    const MD_WORKER_POOL* worker_pool;
 } MD_PARSER;
 
 
@@ -394,10 +493,157 @@ typedef MD_PARSER MD_RENDERER;
  * Zero is returned on success. If a runtime error occurs (e.g. a memory
  * fails), -1 is returned. If the processing is aborted due any callback
  * returning non-zero, the return value of the callback is returned.
+ *
+ * With MD_FLAG_PIPELINE, unless MD_PARSER::top_level_block or
+ * MD_PARSER::worker_pool is used, the callbacks for the blocks are called as
+ * soon as it is sure that nothing later in the document can change their
+ * output (i.e. after the last link reference definition they might use), while
+ * the rest of the document is still being analyzed. So a runtime error may
+ * occur after some output.
  */
 int md_parse(const MD_CHAR* text, MD_SIZE size, const MD_PARSER* parser, void* userdata);
 
 
+/* Built-in bump allocator.
+ *
+ * Allocations are carved out of large chunks and are released all at once
+ * by md_arena_reset(). The most recent allocation may grow in place, freeing
+ * anything else is a no-op. The chunk sizes double as needed and
+ * md_arena_reset() keeps the largest chunk, so parsing documents of a similar
+ * size again and again soon needs no more than one chunk.
+ *
+ * Pass md_arena_allocator() as MD_PARSER::allocator, and reset the arena after
+ * md_parse() returns.
+ */
+typedef struct MD_ARENA_tag MD_ARENA;
+
+/* Param chunk_size is the size of the first chunk. Returns NULL if the
+ * allocation fails. */
+MD_ARENA* md_arena_new(size_t chunk_size);
+
+void md_arena_free(MD_ARENA* arena);
+
+/* Releases all allocations made since the last reset. */
+void md_arena_reset(MD_ARENA* arena);
+
+const MD_ALLOCATOR* md_arena_allocator(MD_ARENA* arena);
+
+
+/* Opaque parser context which can be reused for many md_parse_in_context()
+ * calls.
+ *
+ * md_parse() sets up all its working buffers from scratch and frees them
+ * when it returns. A context keeps them, together with tables derived from
+ * the parser flags, so parsing documents of a similar size again and again
+ * does not allocate anything once the buffers have grown large enough.
+ *
+ * The buffers are allocated through MD_PARSER::allocator. If the allocator
+ * changes between calls, the buffers of the previous one are released first.
+ * With an arena, the context has to be trimmed before the arena is reset.
+ *
+ * A context may be used by one thread at a time only.
+ */
+typedef struct MD_PARSER_CONTEXT_tag MD_PARSER_CONTEXT;
+
+/* Returns NULL if the allocation fails. */
+MD_PARSER_CONTEXT* md_parser_context_new(void);
+
+void md_parser_context_free(MD_PARSER_CONTEXT* context);
+
+/* Frees the buffers retained by the context, e.g. after an unusually large
+ * document. The context remains usable. */
+void md_parser_context_trim(MD_PARSER_CONTEXT* context);
+
+/* Same as md_parse() but uses (and grows) the buffers of the context. */
+int md_parse_in_context(MD_PARSER_CONTEXT* context, const MD_CHAR* text, MD_SIZE size,
+                        const MD_PARSER* parser, void* userdata);
+
+
+/* Incremental reparsing.
+ *
+ * After md_parse_in_context() (or md_reparse_in_context()) the context also
+ * remembers the top-level blocks and the link reference definitions of the
+ * document. When the application then changes the document, it can describe
+ * the change as a single edit and md_reparse_in_context() re-parses only the
+ * smallest run of top-level blocks the edit can affect: Runs are separated by
+ * blank lines which are not inside of any block (like a fenced code block)
+ * and not inside of any container block (like a list), both in the old and
+ * the new document. So e.g. changing the looseness of a list or the extent
+ * of a block quote always re-parses the whole list or block quote.
+ *
+ * Only the blocks of that run are reported, wrapped in MD_BLOCK_DOC, and the
+ * output of the blocks outside of it is the same as in the previous parse.
+ * If the edit adds, removes or changes a link reference definition which
+ * may be used by the other blocks, or if the context cannot be used for the
+ * edit (different flags, allocator or document size, md_parser_context_trim()
+ * or an error in between), the whole document is parsed and reported, as
+ * MD_REPARSE_INFO::full tells.
+ *
+ * Offsets in all the callbacks are relative to the new document as usual.
+ */
+typedef struct MD_EDIT {
+    MD_OFFSET beg;          /* Where the edit starts (same in both documents). */
+    MD_SIZE old_size;       /* How many characters have been replaced... */
+    MD_SIZE new_size;       /* ...and by how many new ones. */
+} MD_EDIT;
+
+typedef struct MD_REPARSE_INFO {
+    /* Non-zero if the whole document has been reported. All the other
+     * members describe it as one run then. */
+    int full;
+
+    /* Index of the first reported top-level block (the same in the old and
+     * the new document), how many old blocks are replaced and how many new
+     * ones have been reported instead. */
+    unsigned first_block;
+    unsigned old_block_count;
+    unsigned new_block_count;
+
+    /* Source range of the re-parsed blocks in the new document. */
+    MD_OFFSET beg;
+    MD_OFFSET end;
+} MD_REPARSE_INFO;
+
+/* The top-level blocks are counted like calls of MD_PARSER::top_level_block().
+ * The callback is not needed to use this, though. */
+int md_reparse_in_context(MD_PARSER_CONTEXT* context, const MD_CHAR* text, MD_SIZE size,
+                          const MD_EDIT* edit, const MD_PARSER* parser, void* userdata,
+                          MD_REPARSE_INFO* info);
+
+
+/* Push parsing.
+ *
+ * Instead of handing the whole document to md_parse(), the application may
+ * feed it in chunks as it reads them, e.g. from a file or a socket. The block
+ * structure of every complete line is analyzed as soon as the line arrives,
+ * so little work is left once the last chunk has been read.
+ *
+ * Link reference definitions can be used before they are defined, so all the
+ * callbacks are only called from md_parse_stream_end(), as if md_parse() was
+ * called with the concatenated chunks; the stream keeps a copy of the text
+ * until then. The text may be split anywhere, also inside of a multi-byte
+ * character or between '\r' and '\n'.
+ *
+ * md_parse_stream_feed() returns zero on success, or -1 if it fails (e.g. the
+ * memory runs out); the stream is then dead and all the further calls fail
+ * as well. md_parse_stream_end() and md_parse_stream_abort() free the stream,
+ * either of them has to be called exactly once.
+ */
+typedef struct MD_PARSER_STREAM_tag MD_PARSER_STREAM;
+
+/* The parser is copied, its allocator has to stay valid until the stream is
+ * freed. Returns NULL if the allocation fails or the parser is not supported. */
+MD_PARSER_STREAM* md_parse_stream_begin(const MD_PARSER* parser, void* userdata);
+
+int md_parse_stream_feed(MD_PARSER_STREAM* stream, const MD_CHAR* text, MD_SIZE size);
+
+/* Parses the rest and calls the callbacks. Returns like md_parse(). */
+int md_parse_stream_end(MD_PARSER_STREAM* stream);
+
+/* Frees the stream without calling any callbacks. */
+void md_parse_stream_abort(MD_PARSER_STREAM* stream);
+
+
 #ifdef __cplusplus
     }  /* extern "C" { */
 #endif
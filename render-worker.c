@@ -0,0 +1,119 @@
+#include <obs-module.h>
+#include <util/darray.h>
+#include <util/threading.h>
+#include "render-worker.h"
+
+static struct {
+	pthread_t thread;
+	bool running;
+	volatile bool stop;
+	pthread_mutex_t mutex;
+	os_event_t *wake;
+	os_event_t *done;
+	struct render_task *current;
+	DARRAY(struct render_task *) queue;
+} rw;
+
+static void *render_worker_thread(void *data)
+{
+	UNUSED_PARAMETER(data);
+	os_set_thread_name("markdown_renderer");
+
+	while (!rw.stop) {
+		pthread_mutex_lock(&rw.mutex);
+		struct render_task *task = NULL;
+		if (rw.queue.num) {
+			task = rw.queue.array[0];
+			da_erase(rw.queue, 0);
+			task->queued = false;
+		}
+		rw.current = task;
+		pthread_mutex_unlock(&rw.mutex);
+
+		if (!task) {
+			os_event_wait(rw.wake);
+			continue;
+		}
+
+		task->callback(task->param);
+
+		pthread_mutex_lock(&rw.mutex);
+		rw.current = NULL;
+		os_event_signal(rw.done);
+		pthread_mutex_unlock(&rw.mutex);
+	}
+	return NULL;
+}
+
+bool render_worker_start(void)
+{
+	if (rw.running)
+		return true;
+	memset(&rw, 0, sizeof(rw));
+	if (pthread_mutex_init(&rw.mutex, NULL) != 0)
+		return false;
+	if (os_event_init(&rw.wake, OS_EVENT_TYPE_AUTO) != 0)
+		goto fail_wake;
+	if (os_event_init(&rw.done, OS_EVENT_TYPE_MANUAL) != 0)
+		goto fail_done;
+	rw.running = pthread_create(&rw.thread, NULL, render_worker_thread, NULL) == 0;
+	if (rw.running)
+		return true;
+
+	os_event_destroy(rw.done);
+fail_done:
+	os_event_destroy(rw.wake);
+fail_wake:
+	pthread_mutex_destroy(&rw.mutex);
+	return false;
+}
+
+void render_worker_stop(void)
+{
+	if (!rw.running)
+		return;
+	rw.stop = true;
+	os_event_signal(rw.wake);
+	pthread_join(rw.thread, NULL);
+	rw.running = false;
+
+	for (size_t i = 0; i < rw.queue.num; i++)
+		rw.queue.array[i]->queued = false;
+	da_free(rw.queue);
+	os_event_destroy(rw.done);
+	os_event_destroy(rw.wake);
+	pthread_mutex_destroy(&rw.mutex);
+}
+
+void render_worker_queue(struct render_task *task)
+{
+	if (!rw.running) {
+		task->callback(task->param);
+		return;
+	}
+	pthread_mutex_lock(&rw.mutex);
+	if (!task->queued) {
+		task->queued = true;
+		da_push_back(rw.queue, &task);
+	}
+	pthread_mutex_unlock(&rw.mutex);
+	os_event_signal(rw.wake);
+}
+
+void render_worker_cancel(struct render_task *task)
+{
+	if (!rw.running)
+		return;
+	pthread_mutex_lock(&rw.mutex);
+	if (task->queued) {
+		da_erase_item(rw.queue, &task);
+		task->queued = false;
+	}
+	while (rw.current == task) {
+		os_event_reset(rw.done);
+		pthread_mutex_unlock(&rw.mutex);
+		os_event_wait(rw.done);
+		pthread_mutex_lock(&rw.mutex);
+	}
+	pthread_mutex_unlock(&rw.mutex);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <util/c99defs.h>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/* Module wide background thread that runs queued tasks one at a time. A task
+ * is embedded in its owner and queued again whenever there is new work, it is
+ * never queued twice. */
+
+typedef void (*render_task_cb)(void *param);
+
+struct render_task {
+	render_task_cb callback;
+	void *param;
+	bool queued;
+};
+
+bool render_worker_start(void);
+void render_worker_stop(void);
+
+/* Runs the task on the worker thread, right away if the worker is not running. */
+void render_worker_queue(struct render_task *task);
+
+/* After this returns the task is no longer queued or running. */
+void render_worker_cancel(struct render_task *task);
+
+/* Lock-free handoff of a pointer between threads, returns the previous value. */
+static inline void *render_exchange_ptr(void *volatile *ptr, void *val)
+{
+#ifdef _MSC_VER
+	return _InterlockedExchangePointer(ptr, val);
+#else
+	return __atomic_exchange_n(ptr, val, __ATOMIC_ACQ_REL);
+#endif
+}
@@ -0,0 +1,116 @@
+#!/usr/bin/env python3
+#
+# Regenerates the perfect hash of the named HTML entities in entity.c.
+#
+# Usage: scripts/build_entity_hash.py [path/to/entity.c]
+#
+# It reads entity_table[] from entity.c and rewrites the tables between the
+# "BEGIN/END GENERATED ENTITY HASH" comments. Run it whenever entity_table[]
+# changes; entity_hash() in entity.c has to stay in sync with hash() here.
+
+import os
+import re
+import sys
+
+FNV_PRIME = 0x01000193
+BEGIN = "/* BEGIN GENERATED ENTITY HASH (scripts/build_entity_hash.py) */\n"
+END = "/* END GENERATED ENTITY HASH */\n"
+
+
+def hash(seed, name):
+    h = seed if seed != 0 else FNV_PRIME
+    for c in name.encode("ascii"):
+        h = ((h * FNV_PRIME) & 0xffffffff) ^ c
+    return h
+
+
+def build(names):
+    # Hash and displace: every bucket of the first level hash either maps its
+    # only key to a free slot directly (stored as -slot-1), or gets the seed of
+    # a second level hash which puts all of its keys into free slots.
+    n = len(names)
+    buckets = [[] for _ in range(n)]
+    for i, name in enumerate(names):
+        buckets[hash(0, name) % n].append(i)
+
+    displacements = [0] * n
+    slots = [None] * n
+    order = sorted(range(n), key=lambda b: -len(buckets[b]))
+    for b in order:
+        bucket = buckets[b]
+        if len(bucket) <= 1:
+            break
+        seed = 1
+        while True:
+            taken = set()
+            for i in bucket:
+                slot = hash(seed, names[i]) % n
+                if slots[slot] is not None or slot in taken:
+                    break
+                taken.add(slot)
+            else:
+                break
+            seed += 1
+        for i in bucket:
+            slots[hash(seed, names[i]) % n] = i
+        displacements[b] = seed
+
+    free = [slot for slot in range(n) if slots[slot] is None]
+    for b in order:
+        if len(buckets[b]) != 1:
+            continue
+        slot = free.pop()
+        slots[slot] = buckets[b][0]
+        displacements[b] = -slot - 1
+
+    assert all(-32768 <= d <= 32767 for d in displacements)
+    return displacements, slots
+
+
+def format_array(decl, values):
+    lines = [decl + " = {"]
+    row = []
+    for v in values:
+        row.append("%d," % v)
+        if len(row) == 12:
+            lines.append("    " + " ".join(row))
+            row = []
+    if row:
+        lines.append("    " + " ".join(row))
+    lines[-1] = lines[-1][:-1]
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else \
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "entity.c")
+    with open(path, "r", encoding="utf-8", newline="") as f:
+        source = f.read()
+
+    names = re.findall(r'^    \{ "(&[A-Za-z0-9]+;?)", \{ \d+, \d+ \} \}', source, re.M)
+    if not names:
+        sys.exit("no entity_table[] in " + path)
+    displacements, slots = build(names)
+
+    for name in names:
+        d = displacements[hash(0, name) % len(names)]
+        slot = -d - 1 if d < 0 else hash(d, name) % len(names)
+        assert names[slots[slot]] == name
+
+    generated = BEGIN
+    generated += "#define ENTITY_COUNT %d\n\n" % len(names)
+    generated += format_array("static const short entity_displacement[ENTITY_COUNT]", displacements)
+    generated += "\n"
+    generated += format_array("static const unsigned short entity_slot[ENTITY_COUNT]", slots)
+    generated += END
+
+    beg = source.index(BEGIN)
+    end = source.index(END) + len(END)
+    source = source[:beg] + generated + source[end:]
+    with open(path, "w", encoding="utf-8", newline="") as f:
+        f.write(source)
+
+
+if __name__ == "__main__":
+    main()
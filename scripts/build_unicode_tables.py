@@ -0,0 +1,173 @@
+#!/usr/bin/env python3
+#
+# Regenerates the two-stage Unicode property tables in md4c.c.
+#
+# Usage: scripts/build_unicode_tables.py [--ucd DIR] [path/to/md4c.c]
+#
+# With --ucd it reads UnicodeData.txt and CaseFolding.txt from DIR (e.g. an
+# unpacked https://www.unicode.org/Public/<version>/ucd/), otherwise it takes
+# the data of the Python unicodedata module. It rewrites everything between
+# the "BEGIN/END GENERATED UNICODE TABLES" comments; md_unicode_info__() in
+# md4c.c has to stay in sync with the layout produced here.
+#
+# Every codepoint below MD_UNICODE_LIMIT maps to one entry of UNICODE_INFO[]:
+# its flags (Zs category as whitespace, P* categories as punctuation) and its
+# full case folding (statuses C and F). A one codepoint folding is stored as
+# the difference to the folded codepoint, so whole alternating or shifted
+# ranges share the same entry and the pages of 2^PAGE_SHIFT codepoints made
+# of them deduplicate well. UNICODE_PAGE_MAP[] maps the high bits of the
+# codepoint to a page, UNICODE_PAGES[] the low bits to the entry.
+
+import os
+import re
+import sys
+import unicodedata
+
+PAGE_SHIFT = 5
+BEGIN = "/* BEGIN GENERATED UNICODE TABLES (scripts/build_unicode_tables.py) */\n"
+END = "/* END GENERATED UNICODE TABLES */\n"
+
+# ASCII follows the CommonMark definitions, i.e. ISWHITESPACE_() and
+# ISPUNCT_() in md4c.c, rather than the Unicode categories.
+ASCII_WHITESPACE = " \t\v\f"
+ASCII_PUNCT = "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+
+
+def load_ucd(ucd):
+    categories = {}
+    with open(os.path.join(ucd, "UnicodeData.txt"), encoding="utf-8") as f:
+        first = None
+        for line in f:
+            fields = line.split(";")
+            cp = int(fields[0], 16)
+            if fields[1].endswith(", First>"):
+                first = cp
+                continue
+            for c in range(first if first is not None else cp, cp + 1):
+                categories[c] = fields[2]
+            first = None
+
+    folding = {}
+    with open(os.path.join(ucd, "CaseFolding.txt"), encoding="utf-8") as f:
+        for line in f:
+            line = line.split("#")[0].strip()
+            if not line:
+                continue
+            code, status, mapping = [s.strip() for s in line.split(";")[:3]]
+            if status in ("C", "F"):
+                folding[int(code, 16)] = [int(c, 16) for c in mapping.split()]
+
+    # The first line of every UCD file names the version, e.g.
+    # "# CaseFolding-14.0.0.txt".
+    with open(os.path.join(ucd, "CaseFolding.txt"), encoding="utf-8") as f:
+        m = re.search(r"-(\d+\.\d+\.\d+)\.txt", f.readline())
+    version = m.group(1) if m else "unknown"
+    return version, lambda cp: categories.get(cp, "Cn"), lambda cp: folding.get(cp)
+
+
+def load_python():
+    def category(cp):
+        return unicodedata.category(chr(cp))
+
+    def fold(cp):
+        folded = chr(cp).casefold()
+        return None if folded == chr(cp) else [ord(c) for c in folded]
+
+    return unicodedata.unidata_version, category, fold
+
+
+def build(category, fold):
+    infos = [(0, 0, (0, 0, 0))]
+    index = {infos[0]: 0}
+    values = []
+    for cp in range(0x110000):
+        if cp < 0x80:
+            flags = (1 if chr(cp) in ASCII_WHITESPACE else 0) | (2 if chr(cp) in ASCII_PUNCT else 0)
+        else:
+            cat = category(cp)
+            flags = (1 if cat == "Zs" else 0) | (2 if cat.startswith("P") else 0)
+        folded = fold(cp)
+        if folded is None or folded == [cp]:
+            info = (flags, 0, (0, 0, 0))
+        elif len(folded) == 1:
+            info = (flags, 1, ((folded[0] - cp) & 0xffffffff, 0, 0))
+        else:
+            info = (flags, len(folded), tuple(folded + [0] * (3 - len(folded))))
+        if info not in index:
+            index[info] = len(infos)
+            infos.append(info)
+        values.append(index[info])
+
+    page_size = 1 << PAGE_SHIFT
+    limit = max(cp for cp, v in enumerate(values) if v != 0) + 1
+    limit = (limit + page_size - 1) // page_size * page_size
+    page_map = []
+    pages = []
+    page_index = {}
+    for beg in range(0, limit, page_size):
+        page = tuple(values[beg:beg + page_size])
+        if page not in page_index:
+            page_index[page] = len(pages)
+            pages.append(page)
+        page_map.append(page_index[page])
+
+    assert len(infos) <= 256 and len(pages) <= 256
+    return limit, infos, page_map, pages, values
+
+
+def format_array(decl, items):
+    # Fill the rows up to 80 columns (with an 8 column tab).
+    lines = [decl + " = {"]
+    row = ""
+    for item in items:
+        if row and 8 + len(row) + 1 + len(item) + 1 > 80:
+            lines.append("\t" + row)
+            row = ""
+        row += (" " if row else "") + item + ","
+    lines.append("\t" + row[:-1])
+    lines.append("};")
+    return "\n".join(lines) + "\n"
+
+
+def main():
+    args = sys.argv[1:]
+    if args[:1] == ["--ucd"]:
+        version, category, fold = load_ucd(args[1])
+        args = args[2:]
+    else:
+        version, category, fold = load_python()
+    path = args[0] if args else \
+        os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "md4c.c")
+    with open(path, "r", encoding="utf-8", newline="") as f:
+        source = f.read()
+
+    limit, infos, page_map, pages, values = build(category, fold)
+    for cp in range(limit):
+        assert pages[page_map[cp >> PAGE_SHIFT]][cp & ((1 << PAGE_SHIFT) - 1)] == values[cp]
+    assert all(v == 0 for v in values[limit:])
+
+    generated = BEGIN
+    generated += "/* Unicode %s; %d entries, %d pages of %d codepoints. */\n" % \
+        (version, len(infos), len(pages), 1 << PAGE_SHIFT)
+    generated += "#define MD_UNICODE_PAGE_SHIFT %d\n" % PAGE_SHIFT
+    generated += "#define MD_UNICODE_LIMIT 0x%x\n\n" % limit
+    generated += format_array("static const MD_UNICODE_INFO UNICODE_INFO[]",
+                              ["{%d, %d, {0x%04x, 0x%04x, 0x%04x}}" % ((flags, n) + cps)
+                               for flags, n, cps in infos])
+    generated += "\n"
+    generated += format_array("static const unsigned char\n\tUNICODE_PAGE_MAP[MD_UNICODE_LIMIT >> MD_UNICODE_PAGE_SHIFT]",
+                              ["%d" % v for v in page_map])
+    generated += "\n"
+    generated += format_array("static const unsigned char UNICODE_PAGES[]",
+                              ["%d" % v for page in pages for v in page])
+    generated += END
+
+    beg = source.index(BEGIN)
+    end = source.index(END) + len(END)
+    source = source[:beg] + generated + source[end:]
+    with open(path, "w", encoding="utf-8", newline="") as f:
+        f.write(source)
+
+
+if __name__ == "__main__":
+    main()